@@ -0,0 +1,105 @@
+#include <thread_pool.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <future>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace tp;
+
+static const size_t SAMPLES = 200;
+static const std::chrono::milliseconds IDLE_PERIOD(500);
+static const std::chrono::microseconds POST_GAP(2000);
+
+typedef std::chrono::steady_clock Clock;
+
+struct Result
+{
+    double idle_cpu;
+    double latency_p50_us;
+    double latency_p99_us;
+};
+
+/**
+ * @brief measure Report cores burnt by an idle pool and latency between
+ * posting a task and its start after the pool had POST_GAP to go idle.
+ */
+static Result measure(IdlePolicy policy, size_t threads)
+{
+    ThreadPoolOptions options;
+    options.setThreadCount(threads);
+    options.setIdlePolicy(policy);
+
+    NonBlockingThreadPool pool(options);
+
+    Result result;
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    std::clock_t cpu_begin = std::clock();
+    auto wall_begin = Clock::now();
+    std::this_thread::sleep_for(IDLE_PERIOD);
+    std::clock_t cpu_end = std::clock();
+    auto wall_end = Clock::now();
+
+    double cpu_s = double(cpu_end - cpu_begin) / CLOCKS_PER_SEC;
+    double wall_s = std::chrono::duration<double>(wall_end - wall_begin).count();
+    result.idle_cpu = cpu_s / wall_s;
+
+    std::vector<double> latencies;
+    latencies.reserve(SAMPLES);
+    for (size_t i = 0; i < SAMPLES; ++i)
+    {
+        std::this_thread::sleep_for(POST_GAP);
+
+        std::promise<Clock::time_point> started;
+        auto future = started.get_future();
+        auto posted = Clock::now();
+        pool.post([&started]() { started.set_value(Clock::now()); });
+
+        auto start = future.get();
+        latencies.push_back(std::chrono::duration<double, std::micro>(start - posted).count());
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    result.latency_p50_us = latencies[latencies.size() / 2];
+    result.latency_p99_us = latencies[latencies.size() * 99 / 100];
+
+    return result;
+}
+
+int main(int, const char* [])
+{
+    const size_t threads = std::max<size_t>(1u, std::thread::hardware_concurrency());
+
+    struct
+    {
+        IdlePolicy policy;
+        const char* name;
+    } const policies[] = {
+        {IdlePolicy::Spin, "spin"},
+        {IdlePolicy::SpinPause, "spin-pause"},
+        {IdlePolicy::SpinYield, "spin-yield"},
+        {IdlePolicy::SpinPark, "spin-park"},
+    };
+
+    std::cout << "Benchmark idle policies, " << threads << " threads" << std::endl;
+    std::cout << "policy        idle cores    wakeup p50 (us)    wakeup p99 (us)" << std::endl;
+
+    for (const auto& p : policies)
+    {
+        Result r = measure(p.policy, threads);
+        std::cout.width(14);
+        std::cout << std::left << p.name;
+        std::cout.width(14);
+        std::cout << r.idle_cpu;
+        std::cout.width(19);
+        std::cout << r.latency_p50_us;
+        std::cout << r.latency_p99_us << std::endl;
+    }
+
+    return 0;
+}
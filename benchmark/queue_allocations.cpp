@@ -0,0 +1,193 @@
+#include <thread_pool.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <list>
+#include <new>
+#include <thread>
+#include <utility>
+
+using namespace tp;
+
+static std::atomic<size_t> g_allocations(0);
+
+// Every replaceable form is defined, so no allocation escapes the count and
+// each new pairs with a delete of the same family.
+static void* countedAllocate(std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size)
+{
+    return countedAllocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+    return countedAllocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return countedAllocate(size);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+    std::free(p);
+}
+
+static const size_t QUEUE_SIZE = 1024;
+static const size_t ITEMS = 1000000;
+
+typedef std::chrono::steady_clock Clock;
+typedef std::pair<FixedFunction<void(), 128>, ThreadParams> Item;
+
+struct Result
+{
+    double allocations_per_item;
+    double items_per_ms;
+};
+
+/**
+ * @brief measureQueue Move ITEMS pool tasks from one producer to one
+ * consumer through a SafeQueue with the given container.
+ */
+template <typename Container>
+static Result measureQueue()
+{
+    SafeQueue<Item, Container> queue(QUEUE_SIZE);
+
+    size_t allocations_begin = g_allocations.load();
+    auto begin = Clock::now();
+
+    std::thread consumer([&queue]() {
+        Item item;
+        for (size_t i = 0; i < ITEMS; ++i)
+        {
+            while (!queue.try_move_pop(item))
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    for (size_t i = 0; i < ITEMS; ++i)
+    {
+        Item item([]() {}, ThreadParams());
+        while (!queue.try_move_push(item))
+        {
+            std::this_thread::yield();
+        }
+    }
+    consumer.join();
+
+    auto end = Clock::now();
+
+    Result result;
+    result.allocations_per_item = double(g_allocations.load() - allocations_begin) / ITEMS;
+    result.items_per_ms = ITEMS / std::chrono::duration<double, std::milli>(end - begin).count();
+    return result;
+}
+
+/**
+ * @brief measurePool Post ITEMS tasks to a BlockingThreadPool, throttled to
+ * the queue size, after the pool reached steady state.
+ */
+static Result measurePool()
+{
+    ThreadPoolOptions options;
+    options.setQueueSize(QUEUE_SIZE);
+    BlockingThreadPool pool(options);
+
+    std::atomic<size_t> executed(0);
+
+    size_t allocations_begin = g_allocations.load();
+    auto begin = Clock::now();
+
+    for (size_t i = 0; i < ITEMS; ++i)
+    {
+        while (!pool.tryPost([&executed]() { ++executed; }))
+        {
+            std::this_thread::yield();
+        }
+    }
+    while (executed.load() < ITEMS)
+    {
+        std::this_thread::yield();
+    }
+
+    auto end = Clock::now();
+
+    Result result;
+    result.allocations_per_item = double(g_allocations.load() - allocations_begin) / ITEMS;
+    result.items_per_ms = ITEMS / std::chrono::duration<double, std::milli>(end - begin).count();
+    return result;
+}
+
+static void print(const char* name, const Result& r)
+{
+    std::cout.width(24);
+    std::cout << std::left << name;
+    std::cout.width(20);
+    std::cout << r.allocations_per_item;
+    std::cout << r.items_per_ms << std::endl;
+}
+
+int main(int, const char* [])
+{
+    std::cout << "Benchmark queue containers, " << ITEMS << " items" << std::endl;
+    std::cout << "container               allocs per item     items per ms" << std::endl;
+
+    print("SafeQueue std::list", measureQueue<std::list<Item>>());
+    print("SafeQueue RingBuffer", measureQueue<RingBuffer<Item>>());
+    print("BlockingThreadPool", measurePool());
+
+    return 0;
+}
@@ -0,0 +1,266 @@
+#include <thread_pool.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace tp;
+
+typedef std::chrono::steady_clock Clock;
+
+enum class Workload
+{
+    Empty,
+    Cpu,
+    Memory
+};
+
+struct Config
+{
+    size_t tasks = 100000;
+    size_t max_threads = std::max<size_t>(1u, std::thread::hardware_concurrency());
+    size_t max_producers = 4;
+};
+
+/**
+ * @brief The Run class holds what a single benchmark configuration shares
+ * with its tasks: per task latency slots and the completion counter.
+ */
+struct Run
+{
+    Workload workload;
+    std::vector<double> latencies_us;
+    std::atomic<size_t> completed;
+    const std::vector<std::uint64_t>* memory;
+};
+
+struct Result
+{
+    double wall_s;
+    double cpu_s;
+    double throughput;
+    double p50_us;
+    double p99_us;
+    double p999_us;
+};
+
+static volatile std::uint64_t g_sink;
+
+static const size_t MEMORY_WORDS = 32 * 1024 * 1024 / sizeof(std::uint64_t);
+static const size_t MEMORY_READS = 256;
+static const size_t CPU_ITERATIONS = 2000;
+
+static void work(Workload workload, const std::vector<std::uint64_t>& memory, size_t id)
+{
+    switch (workload)
+    {
+    case Workload::Empty:
+        break;
+    case Workload::Cpu:
+    {
+        std::uint64_t x = id + 1;
+        for (size_t i = 0; i < CPU_ITERATIONS; ++i)
+        {
+            x = x * 6364136223846793005ull + 1442695040888963407ull;
+        }
+        g_sink = x;
+        break;
+    }
+    case Workload::Memory:
+    {
+        // Dependent reads scattered over a buffer much larger than caches.
+        std::uint64_t index = id * 2654435761u;
+        std::uint64_t sum = 0;
+        for (size_t i = 0; i < MEMORY_READS; ++i)
+        {
+            index = (index * 6364136223846793005ull + memory[index % MEMORY_WORDS]) >> 7;
+            sum += index;
+        }
+        g_sink = sum;
+        break;
+    }
+    }
+}
+
+template <typename Pool>
+static Result measure(const ThreadPoolOptions& options, size_t producers, size_t tasks,
+                      Workload workload, const std::vector<std::uint64_t>& memory)
+{
+    Run run;
+    run.workload = workload;
+    run.latencies_us.assign(tasks, 0.0);
+    run.completed = 0;
+    run.memory = &memory;
+
+    Result result;
+    {
+        Pool pool(options);
+
+        std::clock_t cpu_begin = std::clock();
+        auto wall_begin = Clock::now();
+
+        std::vector<std::thread> threads;
+        for (size_t p = 0; p < producers; ++p)
+        {
+            threads.emplace_back([&pool, &run, p, producers, tasks]() {
+                for (size_t id = p; id < tasks; id += producers)
+                {
+                    for (;;)
+                    {
+                        auto posted = Clock::now();
+                        Run* r = &run;
+                        bool ok = pool.tryPost([r, id, posted]() {
+                            r->latencies_us[id] =
+                                std::chrono::duration<double, std::micro>(Clock::now() - posted).count();
+                            work(r->workload, *r->memory, id);
+                            r->completed.fetch_add(1, std::memory_order_release);
+                        });
+                        if (ok)
+                        {
+                            break;
+                        }
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+        while (run.completed.load(std::memory_order_acquire) < tasks)
+        {
+            std::this_thread::yield();
+        }
+
+        auto wall_end = Clock::now();
+        std::clock_t cpu_end = std::clock();
+
+        result.wall_s = std::chrono::duration<double>(wall_end - wall_begin).count();
+        result.cpu_s = double(cpu_end - cpu_begin) / CLOCKS_PER_SEC;
+        result.throughput = tasks / result.wall_s;
+    }
+
+    std::sort(run.latencies_us.begin(), run.latencies_us.end());
+    result.p50_us = run.latencies_us[tasks / 2];
+    result.p99_us = run.latencies_us[tasks * 99 / 100];
+    result.p999_us = run.latencies_us[tasks * 999 / 1000];
+    return result;
+}
+
+static const char* workloadName(Workload workload)
+{
+    switch (workload)
+    {
+    case Workload::Empty:
+        return "empty";
+    case Workload::Cpu:
+        return "cpu";
+    case Workload::Memory:
+        return "memory";
+    }
+    return "";
+}
+
+static std::vector<size_t> powersOfTwoUpTo(size_t max)
+{
+    std::vector<size_t> values;
+    for (size_t v = 1; v < max; v *= 2)
+    {
+        values.push_back(v);
+    }
+    values.push_back(max);
+    return values;
+}
+
+static bool parseArg(const char* arg, const char* name, size_t& value)
+{
+    size_t length = std::strlen(name);
+    if (std::strncmp(arg, name, length) != 0 || arg[length] != '=')
+    {
+        return false;
+    }
+    value = std::strtoul(arg + length + 1, nullptr, 10);
+    return true;
+}
+
+int main(int argc, const char* argv[])
+{
+    Config config;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!parseArg(argv[i], "--tasks", config.tasks) &&
+            !parseArg(argv[i], "--max-threads", config.max_threads) &&
+            !parseArg(argv[i], "--max-producers", config.max_producers))
+        {
+            std::cerr << "usage: " << argv[0]
+                      << " [--tasks=N] [--max-threads=N] [--max-producers=N]" << std::endl;
+            return 1;
+        }
+    }
+    config.tasks = std::max<size_t>(config.tasks, 1);
+    config.max_threads = std::max<size_t>(config.max_threads, 1);
+    config.max_producers = std::max<size_t>(config.max_producers, 1);
+
+    std::vector<std::uint64_t> memory(MEMORY_WORDS);
+    for (size_t i = 0; i < memory.size(); ++i)
+    {
+        memory[i] = i * 11400714819323198485ull;
+    }
+
+    const Workload workloads[] = {Workload::Empty, Workload::Cpu, Workload::Memory};
+    const char* pools[] = {"non_blocking", "blocking"};
+    const bool criticals[] = {false, true};
+
+    std::cout << "[" << std::endl;
+    bool first = true;
+    for (const char* pool : pools)
+    {
+        for (bool critical : criticals)
+        {
+            for (Workload workload : workloads)
+            {
+                for (size_t threads : powersOfTwoUpTo(config.max_threads))
+                {
+                    for (size_t producers : powersOfTwoUpTo(config.max_producers))
+                    {
+                        ThreadPoolOptions options;
+                        options.setThreadCount(threads);
+                        options.setCritical(critical);
+
+                        Result r = std::strcmp(pool, "blocking") == 0
+                            ? measure<BlockingThreadPool>(options, producers, config.tasks, workload, memory)
+                            : measure<NonBlockingThreadPool>(options, producers, config.tasks, workload, memory);
+
+                        std::cout << (first ? "" : ",\n")
+                                  << "  {\"pool\": \"" << pool << "\""
+                                  << ", \"mode\": \"" << (critical ? "critical" : "non_critical") << "\""
+                                  << ", \"workload\": \"" << workloadName(workload) << "\""
+                                  << ", \"threads\": " << threads
+                                  << ", \"producers\": " << producers
+                                  << ", \"tasks\": " << config.tasks
+                                  << ", \"throughput_per_s\": " << r.throughput
+                                  << ", \"latency_us\": {\"p50\": " << r.p50_us
+                                  << ", \"p99\": " << r.p99_us
+                                  << ", \"p999\": " << r.p999_us << "}"
+                                  << ", \"wall_s\": " << r.wall_s
+                                  << ", \"cpu_s\": " << r.cpu_s << "}";
+                        std::cout.flush();
+                        first = false;
+                    }
+                }
+            }
+        }
+    }
+    std::cout << "\n]" << std::endl;
+
+    return 0;
+}
@@ -1,3 +1,6 @@
 #pragma once
 
 #include <thread_pool/thread_pool.hpp>
+#include <thread_pool/parallel.hpp>
+#include <thread_pool/task_group.hpp>
+#include <thread_pool/strand.hpp>
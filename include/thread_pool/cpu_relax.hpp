@@ -0,0 +1,19 @@
+#pragma once
+
+namespace tp
+{
+namespace detail
+{
+    /**
+     * @brief cpu_relax Hint the CPU that the caller is spin waiting.
+     */
+    inline void cpu_relax()
+    {
+#if defined(__i386__) || defined(__x86_64__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__) || (defined(__arm__) && __ARM_ARCH >= 7)
+        asm volatile("yield" ::: "memory");
+#endif
+    }
+}
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace tp
+{
+
+/**
+ * @brief The DeadlineQueue class is a bounded earliest-deadline-first
+ * queue shared by the workers of a pool.
+ * Items are kept in a binary heap preallocated for the queue size, so
+ * push and pop do not allocate. Items with equal deadlines pop in push
+ * order. The queue also counts how many popped items completed before
+ * their deadline.
+ */
+template <typename T>
+class DeadlineQueue
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * @brief DeadlineQueue Constructor.
+     * @param size Maximum number of items.
+     */
+    explicit DeadlineQueue(size_t size);
+
+    /**
+     * @brief push Push item with its absolute deadline.
+     * @return false if the queue is full.
+     */
+    template <typename U>
+    bool push(U&& item, Clock::time_point deadline);
+
+    /**
+     * @brief tryPop Pop the item with the earliest deadline.
+     * @param item Place to store the item.
+     * @param deadline Place to store its deadline.
+     * @return false if the queue is empty.
+     */
+    bool tryPop(T& item, Clock::time_point& deadline);
+
+    /**
+     * @brief recordCompletion Count an item that just finished running as
+     * met or missed. Items without deadline (Clock::time_point::max()) are
+     * not counted.
+     * @param deadline Deadline the item was popped with.
+     */
+    void recordCompletion(Clock::time_point deadline);
+
+    /**
+     * @brief met Number of items that finished before their deadline.
+     */
+    size_t met() const;
+
+    /**
+     * @brief missed Number of items that finished after their deadline.
+     */
+    size_t missed() const;
+
+private:
+    struct Entry
+    {
+        Clock::time_point deadline;
+        std::uint64_t sequence;
+        T item;
+    };
+
+    // std::*_heap build a max heap, so order by "later" first.
+    static bool later(const Entry& lhs, const Entry& rhs)
+    {
+        if (lhs.deadline != rhs.deadline) {
+            return lhs.deadline > rhs.deadline;
+        }
+        return lhs.sequence > rhs.sequence;
+    }
+
+    DeadlineQueue(const DeadlineQueue&) = delete;
+    DeadlineQueue& operator=(const DeadlineQueue&) = delete;
+
+    std::mutex m_mutex;
+    std::vector<Entry> m_heap;
+    const size_t m_size;
+    std::uint64_t m_sequence;
+    std::atomic<size_t> m_met;
+    std::atomic<size_t> m_missed;
+};
+
+
+/// Implementation
+
+template <typename T>
+inline DeadlineQueue<T>::DeadlineQueue(size_t size)
+    : m_size(size)
+    , m_sequence(0)
+    , m_met(0)
+    , m_missed(0)
+{
+    m_heap.reserve(size);
+}
+
+template <typename T>
+template <typename U>
+inline bool DeadlineQueue<T>::push(U&& item, Clock::time_point deadline)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_heap.size() >= m_size) {
+        return false;
+    }
+    Entry entry = {deadline, m_sequence++, T(std::forward<U>(item))};
+    m_heap.push_back(std::move(entry));
+    std::push_heap(m_heap.begin(), m_heap.end(), &DeadlineQueue::later);
+    return true;
+}
+
+template <typename T>
+inline bool DeadlineQueue<T>::tryPop(T& item, Clock::time_point& deadline)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_heap.empty()) {
+        return false;
+    }
+    std::pop_heap(m_heap.begin(), m_heap.end(), &DeadlineQueue::later);
+    item = std::move(m_heap.back().item);
+    deadline = m_heap.back().deadline;
+    m_heap.pop_back();
+    return true;
+}
+
+template <typename T>
+inline void DeadlineQueue<T>::recordCompletion(Clock::time_point deadline)
+{
+    if (deadline == Clock::time_point::max()) {
+        return;
+    }
+    (Clock::now() <= deadline ? m_met : m_missed).fetch_add(1, std::memory_order_relaxed);
+}
+
+template <typename T>
+inline size_t DeadlineQueue<T>::met() const
+{
+    return m_met.load(std::memory_order_relaxed);
+}
+
+template <typename T>
+inline size_t DeadlineQueue<T>::missed() const
+{
+    return m_missed.load(std::memory_order_relaxed);
+}
+
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace tp
+{
+
+/**
+ * @brief The EventCount class lets threads park until some condition,
+ * checked outside of any lock, becomes true.
+ * Waiter protocol:
+ *   key = prepareWait();
+ *   if (condition) { cancelWait(); } else { commitWait(key); }
+ * Notifiers make the condition true and then call notifyOne/notifyAll.
+ * A notification issued after prepareWait is never lost. Notifying with no
+ * waiters costs a fence and an atomic load only.
+ * Inspired by Dmitry Vyukov's eventcount.
+ * http://www.1024cores.net/home/lock-free-algorithms/eventcounts
+ */
+class EventCount
+{
+public:
+    typedef std::uint32_t Key;
+
+    EventCount();
+
+    /**
+     * @brief prepareWait Register the calling thread as a waiter.
+     * @return Key to be passed to commitWait.
+     */
+    Key prepareWait();
+
+    /**
+     * @brief cancelWait Unregister a waiter if the condition became true.
+     */
+    void cancelWait();
+
+    /**
+     * @brief commitWait Block until notified after prepareWait returned key.
+     * @param key Key returned by prepareWait.
+     */
+    void commitWait(Key key);
+
+    /**
+     * @brief commitWaitUntil Like commitWait, giving up at deadline.
+     * @return false if the deadline passed without notification.
+     */
+    bool commitWaitUntil(Key key, std::chrono::steady_clock::time_point deadline);
+
+    /**
+     * @brief notifyOne Wake at least one waiter, if any.
+     */
+    void notifyOne();
+
+    /**
+     * @brief notifyAll Wake all waiters.
+     */
+    void notifyAll();
+
+private:
+    EventCount(const EventCount&) = delete;
+    EventCount& operator=(const EventCount&) = delete;
+
+    void notify(bool all);
+
+    static const std::uint64_t WAITER_MASK = 0xffffffffu;
+    static const unsigned EPOCH_SHIFT = 32;
+
+    // Epoch in the upper half, number of waiters in the lower half.
+    std::atomic<std::uint64_t> m_state;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+};
+
+
+/// Implementation
+
+inline EventCount::EventCount()
+    : m_state(0)
+{
+}
+
+inline EventCount::Key EventCount::prepareWait()
+{
+    std::uint64_t state = m_state.fetch_add(1, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return static_cast<Key>(state >> EPOCH_SHIFT);
+}
+
+inline void EventCount::cancelWait()
+{
+    m_state.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+inline void EventCount::commitWait(Key key)
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this, key]() {
+            return static_cast<Key>(m_state.load(std::memory_order_relaxed) >> EPOCH_SHIFT) != key;
+        });
+    }
+    m_state.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+inline bool EventCount::commitWaitUntil(Key key, std::chrono::steady_clock::time_point deadline)
+{
+    bool notified;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        notified = m_condition.wait_until(lock, deadline, [this, key]() {
+            return static_cast<Key>(m_state.load(std::memory_order_relaxed) >> EPOCH_SHIFT) != key;
+        });
+    }
+    m_state.fetch_sub(1, std::memory_order_seq_cst);
+    return notified;
+}
+
+inline void EventCount::notifyOne()
+{
+    notify(false);
+}
+
+inline void EventCount::notifyAll()
+{
+    notify(true);
+}
+
+inline void EventCount::notify(bool all)
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if ((m_state.load(std::memory_order_relaxed) & WAITER_MASK) == 0) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_state.fetch_add(std::uint64_t(1) << EPOCH_SHIFT, std::memory_order_seq_cst);
+    }
+
+    if (all) {
+        m_condition.notify_all();
+    } else {
+        m_condition.notify_one();
+    }
+}
+
+}
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <thread_pool/slab_allocator.hpp>
+
+#include <cstddef>
 #include <type_traits>
 #include <cstring>
+#include <new>
 #include <stdexcept>
 #include <utility>
 
@@ -9,27 +13,55 @@ namespace tp
 {
 
 /**
- * @brief The FixedFunction<R(ARGS...), STORAGE_SIZE> class implements
- * functional object.
+ * @brief The InlineOnly struct selects FixedFunction storage limited to
+ * the internal storage. Larger functional objects do not compile.
+ */
+struct InlineOnly {};
+
+/**
+ * @brief The SlabFallback struct selects FixedFunction storage falling back
+ * to a block of a SlabAllocator, or to the heap, for functional objects
+ * that do not fit the internal storage.
+ */
+struct SlabFallback {};
+
+/**
+ * @brief The FixedFunction<R(ARGS...), STORAGE_SIZE, OVERFLOW> class
+ * implements functional object.
  * This function is analog of 'std::function' with limited capabilities:
  *  - It supports only move semantics.
- *  - The size of functional objects is limited to storage size.
+ *  - The size of functional objects is limited to storage size, unless
+ *    OVERFLOW is SlabFallback.
  * Due to limitations above it is much faster on creation and copying than
  * std::function.
+ * With SlabFallback, storage is chosen at compile time from the type of the
+ * functional object: in place if it fits, else in a block of the slab given
+ * to the constructor, else on the heap. Out of place objects are moved by
+ * pointer, so a small STORAGE_SIZE keeps queues of mostly small tasks
+ * compact without forbidding large ones.
  */
-template <typename SIGNATURE, size_t STORAGE_SIZE = 128>
+template <typename SIGNATURE, size_t STORAGE_SIZE = 128, typename OVERFLOW = InlineOnly>
 class FixedFunction;
 
-template <typename R, typename... ARGS, size_t STORAGE_SIZE>
-class FixedFunction<R(ARGS...), STORAGE_SIZE>
+namespace detail
 {
+    /**
+     * @brief uses_slab_fallback Tell if Task is a FixedFunction able to
+     * place large functional objects in a slab.
+     */
+    template <typename Task>
+    struct uses_slab_fallback : std::false_type {};
 
-    typedef R (*func_ptr_type)(ARGS...);
+    template <typename SIGNATURE, size_t STORAGE_SIZE>
+    struct uses_slab_fallback<FixedFunction<SIGNATURE, STORAGE_SIZE, SlabFallback>> : std::true_type {};
+}
 
+template <typename R, typename... ARGS, size_t STORAGE_SIZE, typename OVERFLOW>
+class FixedFunction<R(ARGS...), STORAGE_SIZE, OVERFLOW>
+{
 public:
     FixedFunction()
-        : m_function_ptr(nullptr), m_method_ptr(nullptr),
-          m_alloc_ptr(nullptr)
+        : m_vtable(nullptr)
     {
     }
 
@@ -40,37 +72,31 @@ public:
      */
     template <typename FUNC>
     FixedFunction(FUNC&& object)
+        : FixedFunction(std::forward<FUNC>(object), nullptr)
+    {
+    }
+
+    /**
+     * @brief FixedFunction Constructor from functional object, placing it
+     * in a slab block if it does not fit the internal storage.
+     * @param object Functor object, moved like with the constructor above.
+     * @param slab Slab to take the block from, or nullptr to use the heap.
+     * The slab must outlive the FixedFunction. Ignored with InlineOnly.
+     */
+    template <typename FUNC>
+    FixedFunction(FUNC&& object, SlabAllocator* slab)
         : FixedFunction()
     {
         typedef typename std::remove_reference<FUNC>::type unref_type;
 
-        static_assert(sizeof(unref_type) < STORAGE_SIZE,
+        static_assert(std::is_same<OVERFLOW, SlabFallback>::value || sizeof(unref_type) < STORAGE_SIZE,
             "functional object doesn't fit into internal storage");
         static_assert(std::is_move_constructible<unref_type>::value,
             "Should be of movable type");
 
-        m_method_ptr = [](
-            void* object_ptr, func_ptr_type, ARGS... args) -> R
-        {
-            return static_cast<unref_type*>(object_ptr)
-                ->
-                operator()(args...);
-        };
-
-        m_alloc_ptr = [](void* storage_ptr, void* object_ptr)
-        {
-            if(object_ptr)
-            {
-                unref_type* x_object = static_cast<unref_type*>(object_ptr);
-                new(storage_ptr) unref_type(std::move(*x_object));
-            }
-            else
-            {
-                static_cast<unref_type*>(storage_ptr)->~unref_type();
-            }
-        };
-
-        m_alloc_ptr(&m_storage, &object);
+        emplace<unref_type>(object, slab, std::integral_constant<bool,
+            !std::is_same<OVERFLOW, SlabFallback>::value ||
+            (sizeof(unref_type) < STORAGE_SIZE && alignof(unref_type) <= alignof(Storage))>());
     }
 
     /**
@@ -80,11 +106,7 @@ public:
     FixedFunction(RET (*func_ptr)(PARAMS...))
         : FixedFunction()
     {
-        m_function_ptr = func_ptr;
-        m_method_ptr = [](void*, func_ptr_type f_ptr, ARGS... args) -> R
-        {
-            return static_cast<RET (*)(PARAMS...)>(f_ptr)(args...);
-        };
+        emplace<RET (*)(PARAMS...)>(func_ptr, nullptr, std::true_type());
     }
 
     FixedFunction(FixedFunction&& o) : FixedFunction()
@@ -100,7 +122,7 @@ public:
 
     ~FixedFunction()
     {
-        if(m_alloc_ptr) m_alloc_ptr(&m_storage, nullptr);
+        reset();
     }
 
     /**
@@ -109,55 +131,173 @@ public:
      */
     R operator()(ARGS... args)
     {
-        if(!m_method_ptr) throw std::runtime_error("call of empty functor");
-        return m_method_ptr(&m_storage, m_function_ptr, args...);
+        if(!m_vtable) throw std::runtime_error("call of empty functor");
+        return m_vtable->invoke(&m_storage, args...);
     }
 
 private:
     FixedFunction& operator=(const FixedFunction&) = delete;
     FixedFunction(const FixedFunction&) = delete;
 
-    union
+    typedef typename std::aligned_storage<STORAGE_SIZE, sizeof(size_t)>::type Storage;
+
+    /**
+     * @brief The VTable struct holds the operations on one stored type.
+     * Null relocate and destroy mean the storage is moved with memcpy and
+     * needs no destruction.
+     */
+    struct VTable
     {
-        typename std::aligned_storage<STORAGE_SIZE, sizeof(size_t)>::type
-            m_storage;
-        func_ptr_type m_function_ptr;
+        R (*invoke)(void* storage_ptr, ARGS... args);
+        /// Move construct into dst_ptr and destroy the object at src_ptr.
+        void (*relocate)(void* dst_ptr, void* src_ptr);
+        void (*destroy)(void* storage_ptr);
     };
 
-    typedef R (*method_type)(
-        void* object_ptr, func_ptr_type free_func_ptr, ARGS... args);
-    method_type m_method_ptr;
-
-    typedef void (*alloc_type)(void* storage_ptr, void* object_ptr);
-    alloc_type m_alloc_ptr;
+    /**
+     * @brief The Boxed struct is kept in the internal storage for objects
+     * placed out of it.
+     */
+    struct Boxed
+    {
+        void* object;
+        /// Slab owning the object block, nullptr if on the heap.
+        SlabAllocator* slab;
+    };
 
-    void moveFromOther(FixedFunction& o)
+    template <typename T>
+    struct InlineOps
     {
-        if(this == &o) return;
+        static R invoke(void* storage_ptr, ARGS... args)
+        {
+            return (*static_cast<T*>(storage_ptr))(args...);
+        }
 
-        if(m_alloc_ptr)
+        static void relocate(void* dst_ptr, void* src_ptr)
         {
-            m_alloc_ptr(&m_storage, nullptr);
-            m_alloc_ptr = nullptr;
+            T* src = static_cast<T*>(src_ptr);
+            new(dst_ptr) T(std::move(*src));
+            src->~T();
         }
-        else
+
+        static void destroy(void* storage_ptr)
+        {
+            static_cast<T*>(storage_ptr)->~T();
+        }
+
+        static const VTable table;
+    };
+
+    template <typename T>
+    struct BoxedOps
+    {
+        static R invoke(void* storage_ptr, ARGS... args)
+        {
+            return (*static_cast<T*>(static_cast<Boxed*>(storage_ptr)->object))(args...);
+        }
+
+        static void destroy(void* storage_ptr)
         {
-            m_function_ptr = nullptr;
+            Boxed* boxed = static_cast<Boxed*>(storage_ptr);
+            static_cast<T*>(boxed->object)->~T();
+            release(boxed->object, boxed->slab);
         }
 
-        m_method_ptr = o.m_method_ptr;
-        o.m_method_ptr = nullptr;
+        static const VTable table;
+    };
 
-        if(o.m_alloc_ptr)
+    template <typename T>
+    void emplace(T& object, SlabAllocator*, std::true_type)
+    {
+        new(&m_storage) T(std::move(object));
+        m_vtable = &InlineOps<T>::table;
+    }
+
+    template <typename T>
+    void emplace(T& object, SlabAllocator* slab, std::false_type)
+    {
+        static_assert(sizeof(Boxed) <= sizeof(Storage),
+            "internal storage can't hold a pointer to the functional object");
+        static_assert(alignof(T) <= alignof(std::max_align_t),
+            "functional object is over-aligned");
+
+        void* block = nullptr;
+        if (slab && sizeof(T) <= slab->blockSize()) {
+            block = slab->allocate();
+        }
+        if (!block) {
+            block = ::operator new(sizeof(T));
+            slab = nullptr;
+        }
+        try {
+            new(block) T(std::move(object));
+        } catch (...) {
+            release(block, slab);
+            throw;
+        }
+        new(&m_storage) Boxed{block, slab};
+        m_vtable = &BoxedOps<T>::table;
+    }
+
+    static void release(void* block, SlabAllocator* slab)
+    {
+        if (slab) {
+            slab->deallocate(block);
+        } else {
+            ::operator delete(block);
+        }
+    }
+
+    void reset()
+    {
+        if(m_vtable && m_vtable->destroy) m_vtable->destroy(&m_storage);
+        m_vtable = nullptr;
+    }
+
+    void moveFromOther(FixedFunction& o)
+    {
+        if(this == &o) return;
+
+        reset();
+        if(!o.m_vtable) return;
+
+        if(o.m_vtable->relocate)
         {
-            m_alloc_ptr = o.m_alloc_ptr;
-            m_alloc_ptr(&m_storage, &o.m_storage);
+            o.m_vtable->relocate(&m_storage, &o.m_storage);
         }
         else
         {
-            m_function_ptr = o.m_function_ptr;
+            std::memcpy(&m_storage, &o.m_storage, sizeof(Storage));
         }
+        m_vtable = o.m_vtable;
+        o.m_vtable = nullptr;
     }
+
+    Storage m_storage;
+    const VTable* m_vtable;
+};
+
+/**
+ * Trivially copyable objects are relocated by copying the storage bytes and
+ * need no destruction. Boxed objects are always relocated by copying the
+ * pointer.
+ */
+template <typename R, typename... ARGS, size_t STORAGE_SIZE, typename OVERFLOW>
+template <typename T>
+const typename FixedFunction<R(ARGS...), STORAGE_SIZE, OVERFLOW>::VTable
+FixedFunction<R(ARGS...), STORAGE_SIZE, OVERFLOW>::InlineOps<T>::table = {
+    &InlineOps<T>::invoke,
+    std::is_trivially_copyable<T>::value ? nullptr : &InlineOps<T>::relocate,
+    std::is_trivially_copyable<T>::value ? nullptr : &InlineOps<T>::destroy
+};
+
+template <typename R, typename... ARGS, size_t STORAGE_SIZE, typename OVERFLOW>
+template <typename T>
+const typename FixedFunction<R(ARGS...), STORAGE_SIZE, OVERFLOW>::VTable
+FixedFunction<R(ARGS...), STORAGE_SIZE, OVERFLOW>::BoxedOps<T>::table = {
+    &BoxedOps<T>::invoke,
+    nullptr,
+    &BoxedOps<T>::destroy
 };
 
 }
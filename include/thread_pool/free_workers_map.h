@@ -1,37 +1,188 @@
 #ifndef FREE_WORKERS_MAP_H
 #define FREE_WORKERS_MAP_H
 
-#include <map>
-#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
 
 namespace tp {
+/**
+ * @brief The FreeWorkersMap class keeps track of idle workers.
+ * It is a lock-free bitmap: bit 'id' is set while worker 'id' is free.
+ * Each 64 bit word lives on its own cache line, so updates from workers in
+ * different words never contend.
+ */
 class FreeWorkersMap
 {
 public:
-    FreeWorkersMap() {}
+    /**
+     * @brief FreeWorkersMap Constructor. All workers start busy.
+     * @param size Number of workers to track.
+     */
+    explicit FreeWorkersMap(size_t size = 0)
+        : _size(size)
+        , _wordCount((size + BITS_PER_WORD - 1) / BITS_PER_WORD)
+        , _storage(new char[_wordCount * sizeof(Word) + CACHELINE_SIZE])
+    {
+        // new only guarantees fundamental alignment, align words by hand.
+        std::uintptr_t raw = reinterpret_cast<std::uintptr_t>(_storage.get());
+        _words = reinterpret_cast<Word*>((raw + CACHELINE_SIZE - 1) & ~std::uintptr_t(CACHELINE_SIZE - 1));
+        for (size_t i = 0; i < _wordCount; ++i) {
+            new (&_words[i]) Word();
+            _words[i].bits.store(0, std::memory_order_relaxed);
+        }
+    }
 
+    /**
+     * @brief setFree Mark worker as free or busy.
+     */
     void setFree(size_t id, bool isFree) {
-        std::lock_guard<std::mutex> guard(_workerLock);
-        _freeWorkersMap[id] = isFree;
+        if (id >= _size) {
+            return;
+        }
+        const std::uint64_t mask = std::uint64_t(1) << (id % BITS_PER_WORD);
+        if (isFree) {
+            _words[id / BITS_PER_WORD].bits.fetch_or(mask, std::memory_order_release);
+        } else {
+            _words[id / BITS_PER_WORD].bits.fetch_and(~mask, std::memory_order_relaxed);
+        }
     }
 
-    bool findFreeWorker(size_t & id) {
-        std::lock_guard<std::mutex> guard(_workerLock);
-        auto it = std::find_if(_freeWorkersMap.begin(), _freeWorkersMap.end(),
-                               [](std::map<size_t, bool>::value_type item)->bool {
-                                   return item.second;});
-        if (it == _freeWorkersMap.end()) {
+    /**
+     * @brief isFree Return true if the worker is currently marked free.
+     */
+    bool isFree(size_t id) const {
+        if (id >= _size) {
             return false;
-        } else {
-            id = (*it).first;
-            return true;
         }
+        const std::uint64_t mask = std::uint64_t(1) << (id % BITS_PER_WORD);
+        return (_words[id / BITS_PER_WORD].bits.load(std::memory_order_acquire) & mask) != 0;
+    }
+
+    /**
+     * @brief findFreeWorker Find the lowest free worker without claiming it.
+     * @param id Free worker id, set on success.
+     * @return true if a free worker was found.
+     */
+    bool findFreeWorker(size_t & id) const {
+        for (size_t w = 0; w < _wordCount; ++w) {
+            std::uint64_t bits = _words[w].bits.load(std::memory_order_acquire);
+            if (bits != 0) {
+                id = w * BITS_PER_WORD + lowestBit(bits);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief claimFreeWorker Atomically find a free worker and mark it busy.
+     * @param id Claimed worker id, set on success.
+     * @return true if a worker was claimed.
+     */
+    bool claimFreeWorker(size_t & id) {
+        for (size_t w = 0; w < _wordCount; ++w) {
+            std::uint64_t bits = _words[w].bits.load(std::memory_order_acquire);
+            while (bits != 0) {
+                const unsigned bit = lowestBit(bits);
+                const std::uint64_t mask = std::uint64_t(1) << bit;
+                if (_words[w].bits.compare_exchange_weak(bits, bits & ~mask, std::memory_order_acq_rel,
+                                                         std::memory_order_acquire)) {
+                    id = w * BITS_PER_WORD + bit;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief claimFreeWorker Atomically find a free worker among
+     * [first, last) and mark it busy.
+     * @param id Claimed worker id, set on success.
+     * @return true if a worker was claimed.
+     */
+    bool claimFreeWorker(size_t & id, size_t first, size_t last) {
+        last = last < _size ? last : _size;
+        if (first >= last) {
+            return false;
+        }
+        for (size_t w = first / BITS_PER_WORD; w <= (last - 1) / BITS_PER_WORD; ++w) {
+            const size_t base = w * BITS_PER_WORD;
+            std::uint64_t range = ~std::uint64_t(0);
+            if (first > base) {
+                range &= ~std::uint64_t(0) << (first - base);
+            }
+            if (last - base < BITS_PER_WORD) {
+                range &= (std::uint64_t(1) << (last - base)) - 1;
+            }
+            std::uint64_t bits = _words[w].bits.load(std::memory_order_acquire);
+            while ((bits & range) != 0) {
+                const unsigned bit = lowestBit(bits & range);
+                const std::uint64_t mask = std::uint64_t(1) << bit;
+                if (_words[w].bits.compare_exchange_weak(bits, bits & ~mask, std::memory_order_acq_rel,
+                                                         std::memory_order_acquire)) {
+                    id = base + bit;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief claim Atomically mark the given worker busy if it is free.
+     * @return true if the worker was free and is now claimed.
+     */
+    bool claim(size_t id) {
+        if (id >= _size) {
+            return false;
+        }
+        const std::uint64_t mask = std::uint64_t(1) << (id % BITS_PER_WORD);
+        return (_words[id / BITS_PER_WORD].bits.fetch_and(~mask, std::memory_order_acq_rel) & mask) != 0;
+    }
+
+    /**
+     * @brief size Number of tracked workers.
+     */
+    size_t size() const {
+        return _size;
     }
 
 private:
-    std::map<size_t, bool> _freeWorkersMap;
-    std::mutex _workerLock;
+    static const size_t BITS_PER_WORD = 64;
+
+    static const size_t CACHELINE_SIZE = 64;
+
+    struct alignas(CACHELINE_SIZE) Word
+    {
+        std::atomic<std::uint64_t> bits;
+    };
+    static_assert(sizeof(Word) == CACHELINE_SIZE, "each word should fill a cache line");
+    static_assert(std::is_trivially_destructible<Word>::value, "words are never destroyed");
+
+    static unsigned lowestBit(std::uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<unsigned>(__builtin_ctzll(bits));
+#else
+        unsigned bit = 0;
+        while ((bits & 1u) == 0) {
+            bits >>= 1;
+            ++bit;
+        }
+        return bit;
+#endif
+    }
+
+    FreeWorkersMap(const FreeWorkersMap&) = delete;
+    FreeWorkersMap& operator=(const FreeWorkersMap&) = delete;
 
+    size_t _size;
+    size_t _wordCount;
+    std::unique_ptr<char[]> _storage;
+    Word* _words;
 };
 }
 
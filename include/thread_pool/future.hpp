@@ -0,0 +1,416 @@
+#pragma once
+
+#include <thread_pool/cpu_relax.hpp>
+#include <thread_pool/event_count.hpp>
+#include <thread_pool/slab_allocator.hpp>
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace tp
+{
+
+namespace detail
+{
+
+/**
+ * @brief The FutureContext class is shared by a pool and all the future
+ * states it created. It owns the slab the states live in and the event
+ * waiting futures park on. States keep it alive, so futures may outlive
+ * their pool.
+ */
+class FutureContext
+{
+public:
+    static const size_t BLOCK_SIZE = 128;
+
+    explicit FutureContext(size_t slots)
+        : m_slab(slots, BLOCK_SIZE)
+    {}
+
+    SlabAllocator& slab()
+    {
+        return m_slab;
+    }
+
+    EventCount& event()
+    {
+        return m_event;
+    }
+
+private:
+    SlabAllocator m_slab;
+    EventCount m_event;
+};
+
+/**
+ * @brief The FutureValue class stores the result of a submitted handler.
+ */
+template <typename R>
+class FutureValue
+{
+public:
+    FutureValue() : m_set(false) {}
+
+    ~FutureValue()
+    {
+        if (m_set) {
+            reinterpret_cast<R*>(&m_storage)->~R();
+        }
+    }
+
+    template <typename Fn>
+    void run(Fn& fn)
+    {
+        new (&m_storage) R(fn());
+        m_set = true;
+    }
+
+    R take()
+    {
+        return std::move(*reinterpret_cast<R*>(&m_storage));
+    }
+
+private:
+    typename std::aligned_storage<sizeof(R), alignof(R)>::type m_storage;
+    bool m_set;
+};
+
+template <>
+class FutureValue<void>
+{
+public:
+    template <typename Fn>
+    void run(Fn& fn)
+    {
+        fn();
+    }
+
+    void take() {}
+};
+
+/**
+ * @brief The FutureState class is the state shared by a Future and the
+ * task fulfilling it. It is placed in the context slab when it fits and
+ * a block is free, on the heap otherwise, and destroyed once both sides
+ * released it.
+ */
+template <typename R>
+class FutureState
+{
+public:
+    static FutureState* create(const std::shared_ptr<FutureContext>& context);
+
+    /**
+     * @brief run Call fn, store its result or exception and wake waiters.
+     */
+    template <typename Fn>
+    void run(Fn& fn);
+
+    void setException(std::exception_ptr error);
+
+    bool ready() const;
+
+    void wait();
+
+    R get();
+
+    void release();
+
+private:
+    explicit FutureState(const std::shared_ptr<FutureContext>& context, bool in_slab);
+
+    void complete();
+
+    std::atomic<int> m_refs;
+    std::atomic<bool> m_ready;
+    bool m_in_slab;
+    std::exception_ptr m_error;
+    FutureValue<R> m_value;
+    std::shared_ptr<FutureContext> m_context;
+};
+
+/**
+ * @brief The SubmitTraits class names the bound callable stored by submit
+ * and the type of its result.
+ */
+template <typename F, typename... Args>
+struct SubmitTraits
+{
+    typedef decltype(std::bind(std::declval<F>(), std::declval<Args>()...)) Fn;
+    typedef typename std::result_of<Fn&()>::type Result;
+};
+
+/**
+ * @brief The SubmitTask class is the handler posted by submit: it runs the
+ * bound callable and fulfills the future. If it is destroyed without being
+ * run the future fails with std::runtime_error.
+ */
+template <typename R, typename Fn>
+class SubmitTask
+{
+public:
+    SubmitTask(Fn&& fn, FutureState<R>* state)
+        : m_fn(std::move(fn)), m_state(state)
+    {}
+
+    SubmitTask(SubmitTask&& rhs)
+        : m_fn(std::move(rhs.m_fn)), m_state(rhs.m_state)
+    {
+        rhs.m_state = nullptr;
+    }
+
+    ~SubmitTask()
+    {
+        if (m_state) {
+            m_state->setException(std::make_exception_ptr(
+                std::runtime_error("task dropped before it was run")));
+            m_state->release();
+        }
+    }
+
+    void operator()()
+    {
+        FutureState<R>* state = m_state;
+        m_state = nullptr;
+        state->run(m_fn);
+        state->release();
+    }
+
+private:
+    SubmitTask(const SubmitTask&) = delete;
+    SubmitTask& operator=(const SubmitTask&) = delete;
+    SubmitTask& operator=(SubmitTask&&) = delete;
+
+    Fn m_fn;
+    FutureState<R>* m_state;
+};
+
+}
+
+/**
+ * @brief The Future class holds the result of a handler passed to
+ * ThreadPoolImpl::submit.
+ * Unlike std::future it does not allocate: its state lives in a slab owned
+ * by the pool. Waiting spins briefly and then parks.
+ * @note Waiting from a worker of the same pool on a task that is still
+ * queued may deadlock if no other worker is available.
+ */
+template <typename R>
+class Future
+{
+public:
+    Future() : m_state(nullptr) {}
+
+    explicit Future(detail::FutureState<R>* state) : m_state(state) {}
+
+    Future(Future&& rhs) noexcept : m_state(rhs.m_state)
+    {
+        rhs.m_state = nullptr;
+    }
+
+    Future& operator=(Future&& rhs) noexcept
+    {
+        if (this != &rhs) {
+            reset();
+            m_state = rhs.m_state;
+            rhs.m_state = nullptr;
+        }
+        return *this;
+    }
+
+    ~Future()
+    {
+        reset();
+    }
+
+    /**
+     * @brief valid Check if the future refers to a result not yet taken.
+     */
+    bool valid() const
+    {
+        return m_state != nullptr;
+    }
+
+    /**
+     * @brief ready Check if the result is available without blocking.
+     * @throws std::runtime_error if the future is not valid.
+     */
+    bool ready() const
+    {
+        return checked()->ready();
+    }
+
+    /**
+     * @brief wait Block until the result is available.
+     * @throws std::runtime_error if the future is not valid.
+     */
+    void wait() const
+    {
+        checked()->wait();
+    }
+
+    /**
+     * @brief get Wait for and take the result. The future is not valid
+     * afterwards.
+     * @return Value returned by the handler.
+     * @throws Exception thrown by the handler, or std::runtime_error if the
+     * task was dropped unexecuted or the future is not valid.
+     */
+    R get()
+    {
+        detail::FutureState<R>* state = checked();
+        m_state = nullptr;
+        std::unique_ptr<detail::FutureState<R>, Releaser> guard(state);
+        return state->get();
+    }
+
+private:
+    Future(const Future&) = delete;
+    Future& operator=(const Future&) = delete;
+
+    struct Releaser
+    {
+        void operator()(detail::FutureState<R>* state) const
+        {
+            state->release();
+        }
+    };
+
+    detail::FutureState<R>* checked() const
+    {
+        if (!m_state) {
+            throw std::runtime_error("future has no state");
+        }
+        return m_state;
+    }
+
+    void reset()
+    {
+        if (m_state) {
+            m_state->release();
+            m_state = nullptr;
+        }
+    }
+
+    detail::FutureState<R>* m_state;
+};
+
+
+/// Implementation
+
+namespace detail
+{
+
+template <typename R>
+inline FutureState<R>* FutureState<R>::create(const std::shared_ptr<FutureContext>& context)
+{
+    void* block = nullptr;
+    if (sizeof(FutureState) <= context->slab().blockSize() &&
+        alignof(FutureState) <= SlabAllocator::BLOCK_ALIGNMENT) {
+        block = context->slab().allocate();
+    }
+    if (block) {
+        return new (block) FutureState(context, true);
+    }
+    return new FutureState(context, false);
+}
+
+template <typename R>
+inline FutureState<R>::FutureState(const std::shared_ptr<FutureContext>& context, bool in_slab)
+    : m_refs(2)
+    , m_ready(false)
+    , m_in_slab(in_slab)
+    , m_context(context)
+{
+}
+
+template <typename R>
+template <typename Fn>
+inline void FutureState<R>::run(Fn& fn)
+{
+    try {
+        m_value.run(fn);
+    } catch (...) {
+        m_error = std::current_exception();
+    }
+    complete();
+}
+
+template <typename R>
+inline void FutureState<R>::setException(std::exception_ptr error)
+{
+    m_error = error;
+    complete();
+}
+
+template <typename R>
+inline bool FutureState<R>::ready() const
+{
+    return m_ready.load(std::memory_order_acquire);
+}
+
+template <typename R>
+inline void FutureState<R>::wait()
+{
+    for (int spin = 0; spin < 64; ++spin) {
+        if (ready()) {
+            return;
+        }
+        detail::cpu_relax();
+    }
+
+    EventCount& event = m_context->event();
+    while (!ready()) {
+        auto key = event.prepareWait();
+        if (ready()) {
+            event.cancelWait();
+            return;
+        }
+        event.commitWait(key);
+    }
+}
+
+template <typename R>
+inline R FutureState<R>::get()
+{
+    wait();
+    if (m_error) {
+        std::rethrow_exception(m_error);
+    }
+    return m_value.take();
+}
+
+template <typename R>
+inline void FutureState<R>::release()
+{
+    if (m_refs.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        return;
+    }
+
+    // Keep the slab alive until the block is returned to it.
+    std::shared_ptr<FutureContext> context = std::move(m_context);
+    if (m_in_slab) {
+        this->~FutureState();
+        context->slab().deallocate(this);
+    } else {
+        delete this;
+    }
+}
+
+template <typename R>
+inline void FutureState<R>::complete()
+{
+    m_ready.store(true, std::memory_order_release);
+    m_context->event().notifyAll();
+}
+
+}
+
+}
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <thread_pool/stats.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace tp
+{
+
+/**
+ * @brief The LatencyHistogram class counts durations in log-linear buckets,
+ * like an HDR histogram: each power of 2 range of nanoseconds is split into
+ * SUB_BUCKETS equal buckets, so any value is known within 1/SUB_BUCKETS of
+ * itself while the whole 64 bit range takes BUCKET_COUNT counters.
+ */
+class LatencyHistogram
+{
+public:
+    static const size_t SUB_BUCKET_BITS = 4;
+    static const size_t SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+    static const size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    /**
+     * @brief LatencyHistogram Construct an empty histogram.
+     */
+    LatencyHistogram();
+
+    /**
+     * @brief record Count a duration. Negative durations count as 0.
+     */
+    void record(std::chrono::nanoseconds value);
+
+    /**
+     * @brief merge Add the counts of another histogram.
+     */
+    void merge(const LatencyHistogram& other);
+
+    /**
+     * @brief count Return the number of recorded durations.
+     */
+    std::uint64_t count() const;
+
+    /**
+     * @brief percentile Return the duration below or at which percent of
+     * the recorded durations are, rounded up to the end of its bucket.
+     * @param percent Percentile, clamped to [0, 100].
+     * @return Duration, 0 if the histogram is empty.
+     */
+    std::chrono::nanoseconds percentile(double percent) const;
+
+    /**
+     * @brief max Return the end of the highest non-empty bucket.
+     */
+    std::chrono::nanoseconds max() const;
+
+    /**
+     * @brief bucketOf Return the bucket counting value in nanoseconds.
+     */
+    static size_t bucketOf(std::uint64_t value);
+
+    /**
+     * @brief bucketEnd Return the highest value counted by bucket.
+     */
+    static std::uint64_t bucketEnd(size_t bucket);
+
+    /**
+     * @brief bucketCount Return the count of a bucket.
+     */
+    std::uint64_t bucketCount(size_t bucket) const;
+
+    /**
+     * @brief addToBucket Add count to a bucket.
+     */
+    void addToBucket(size_t bucket, std::uint64_t count);
+
+private:
+    std::vector<std::uint64_t> m_buckets;
+    std::uint64_t m_count;
+};
+
+namespace detail
+{
+    /**
+     * @brief The AtomicHistogram class is a LatencyHistogram written by a
+     * single thread and read by any thread without a lock.
+     */
+    class AtomicHistogram
+    {
+    public:
+        AtomicHistogram()
+            : m_buckets(new std::atomic<std::uint64_t>[LatencyHistogram::BUCKET_COUNT])
+        {
+            for (size_t bucket = 0; bucket < LatencyHistogram::BUCKET_COUNT; ++bucket) {
+                m_buckets[bucket].store(0, std::memory_order_relaxed);
+            }
+        }
+
+        /**
+         * @brief record Count a duration. Owner thread only.
+         */
+        void record(std::chrono::nanoseconds value)
+        {
+            const std::uint64_t ns = value.count() > 0 ? static_cast<std::uint64_t>(value.count()) : 0;
+            bump(m_buckets[LatencyHistogram::bucketOf(ns)]);
+        }
+
+        /**
+         * @brief mergeInto Add the current counts to histogram.
+         */
+        void mergeInto(LatencyHistogram& histogram) const
+        {
+            for (size_t bucket = 0; bucket < LatencyHistogram::BUCKET_COUNT; ++bucket) {
+                const std::uint64_t count = m_buckets[bucket].load(std::memory_order_relaxed);
+                if (count) {
+                    histogram.addToBucket(bucket, count);
+                }
+            }
+        }
+
+    private:
+        std::unique_ptr<std::atomic<std::uint64_t>[]> m_buckets;
+    };
+}
+
+
+/// Implementation
+
+inline LatencyHistogram::LatencyHistogram()
+    : m_buckets(BUCKET_COUNT, 0)
+    , m_count(0)
+{
+}
+
+inline void LatencyHistogram::record(std::chrono::nanoseconds value)
+{
+    addToBucket(bucketOf(value.count() > 0 ? static_cast<std::uint64_t>(value.count()) : 0), 1);
+}
+
+inline void LatencyHistogram::merge(const LatencyHistogram& other)
+{
+    for (size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+        m_buckets[bucket] += other.m_buckets[bucket];
+    }
+    m_count += other.m_count;
+}
+
+inline std::uint64_t LatencyHistogram::count() const
+{
+    return m_count;
+}
+
+inline std::chrono::nanoseconds LatencyHistogram::percentile(double percent) const
+{
+    if (m_count == 0) {
+        return std::chrono::nanoseconds(0);
+    }
+    percent = std::min(100.0, std::max(0.0, percent));
+    const std::uint64_t rank = std::max<std::uint64_t>(
+        1, static_cast<std::uint64_t>(std::ceil(percent / 100.0 * static_cast<double>(m_count))));
+    std::uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+        seen += m_buckets[bucket];
+        if (seen >= rank) {
+            return std::chrono::nanoseconds(static_cast<std::chrono::nanoseconds::rep>(bucketEnd(bucket)));
+        }
+    }
+    return max();
+}
+
+inline std::chrono::nanoseconds LatencyHistogram::max() const
+{
+    for (size_t bucket = BUCKET_COUNT; bucket-- > 0;) {
+        if (m_buckets[bucket]) {
+            return std::chrono::nanoseconds(static_cast<std::chrono::nanoseconds::rep>(bucketEnd(bucket)));
+        }
+    }
+    return std::chrono::nanoseconds(0);
+}
+
+inline size_t LatencyHistogram::bucketOf(std::uint64_t value)
+{
+    if (value < SUB_BUCKETS) {
+        return static_cast<size_t>(value);
+    }
+#if defined(__GNUC__) || defined(__clang__)
+    const size_t exponent = 63 - static_cast<size_t>(__builtin_clzll(value));
+#else
+    size_t exponent = SUB_BUCKET_BITS;
+    while (exponent < 63 && (value >> (exponent + 1)) != 0) {
+        ++exponent;
+    }
+#endif
+    const size_t shift = exponent - SUB_BUCKET_BITS;
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + static_cast<size_t>((value >> shift) & (SUB_BUCKETS - 1));
+}
+
+inline std::uint64_t LatencyHistogram::bucketEnd(size_t bucket)
+{
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    const size_t shift = bucket / SUB_BUCKETS - 1;
+    const std::uint64_t first = (std::uint64_t(SUB_BUCKETS) + bucket % SUB_BUCKETS) << shift;
+    return first + ((std::uint64_t(1) << shift) - 1);
+}
+
+inline std::uint64_t LatencyHistogram::bucketCount(size_t bucket) const
+{
+    return m_buckets[bucket];
+}
+
+inline void LatencyHistogram::addToBucket(size_t bucket, std::uint64_t count)
+{
+    m_buckets[bucket] += count;
+    m_count += count;
+}
+
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+/**
+ * Compile-time selected logging for the thread pool internals.
+ * Define THREAD_POOL_ENABLE_LOGGING to route TP_LOG_* through spdlog.
+ * Otherwise the macros expand to nothing: arguments are not evaluated and
+ * spdlog is not required at all.
+ */
+#if defined(THREAD_POOL_ENABLE_LOGGING)
+
+#include <spdlog/spdlog.h>
+
+#define TP_LOG_DEBUG(...) spdlog::debug(__VA_ARGS__)
+#define TP_LOG_WARN(...) spdlog::warn(__VA_ARGS__)
+
+#else
+
+#define TP_LOG_DEBUG(...) ((void)0)
+#define TP_LOG_WARN(...) ((void)0)
+
+#endif
@@ -36,14 +36,29 @@
 
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <cstdint>
+#include <memory>
+#include <new>
 #include <type_traits>
-#include <vector>
 #include <stdexcept>
 
 namespace tp
 {
 
+/**
+ * @brief The CacheAlignedCells trait selects the cell layout of
+ * MPMCBoundedQueue<T>. When true every cell starts on its own cache line,
+ * so producers and consumers working on neighbouring cells do not false
+ * share. Enabled by default for payloads of a cache line or more, where
+ * the padding costs less than half of the cell. Specialize to override.
+ */
+template <typename T>
+struct CacheAlignedCells : std::integral_constant<bool, (sizeof(T) >= 64)>
+{
+};
+
 /**
  * @brief The MPMCBoundedQueue class implements bounded
  * multi-producers/multi-consumers lock-free queue.
@@ -75,6 +90,8 @@ public:
      */
     MPMCBoundedQueue& operator=(MPMCBoundedQueue&& rhs) noexcept;
 
+    ~MPMCBoundedQueue();
+
     /**
      * @brief push Push data to queue.
      * @param data Data to be pushed.
@@ -90,8 +107,50 @@ public:
      */
     bool pop(T& data);
 
+    /**
+     * @brief push_bulk Push up to count elements claiming all their slots
+     * with a single CAS. Only the leading free slots are claimed, so fewer
+     * than count elements may be pushed while a consumer still holds the
+     * next slot; the call never waits for it.
+     * @param first Iterator to the elements. Exactly the returned number of
+     * elements is moved from it.
+     * @param count Number of elements available from first.
+     * @return Number of elements pushed, 0 if the queue is full or its
+     * first free slot is still being popped.
+     */
+    template <typename InputIt>
+    size_t push_bulk(InputIt first, size_t count);
+
+    /**
+     * @brief pop_bulk Pop up to count elements claiming all their slots
+     * with a single CAS. Only the leading filled slots are claimed, so
+     * fewer than count elements may be popped while a producer still
+     * fills the next slot; the call never waits for it.
+     * @param out Iterator receiving popped elements.
+     * @param count Maximum number of elements to pop.
+     * @return Number of elements popped, 0 if the queue is empty or its
+     * first element is still being pushed.
+     */
+    template <typename OutputIt>
+    size_t pop_bulk(OutputIt out, size_t count);
+
+    /**
+     * @brief size Return the number of queued elements. The result is a
+     * snapshot only and may be stale by the time it is returned.
+     */
+    size_t size() const;
+
 private:
-    struct Cell
+    static constexpr size_t max_align(size_t a, size_t b)
+    {
+        return a > b ? a : b;
+    }
+
+    static constexpr size_t CELL_ALIGNMENT = max_align(
+        CacheAlignedCells<T>::value ? 64 : 1,
+        max_align(alignof(T), alignof(std::atomic<size_t>)));
+
+    struct alignas(CELL_ALIGNMENT) Cell
     {
         std::atomic<size_t> sequence;
         T data;
@@ -100,26 +159,20 @@ private:
 
         Cell(const Cell&) = delete;
         Cell& operator=(const Cell&) = delete;
+    };
 
-        Cell(Cell&& rhs)
-            : sequence(rhs.sequence.load()), data(std::move(rhs.data))
-        {
-        }
-
-        Cell& operator=(Cell&& rhs)
-        {
-            sequence = rhs.sequence.load();
-            data = std::move(rhs.data);
+    MPMCBoundedQueue(const MPMCBoundedQueue&) = delete;
+    MPMCBoundedQueue& operator=(const MPMCBoundedQueue&) = delete;
 
-            return *this;
-        }
-    };
+    void destroy();
 
 private:
     typedef char Cacheline[64];
 
     Cacheline pad0;
-    std::vector<Cell> m_buffer;
+    // Raw storage, over-allocated so that cells honour CELL_ALIGNMENT.
+    std::unique_ptr<char[]> m_storage;
+    Cell* m_buffer;
     /* const */ size_t m_buffer_mask;
     Cacheline pad1;
     std::atomic<size_t> m_enqueue_pos;
@@ -131,9 +184,12 @@ private:
 
 /// Implementation
 
+template <typename T>
+constexpr size_t MPMCBoundedQueue<T>::CELL_ALIGNMENT;
+
 template <typename T>
 inline MPMCBoundedQueue<T>::MPMCBoundedQueue(size_t size)
-    : m_buffer(size), m_buffer_mask(size - 1), m_enqueue_pos(0),
+    : m_buffer(nullptr), m_buffer_mask(size - 1), m_enqueue_pos(0),
       m_dequeue_pos(0)
 {
     bool size_is_power_of_2 = (size >= 2) && ((size & (size - 1)) == 0);
@@ -142,16 +198,23 @@ inline MPMCBoundedQueue<T>::MPMCBoundedQueue(size_t size)
         throw std::invalid_argument("buffer size should be a power of 2");
     }
 
+    m_storage.reset(new char[size * sizeof(Cell) + CELL_ALIGNMENT]);
+    std::uintptr_t raw = reinterpret_cast<std::uintptr_t>(m_storage.get());
+    std::uintptr_t aligned = (raw + CELL_ALIGNMENT - 1) & ~std::uintptr_t(CELL_ALIGNMENT - 1);
+    m_buffer = reinterpret_cast<Cell*>(aligned);
+
     for(size_t i = 0; i < size; ++i)
     {
+        new(&m_buffer[i]) Cell();
         m_buffer[i].sequence = i;
     }
 }
 
 template <typename T>
 inline MPMCBoundedQueue<T>::MPMCBoundedQueue(MPMCBoundedQueue&& rhs) noexcept
+    : m_buffer(nullptr), m_buffer_mask(0), m_enqueue_pos(0), m_dequeue_pos(0)
 {
-    *this = rhs;
+    *this = std::move(rhs);
 }
 
 template <typename T>
@@ -159,14 +222,37 @@ inline MPMCBoundedQueue<T>& MPMCBoundedQueue<T>::operator=(MPMCBoundedQueue&& rh
 {
     if (this != &rhs)
     {
-        m_buffer = std::move(rhs.m_buffer);
-        m_buffer_mask = std::move(rhs.m_buffer_mask);
+        destroy();
+        m_storage = std::move(rhs.m_storage);
+        m_buffer = rhs.m_buffer;
+        m_buffer_mask = rhs.m_buffer_mask;
         m_enqueue_pos = rhs.m_enqueue_pos.load();
         m_dequeue_pos = rhs.m_dequeue_pos.load();
+        rhs.m_buffer = nullptr;
     }
     return *this;
 }
 
+template <typename T>
+inline MPMCBoundedQueue<T>::~MPMCBoundedQueue()
+{
+    destroy();
+}
+
+template <typename T>
+inline void MPMCBoundedQueue<T>::destroy()
+{
+    if (m_buffer)
+    {
+        for(size_t i = 0; i <= m_buffer_mask; ++i)
+        {
+            m_buffer[i].~Cell();
+        }
+        m_buffer = nullptr;
+    }
+    m_storage.reset();
+}
+
 template <typename T>
 template <typename U>
 inline bool MPMCBoundedQueue<T>::push(U&& data)
@@ -239,4 +325,116 @@ inline bool MPMCBoundedQueue<T>::pop(T& data)
     return true;
 }
 
+template <typename T>
+template <typename InputIt>
+inline size_t MPMCBoundedQueue<T>::push_bulk(InputIt first, size_t count)
+{
+    size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+    size_t n;
+    for(;;)
+    {
+        // Claim only the leading cells already released by consumers, so
+        // a slow peer never makes this push wait.
+        n = 0;
+        while(n < count)
+        {
+            Cell* cell = &m_buffer[(pos + n) & m_buffer_mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            if(seq != pos + n)
+            {
+                break;
+            }
+            ++n;
+        }
+        if(n == 0)
+        {
+            size_t seq = m_buffer[pos & m_buffer_mask].sequence.load(
+                std::memory_order_acquire);
+            if((intptr_t)seq - (intptr_t)pos < 0)
+            {
+                return 0;
+            }
+            // pos is stale, other producers moved past it.
+            pos = m_enqueue_pos.load(std::memory_order_relaxed);
+            continue;
+        }
+        if(m_enqueue_pos.compare_exchange_weak(
+               pos, pos + n, std::memory_order_relaxed))
+        {
+            break;
+        }
+    }
+
+    for(size_t i = 0; i < n; ++i, ++first)
+    {
+        Cell* cell = &m_buffer[(pos + i) & m_buffer_mask];
+        cell->data = std::move(*first);
+        cell->sequence.store(pos + i + 1, std::memory_order_release);
+    }
+
+    return n;
+}
+
+template <typename T>
+template <typename OutputIt>
+inline size_t MPMCBoundedQueue<T>::pop_bulk(OutputIt out, size_t count)
+{
+    size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+    size_t n;
+    for(;;)
+    {
+        // Claim only the leading cells already filled by producers, so a
+        // slow peer never makes this pop wait.
+        n = 0;
+        while(n < count)
+        {
+            Cell* cell = &m_buffer[(pos + n) & m_buffer_mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            if(seq != pos + n + 1)
+            {
+                break;
+            }
+            ++n;
+        }
+        if(n == 0)
+        {
+            size_t seq = m_buffer[pos & m_buffer_mask].sequence.load(
+                std::memory_order_acquire);
+            if((intptr_t)seq - (intptr_t)(pos + 1) < 0)
+            {
+                return 0;
+            }
+            // pos is stale, other consumers moved past it.
+            pos = m_dequeue_pos.load(std::memory_order_relaxed);
+            continue;
+        }
+        if(m_dequeue_pos.compare_exchange_weak(
+               pos, pos + n, std::memory_order_relaxed))
+        {
+            break;
+        }
+    }
+
+    for(size_t i = 0; i < n; ++i, ++out)
+    {
+        Cell* cell = &m_buffer[(pos + i) & m_buffer_mask];
+        *out = std::move(cell->data);
+        cell->sequence.store(
+            pos + i + m_buffer_mask + 1, std::memory_order_release);
+    }
+
+    return n;
+}
+
+template <typename T>
+inline size_t MPMCBoundedQueue<T>::size() const
+{
+    const size_t dequeue_pos = m_dequeue_pos.load(std::memory_order_relaxed);
+    const size_t enqueue_pos = m_enqueue_pos.load(std::memory_order_relaxed);
+    if (enqueue_pos <= dequeue_pos) {
+        return 0;
+    }
+    return std::min(enqueue_pos - dequeue_pos, m_buffer_mask + 1);
+}
+
 }
@@ -0,0 +1,258 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace tp
+{
+
+namespace detail
+{
+
+/**
+ * @brief The ParallelContext class tracks the chunks of one parallel call.
+ * It lives on the calling thread's stack, which waits for pending to drop
+ * to zero before returning.
+ */
+struct ParallelContext
+{
+    ParallelContext() : pending(0), failed(false) {}
+
+    void fail()
+    {
+        bool expected = false;
+        if (failed.compare_exchange_strong(expected, true)) {
+            error = std::current_exception();
+        }
+    }
+
+    std::atomic<size_t> pending;
+    std::atomic<bool> failed;
+    std::exception_ptr error;
+};
+
+template <typename Pool, typename Body>
+void runChunks(Pool& pool, ParallelContext& context, Body& body, size_t first, size_t last);
+
+/**
+ * @brief The ChunkTask class runs the chunks of a posted half. A task
+ * destroyed without having run, because the pool rejected or dropped it,
+ * runs them itself so the caller never waits forever.
+ */
+template <typename Pool, typename Body>
+class ChunkTask
+{
+public:
+    ChunkTask(Pool* pool, ParallelContext* context, Body* body, size_t first, size_t last)
+        : m_pool(pool), m_context(context), m_body(body), m_first(first), m_last(last)
+    {}
+
+    ChunkTask(ChunkTask&& rhs)
+        : m_pool(rhs.m_pool), m_context(rhs.m_context), m_body(rhs.m_body),
+          m_first(rhs.m_first), m_last(rhs.m_last)
+    {
+        rhs.m_context = nullptr;
+    }
+
+    ~ChunkTask()
+    {
+        if (m_context) {
+            run();
+        }
+    }
+
+    void operator()()
+    {
+        run();
+    }
+
+private:
+    ChunkTask(const ChunkTask&) = delete;
+    ChunkTask& operator=(const ChunkTask&) = delete;
+    ChunkTask& operator=(ChunkTask&&) = delete;
+
+    void run()
+    {
+        ParallelContext* context = m_context;
+        m_context = nullptr;
+        runChunks(*m_pool, *context, *m_body, m_first, m_last);
+        // Last access to the context, the caller may return right after.
+        context->pending.fetch_sub(1, std::memory_order_release);
+    }
+
+    Pool* m_pool;
+    ParallelContext* m_context;
+    Body* m_body;
+    size_t m_first;
+    size_t m_last;
+};
+
+/**
+ * @brief runChunks Run chunks [first, last), posting the upper half to the
+ * pool while the range holds more than one chunk. Idle workers pick up the
+ * halves and split them further, so load balances without a central
+ * scheduler. A half that cannot be posted runs inline.
+ */
+template <typename Pool, typename Body>
+void runChunks(Pool& pool, ParallelContext& context, Body& body, size_t first, size_t last)
+{
+    while (last - first > 1) {
+        const size_t middle = first + (last - first) / 2;
+
+        context.pending.fetch_add(1, std::memory_order_relaxed);
+        // A rejected half runs inline when the pool destroys it.
+        pool.tryPost(ChunkTask<Pool, Body>(&pool, &context, &body, middle, last));
+        last = middle;
+    }
+
+    if (!context.failed.load(std::memory_order_relaxed)) {
+        try {
+            body(first);
+        } catch (...) {
+            context.fail();
+        }
+    }
+}
+
+/**
+ * @brief parallelChunks Run body(chunk) for every chunk in [0, chunks) on
+ * the pool and the calling thread, which runs pending pool tasks while
+ * waiting for the others.
+ * @throws The first exception thrown by body.
+ */
+template <typename Pool, typename Body>
+void parallelChunks(Pool& pool, size_t chunks, Body& body)
+{
+    ParallelContext context;
+    if (chunks > 0) {
+        runChunks(pool, context, body, 0, chunks);
+    }
+
+    while (context.pending.load(std::memory_order_acquire) != 0) {
+        if (!pool.runPendingTask()) {
+            std::this_thread::yield();
+        }
+    }
+
+    if (context.error) {
+        std::rethrow_exception(context.error);
+    }
+}
+
+/**
+ * @brief The Partial struct holds the result of one parallel_reduce chunk
+ * in an element of its own.
+ */
+template <typename T>
+struct Partial
+{
+    explicit Partial(const T& v) : value(v) {}
+
+    T value;
+};
+
+/**
+ * @brief chunkCount Split count items into chunks of grain items. A zero
+ * grain picks one giving a few chunks per thread, enough to balance load
+ * without paying for tiny tasks.
+ */
+inline size_t chunkCount(size_t count, size_t grain, size_t threads, size_t& chunk_size)
+{
+    if (grain == 0) {
+        const size_t target = 4 * (threads + 1);
+        grain = std::max<size_t>(1, (count + target - 1) / target);
+    }
+    chunk_size = grain;
+    return (count + grain - 1) / grain;
+}
+
+}
+
+/**
+ * @brief parallel_for Call f(i) for every i in [begin, end) on the pool.
+ * The range is cut into chunks of grain indices which are split
+ * recursively among the workers. The calling thread takes part in the
+ * work and returns once every index was processed.
+ * @param pool Thread pool. In critical mode halves that find no free
+ * worker run on the calling thread.
+ * @param grain Indices per chunk, 0 to pick it from the range size and the
+ * number of threads.
+ * @throws The first exception thrown by f. Chunks not yet started when it
+ * was thrown are skipped.
+ */
+template <typename Pool, typename Index, typename F>
+void parallel_for(Pool& pool, Index begin, Index end, Index grain, F f)
+{
+    static_assert(std::is_integral<Index>::value, "Index should be integral");
+
+    if (!(begin < end)) {
+        return;
+    }
+
+    size_t chunk_size;
+    const size_t count = static_cast<size_t>(end - begin);
+    const size_t chunks = detail::chunkCount(count, static_cast<size_t>(grain), pool.threadCount(), chunk_size);
+
+    auto body = [&](size_t chunk) {
+        const Index first = static_cast<Index>(begin + chunk * chunk_size);
+        const Index last = static_cast<Index>(std::min(count, (chunk + 1) * chunk_size) + begin);
+        for (Index i = first; i < last; ++i) {
+            f(i);
+        }
+    };
+    detail::parallelChunks(pool, chunks, body);
+}
+
+/**
+ * @brief parallel_reduce Reduce map(i) over [begin, end) on the pool.
+ * Every chunk folds its indices starting from identity, then the partial
+ * results are folded in index order on the calling thread, so reduce only
+ * needs to be associative, not commutative.
+ * @param pool Thread pool.
+ * @param grain Indices per chunk, 0 to pick it from the range size and the
+ * number of threads.
+ * @param identity Neutral element of reduce.
+ * @param map Called as map(i), returns a value convertible to T.
+ * @param reduce Called as reduce(T, T), returns T.
+ * @return identity for an empty range.
+ * @throws The first exception thrown by map or reduce.
+ */
+template <typename Pool, typename Index, typename T, typename Map, typename Reduce>
+T parallel_reduce(Pool& pool, Index begin, Index end, Index grain, T identity, Map map, Reduce reduce)
+{
+    static_assert(std::is_integral<Index>::value, "Index should be integral");
+
+    if (!(begin < end)) {
+        return identity;
+    }
+
+    size_t chunk_size;
+    const size_t count = static_cast<size_t>(end - begin);
+    const size_t chunks = detail::chunkCount(count, static_cast<size_t>(grain), pool.threadCount(), chunk_size);
+
+    // Wrapped, so std::vector<bool> cannot pack partials into shared words.
+    std::vector<detail::Partial<T>> partials(chunks, detail::Partial<T>(identity));
+    auto body = [&](size_t chunk) {
+        const Index first = static_cast<Index>(begin + chunk * chunk_size);
+        const Index last = static_cast<Index>(std::min(count, (chunk + 1) * chunk_size) + begin);
+        T value = identity;
+        for (Index i = first; i < last; ++i) {
+            value = reduce(value, map(i));
+        }
+        partials[chunk].value = value;
+    };
+    detail::parallelChunks(pool, chunks, body);
+
+    T result = identity;
+    for (const auto& partial : partials) {
+        result = reduce(result, partial.value);
+    }
+    return result;
+}
+
+}
@@ -0,0 +1,281 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace tp
+{
+
+/**
+ * @brief The RingBuffer class is a contiguous FIFO container usable as the
+ * Container of std::queue and SafeQueue.
+ * Storage for 'capacity' elements is allocated once up front, so a queue
+ * bounded by that capacity never allocates in steady state. Pushing into a
+ * full buffer doubles the storage, which keeps unbounded queues working.
+ */
+template <typename T>
+class RingBuffer
+{
+public:
+    typedef T value_type;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef std::size_t size_type;
+
+    /**
+     * @brief RingBuffer Constructor.
+     * @param capacity Number of elements to preallocate storage for.
+     */
+    explicit RingBuffer(size_type capacity = 0);
+
+    RingBuffer(const RingBuffer& rhs);
+    RingBuffer(RingBuffer&& rhs) noexcept;
+    RingBuffer& operator=(const RingBuffer& rhs);
+    RingBuffer& operator=(RingBuffer&& rhs) noexcept;
+    ~RingBuffer();
+
+    reference front();
+    const_reference front() const;
+    reference back();
+    const_reference back() const;
+
+    void push_back(const value_type& value);
+    void push_back(value_type&& value);
+
+    template <typename... Args>
+    void emplace_back(Args&&... args);
+
+    void pop_front();
+
+    size_type size() const;
+    bool empty() const;
+
+    /**
+     * @brief capacity Number of elements that fit without reallocation.
+     */
+    size_type capacity() const;
+
+    void swap(RingBuffer& rhs) noexcept;
+
+private:
+    typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Storage;
+
+    T* slot(size_type index) const;
+    void grow();
+    void clear();
+
+    std::unique_ptr<Storage[]> m_storage;
+    size_type m_capacity;
+    size_type m_head;
+    size_type m_size;
+};
+
+template <typename T>
+inline void swap(RingBuffer<T>& lhs, RingBuffer<T>& rhs) noexcept
+{
+    lhs.swap(rhs);
+}
+
+/**
+ * @brief The ContainerFactory class builds the container of a SafeQueue
+ * holding at most max_num_items elements. Specialize it for containers
+ * able to preallocate.
+ */
+template <typename Container>
+struct ContainerFactory
+{
+    static Container create(std::size_t)
+    {
+        return Container();
+    }
+};
+
+template <typename T>
+struct ContainerFactory<RingBuffer<T>>
+{
+    static RingBuffer<T> create(std::size_t max_num_items)
+    {
+        return RingBuffer<T>(max_num_items);
+    }
+};
+
+
+/// Implementation
+
+template <typename T>
+inline RingBuffer<T>::RingBuffer(size_type capacity)
+    : m_storage(capacity ? new Storage[capacity] : nullptr)
+    , m_capacity(capacity)
+    , m_head(0)
+    , m_size(0)
+{
+}
+
+template <typename T>
+inline RingBuffer<T>::RingBuffer(const RingBuffer& rhs)
+    : RingBuffer(rhs.m_capacity)
+{
+    for (size_type i = 0; i < rhs.m_size; ++i) {
+        push_back(*rhs.slot(i));
+    }
+}
+
+template <typename T>
+inline RingBuffer<T>::RingBuffer(RingBuffer&& rhs) noexcept
+    : m_storage(std::move(rhs.m_storage))
+    , m_capacity(rhs.m_capacity)
+    , m_head(rhs.m_head)
+    , m_size(rhs.m_size)
+{
+    rhs.m_capacity = 0;
+    rhs.m_head = 0;
+    rhs.m_size = 0;
+}
+
+template <typename T>
+inline RingBuffer<T>& RingBuffer<T>::operator=(const RingBuffer& rhs)
+{
+    if (this != &rhs) {
+        RingBuffer copy(rhs);
+        swap(copy);
+    }
+    return *this;
+}
+
+template <typename T>
+inline RingBuffer<T>& RingBuffer<T>::operator=(RingBuffer&& rhs) noexcept
+{
+    if (this != &rhs) {
+        clear();
+        m_storage = std::move(rhs.m_storage);
+        m_capacity = rhs.m_capacity;
+        m_head = rhs.m_head;
+        m_size = rhs.m_size;
+        rhs.m_capacity = 0;
+        rhs.m_head = 0;
+        rhs.m_size = 0;
+    }
+    return *this;
+}
+
+template <typename T>
+inline RingBuffer<T>::~RingBuffer()
+{
+    clear();
+}
+
+template <typename T>
+inline typename RingBuffer<T>::reference RingBuffer<T>::front()
+{
+    return *slot(0);
+}
+
+template <typename T>
+inline typename RingBuffer<T>::const_reference RingBuffer<T>::front() const
+{
+    return *slot(0);
+}
+
+template <typename T>
+inline typename RingBuffer<T>::reference RingBuffer<T>::back()
+{
+    return *slot(m_size - 1);
+}
+
+template <typename T>
+inline typename RingBuffer<T>::const_reference RingBuffer<T>::back() const
+{
+    return *slot(m_size - 1);
+}
+
+template <typename T>
+inline void RingBuffer<T>::push_back(const value_type& value)
+{
+    emplace_back(value);
+}
+
+template <typename T>
+inline void RingBuffer<T>::push_back(value_type&& value)
+{
+    emplace_back(std::move(value));
+}
+
+template <typename T>
+template <typename... Args>
+inline void RingBuffer<T>::emplace_back(Args&&... args)
+{
+    if (m_size == m_capacity) {
+        grow();
+    }
+    new (slot(m_size)) T(std::forward<Args>(args)...);
+    ++m_size;
+}
+
+template <typename T>
+inline void RingBuffer<T>::pop_front()
+{
+    slot(0)->~T();
+    m_head = (m_head + 1 == m_capacity) ? 0 : m_head + 1;
+    --m_size;
+}
+
+template <typename T>
+inline typename RingBuffer<T>::size_type RingBuffer<T>::size() const
+{
+    return m_size;
+}
+
+template <typename T>
+inline bool RingBuffer<T>::empty() const
+{
+    return m_size == 0;
+}
+
+template <typename T>
+inline typename RingBuffer<T>::size_type RingBuffer<T>::capacity() const
+{
+    return m_capacity;
+}
+
+template <typename T>
+inline void RingBuffer<T>::swap(RingBuffer& rhs) noexcept
+{
+    std::swap(m_storage, rhs.m_storage);
+    std::swap(m_capacity, rhs.m_capacity);
+    std::swap(m_head, rhs.m_head);
+    std::swap(m_size, rhs.m_size);
+}
+
+template <typename T>
+inline T* RingBuffer<T>::slot(size_type index) const
+{
+    size_type pos = m_head + index;
+    if (pos >= m_capacity) {
+        pos -= m_capacity;
+    }
+    return reinterpret_cast<T*>(&m_storage[pos]);
+}
+
+template <typename T>
+inline void RingBuffer<T>::grow()
+{
+    RingBuffer bigger(m_capacity ? m_capacity * 2 : 1);
+    while (!empty()) {
+        bigger.push_back(std::move(front()));
+        pop_front();
+    }
+    swap(bigger);
+}
+
+template <typename T>
+inline void RingBuffer<T>::clear()
+{
+    while (!empty()) {
+        pop_front();
+    }
+}
+
+}
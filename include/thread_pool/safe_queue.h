@@ -27,7 +27,8 @@
 #include <cstdint>
 #include <condition_variable>
 
-#include <spdlog/spdlog.h>
+#include <thread_pool/logging.hpp>
+#include <thread_pool/ring_buffer.hpp>
 
 namespace tp {
 
@@ -58,7 +59,7 @@ public:
      * @param max_num_items
      */
     SafeQueue(unsigned int max_num_items)
-        : m_queue()
+        : m_queue(ContainerFactory<Container>::create(max_num_items))
         , m_max_num_items(max_num_items) {}
 
     /**
@@ -202,6 +203,32 @@ public:
         return true;
     }
 
+    /**
+     * @brief try_move_push_bulk Move ownership and pushes up to count items into the queue under a single lock. Not blocking call.
+     * @param first Iterator to the items. Only the pushed items are moved from.
+     * @param count Number of items available from first.
+     * @return number of items that were pushed into the queue
+     */
+    template <class InputIt>
+    size_type try_move_push_bulk (InputIt first, size_type count)
+    {
+        std::unique_lock<std::mutex> lock (m_mutex);
+
+        size_type pushed = 0;
+        while (pushed < count && !(m_max_num_items > 0 && m_queue.size() >= m_max_num_items)) {
+            m_queue.push (std::move(*first));
+            ++first;
+            ++pushed;
+        }
+
+        if (pushed > 1) {
+            m_non_empty_condition.notify_all();
+        } else if (pushed == 1) {
+            m_non_empty_condition.notify_one();
+        }
+        return pushed;
+    }
+
 #ifdef __freertos__
     using uint = uint32_t;
 #endif
@@ -350,7 +377,7 @@ public:
                 return false;
             }
             if (m_queue.empty()) {
-                spdlog::debug("safequeue::timeout_move_pop. spurious wake up. Retuning false");
+                TP_LOG_DEBUG("safequeue::timeout_move_pop. spurious wake up. Retuning false");
                 return false;
             }
         }
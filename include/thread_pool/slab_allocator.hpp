@@ -0,0 +1,144 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+namespace tp
+{
+
+/**
+ * @brief The SlabAllocator class hands out fixed size memory blocks from a
+ * single preallocated slab.
+ * Free blocks form a lock-free stack threaded through an index array. The
+ * head carries a tag bumped on every push, so a block popped and pushed
+ * back between a load and a CAS does not corrupt the stack (ABA).
+ * Blocks start on a cache line, so neighbouring blocks never false share.
+ */
+class SlabAllocator
+{
+public:
+    static const size_t BLOCK_ALIGNMENT = 64;
+
+    /**
+     * @brief SlabAllocator Constructor.
+     * @param block_count Number of blocks in the slab.
+     * @param block_size Minimum size of a block. Rounded up to a multiple
+     * of BLOCK_ALIGNMENT.
+     * @throws std::invalid_argument if block_count does not fit the index.
+     */
+    SlabAllocator(size_t block_count, size_t block_size);
+
+    /**
+     * @brief allocate Take a free block.
+     * @return Block of blockSize() bytes or nullptr if the slab is exhausted.
+     */
+    void* allocate();
+
+    /**
+     * @brief deallocate Return a block taken by allocate.
+     * @param block Block owned by this slab.
+     */
+    void deallocate(void* block);
+
+    /**
+     * @brief owns Check if the pointer is a block of this slab.
+     */
+    bool owns(const void* ptr) const;
+
+    /**
+     * @brief blockSize Usable size of a block.
+     */
+    size_t blockSize() const;
+
+private:
+    SlabAllocator(const SlabAllocator&) = delete;
+    SlabAllocator& operator=(const SlabAllocator&) = delete;
+
+    static const std::uint32_t NIL = 0xffffffffu;
+
+    static std::uint64_t pack(std::uint32_t tag, std::uint32_t index);
+
+    size_t m_block_count;
+    size_t m_block_size;
+    std::unique_ptr<char[]> m_storage;
+    char* m_blocks;
+    std::unique_ptr<std::atomic<std::uint32_t>[]> m_next;
+    std::atomic<std::uint64_t> m_head;
+};
+
+
+/// Implementation
+
+inline SlabAllocator::SlabAllocator(size_t block_count, size_t block_size)
+    : m_block_count(block_count)
+    , m_block_size((block_size + BLOCK_ALIGNMENT - 1) / BLOCK_ALIGNMENT * BLOCK_ALIGNMENT)
+    , m_blocks(nullptr)
+    , m_head(pack(0, NIL))
+{
+    if (block_count >= NIL) {
+        throw std::invalid_argument("too many slab blocks");
+    }
+    if (block_count == 0) {
+        return;
+    }
+
+    m_storage.reset(new char[m_block_count * m_block_size + BLOCK_ALIGNMENT]);
+    std::uintptr_t raw = reinterpret_cast<std::uintptr_t>(m_storage.get());
+    m_blocks = reinterpret_cast<char*>((raw + BLOCK_ALIGNMENT - 1) & ~std::uintptr_t(BLOCK_ALIGNMENT - 1));
+
+    m_next.reset(new std::atomic<std::uint32_t>[m_block_count]);
+    for (size_t i = 0; i < m_block_count; ++i) {
+        m_next[i].store(i + 1 < m_block_count ? static_cast<std::uint32_t>(i + 1) : NIL,
+                        std::memory_order_relaxed);
+    }
+    m_head.store(pack(0, 0), std::memory_order_release);
+}
+
+inline void* SlabAllocator::allocate()
+{
+    std::uint64_t head = m_head.load(std::memory_order_acquire);
+    for (;;) {
+        std::uint32_t index = static_cast<std::uint32_t>(head);
+        if (index == NIL) {
+            return nullptr;
+        }
+        std::uint32_t next = m_next[index].load(std::memory_order_relaxed);
+        if (m_head.compare_exchange_weak(head, pack(static_cast<std::uint32_t>(head >> 32), next),
+                                         std::memory_order_acquire, std::memory_order_acquire)) {
+            return m_blocks + index * m_block_size;
+        }
+    }
+}
+
+inline void SlabAllocator::deallocate(void* block)
+{
+    std::uint32_t index = static_cast<std::uint32_t>((static_cast<char*>(block) - m_blocks) / m_block_size);
+    std::uint64_t head = m_head.load(std::memory_order_relaxed);
+    for (;;) {
+        m_next[index].store(static_cast<std::uint32_t>(head), std::memory_order_relaxed);
+        if (m_head.compare_exchange_weak(head, pack(static_cast<std::uint32_t>(head >> 32) + 1, index),
+                                         std::memory_order_release, std::memory_order_relaxed)) {
+            return;
+        }
+    }
+}
+
+inline bool SlabAllocator::owns(const void* ptr) const
+{
+    const char* p = static_cast<const char*>(ptr);
+    return m_blocks && p >= m_blocks && p < m_blocks + m_block_count * m_block_size;
+}
+
+inline size_t SlabAllocator::blockSize() const
+{
+    return m_block_size;
+}
+
+inline std::uint64_t SlabAllocator::pack(std::uint32_t tag, std::uint32_t index)
+{
+    return (std::uint64_t(tag) << 32) | index;
+}
+
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace tp
+{
+
+/**
+ * @brief The WorkerStats struct is a snapshot of the counters of a worker,
+ * or of all workers of a pool.
+ */
+struct WorkerStats
+{
+    /// Tasks run.
+    std::uint64_t executed;
+    /// Exceptions thrown by tasks and suppressed.
+    std::uint64_t exceptions;
+    /// Attempts to steal from siblings.
+    std::uint64_t steal_attempts;
+    /// Attempts that got a task.
+    std::uint64_t steals;
+    /// Most tasks seen in one queue of the worker right after a push to
+    /// it. The pool total also covers the shared queues. Only queues that
+    /// can be sized without a lock are counted, blocking queues are not.
+    std::uint64_t queue_high_water;
+    /// Time spent running tasks. Only valid if timed.
+    std::chrono::nanoseconds busy;
+    /// Time spent between tasks, up to the start of the latest task. Only
+    /// valid if timed.
+    std::chrono::nanoseconds idle;
+    /// True if busy and idle were measured, see
+    /// ThreadPoolOptions::setTimedStats.
+    bool timed;
+};
+
+/**
+ * @brief The PoolStats struct is a snapshot of the counters of a pool.
+ * Counters are read one by one while workers keep updating them, so they
+ * may be slightly out of step with each other.
+ */
+struct PoolStats
+{
+    /// Counters of each worker, by worker ID.
+    std::vector<WorkerStats> workers;
+    /// Sum of the worker counters, with the highest high-water mark.
+    WorkerStats total;
+    /// Tasks the pool refused to queue, because full or shut down.
+    std::uint64_t rejected;
+};
+
+namespace detail
+{
+    /**
+     * @brief bump Add to a counter written by a single thread. A relaxed
+     * load and store, without the cost of a read-modify-write.
+     */
+    inline void bump(std::atomic<std::uint64_t>& counter, std::uint64_t value = 1)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief raise Raise a counter written by any thread to value if lower.
+     * A relaxed load only, unless the counter grows.
+     */
+    inline void raise(std::atomic<std::uint64_t>& counter, std::uint64_t value)
+    {
+        std::uint64_t current = counter.load(std::memory_order_relaxed);
+        while (value > current &&
+               !counter.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    /**
+     * @brief The WorkerCounters struct holds the counters of a worker on
+     * cache lines of their own. Only the worker thread writes them, but
+     * queue_high_water that posters raise.
+     */
+    struct WorkerCounters
+    {
+        WorkerCounters()
+            : executed(0), exceptions(0), steal_attempts(0), steals(0),
+              queue_high_water(0), busy_ns(0), idle_ns(0)
+        {}
+
+        WorkerStats snapshot() const
+        {
+            WorkerStats stats;
+            stats.executed = executed.load(std::memory_order_relaxed);
+            stats.exceptions = exceptions.load(std::memory_order_relaxed);
+            stats.steal_attempts = steal_attempts.load(std::memory_order_relaxed);
+            stats.steals = steals.load(std::memory_order_relaxed);
+            stats.queue_high_water = queue_high_water.load(std::memory_order_relaxed);
+            stats.busy = std::chrono::nanoseconds(busy_ns.load(std::memory_order_relaxed));
+            stats.idle = std::chrono::nanoseconds(idle_ns.load(std::memory_order_relaxed));
+            stats.timed = false;
+            return stats;
+        }
+
+        typedef char Cacheline[64];
+
+        Cacheline pad0;
+        std::atomic<std::uint64_t> executed;
+        std::atomic<std::uint64_t> exceptions;
+        std::atomic<std::uint64_t> steal_attempts;
+        std::atomic<std::uint64_t> steals;
+        std::atomic<std::uint64_t> queue_high_water;
+        std::atomic<std::uint64_t> busy_ns;
+        std::atomic<std::uint64_t> idle_ns;
+        Cacheline pad1;
+    };
+
+    /**
+     * @brief The SharedCounter struct is a counter written by any thread,
+     * on a cache line of its own.
+     */
+    struct SharedCounter
+    {
+        SharedCounter() : value(0) {}
+
+        typedef char Cacheline[64];
+
+        Cacheline pad0;
+        std::atomic<std::uint64_t> value;
+        Cacheline pad1;
+    };
+}
+
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <thread_pool/cpu_relax.hpp>
+#include <thread_pool/fixed_function.hpp>
+#include <thread_pool/logging.hpp>
+#include <thread_pool/mpmc_bounded_queue.hpp>
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace tp
+{
+
+/**
+ * @brief The Strand class is a serial executor on top of a pool.
+ * Handlers posted through one strand run one at a time in posting order,
+ * so the state they share needs no lock, while different strands run in
+ * parallel on the pool's workers.
+ * Handlers wait in a lock-free queue with many producers and the strand as
+ * single consumer. The strand posts a drain task to the pool only when its
+ * first handler arrives, and the drain task keeps running handlers until
+ * none is left. After BATCH_SIZE handlers it reposts itself, so a busy
+ * strand does not monopolise a worker.
+ * Handlers still pending when the strand is destroyed run anyway.
+ */
+template <typename Pool, typename Task = FixedFunction<void(), 128>>
+class Strand
+{
+public:
+    static const size_t BATCH_SIZE = 64;
+
+    /**
+     * @brief Strand Constructor.
+     * @param pool Pool to run handlers on. Must outlive the handlers.
+     * @param queue_size Power of 2 number of handlers that may be pending.
+     * @throws std::invalid_argument if queue_size is bad.
+     */
+    explicit Strand(Pool& pool, size_t queue_size = 1024);
+
+    /**
+     * @brief tryPost Try post handler to the strand.
+     * @param handler Handler callable as 'handler()'.
+     * @return false if the strand queue is full.
+     * @note All exceptions thrown by handler will be suppressed.
+     */
+    template <typename Handler>
+    bool tryPost(Handler&& handler);
+
+    /**
+     * @brief post Post handler to the strand.
+     * @throw std::runtime_error if the strand queue is full.
+     */
+    template <typename Handler>
+    void post(Handler&& handler);
+
+private:
+    Strand(const Strand&) = delete;
+    Strand& operator=(const Strand&) = delete;
+
+    /**
+     * @brief The State class is shared by the strand and its drain task.
+     */
+    class State
+    {
+    public:
+        State(Pool& pool, size_t queue_size)
+            : m_pool(pool), m_queue(queue_size), m_pending(0)
+        {}
+
+        template <typename Handler>
+        bool push(Handler&& handler, const std::shared_ptr<State>& self);
+
+        void drain(const std::shared_ptr<State>& self);
+
+    private:
+        void schedule(const std::shared_ptr<State>& self);
+
+        /**
+         * @brief runBatch Run up to BATCH_SIZE handlers.
+         * @return true if handlers are left.
+         */
+        bool runBatch();
+
+        Pool& m_pool;
+        MPMCBoundedQueue<Task> m_queue;
+        std::atomic<size_t> m_pending;
+    };
+
+    std::shared_ptr<State> m_state;
+};
+
+
+/// Implementation
+
+template <typename Pool, typename Task>
+inline Strand<Pool, Task>::Strand(Pool& pool, size_t queue_size)
+    : m_state(std::make_shared<State>(pool, queue_size))
+{
+}
+
+template <typename Pool, typename Task>
+template <typename Handler>
+inline bool Strand<Pool, Task>::tryPost(Handler&& handler)
+{
+    return m_state->push(std::forward<Handler>(handler), m_state);
+}
+
+template <typename Pool, typename Task>
+template <typename Handler>
+inline void Strand<Pool, Task>::post(Handler&& handler)
+{
+    if (!tryPost(std::forward<Handler>(handler))) {
+        throw std::runtime_error("strand queue is full");
+    }
+}
+
+template <typename Pool, typename Task>
+template <typename Handler>
+inline bool Strand<Pool, Task>::State::push(Handler&& handler, const std::shared_ptr<State>& self)
+{
+    if (!m_queue.push(Task(std::forward<Handler>(handler)))) {
+        return false;
+    }
+    // Counting after the push guarantees the drain task finds the handler.
+    // Whoever takes the count off zero schedules the drain task.
+    if (m_pending.fetch_add(1, std::memory_order_acq_rel) == 0) {
+        schedule(self);
+    }
+    return true;
+}
+
+template <typename Pool, typename Task>
+inline void Strand<Pool, Task>::State::schedule(const std::shared_ptr<State>& self)
+{
+    for (;;) {
+        std::shared_ptr<State> state = self;
+        if (m_pool.tryPost([state]() { state->drain(state); })) {
+            return;
+        }
+        // The pool is full, run on this thread. Still serial, as the
+        // drain task is the only consumer.
+        if (!runBatch()) {
+            return;
+        }
+    }
+}
+
+template <typename Pool, typename Task>
+inline void Strand<Pool, Task>::State::drain(const std::shared_ptr<State>& self)
+{
+    if (runBatch()) {
+        schedule(self);
+    }
+}
+
+template <typename Pool, typename Task>
+inline bool Strand<Pool, Task>::State::runBatch()
+{
+    Task task;
+    for (size_t ran = 0; ran < BATCH_SIZE; ++ran) {
+        // Counted handlers are pushed, but a producer ahead of them may
+        // still be publishing its slot.
+        while (!m_queue.pop(task)) {
+            detail::cpu_relax();
+        }
+
+        try {
+            task();
+        } catch (...) {
+            // suppress all exceptions
+            TP_LOG_WARN("{}. Exception during execution of strand handler.", __PRETTY_FUNCTION__);
+        }
+        task = Task();
+
+        if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
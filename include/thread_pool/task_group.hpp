@@ -0,0 +1,217 @@
+#pragma once
+
+#include <thread_pool/event_count.hpp>
+
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace tp
+{
+
+namespace detail
+{
+
+/**
+ * @brief taskGroupEvent Event parked TaskGroup waiters wait on.
+ * It is shared by all groups and outlives them, so the last task of a
+ * group may notify it after the group was destroyed by a woken waiter.
+ */
+inline EventCount& taskGroupEvent()
+{
+    static EventCount event;
+    return event;
+}
+
+}
+
+/**
+ * @brief The TaskGroup class tracks a batch of tasks posted to a pool and
+ * waits for all of them.
+ * When wait() is called from a worker of the same pool the worker keeps
+ * running pending pool tasks instead of blocking its thread, so fork-join
+ * recursion works on a fixed size pool, including critical pools where
+ * each worker owns its queue. Other threads park until the group is done.
+ * @note The group must outlive its tasks: the destructor waits for them.
+ */
+template <typename Pool>
+class TaskGroup
+{
+public:
+    /**
+     * @brief TaskGroup Constructor.
+     * @param pool Pool to run tasks on.
+     */
+    explicit TaskGroup(Pool& pool);
+
+    /**
+     * @brief ~TaskGroup Wait for outstanding tasks, suppressing exceptions.
+     */
+    ~TaskGroup();
+
+    /**
+     * @brief run Post handler to the pool as part of this group.
+     * If the pool does not accept it, the handler runs on the calling
+     * thread, so run() never fails. A task dropped by a pool being
+     * destroyed runs on the thread destroying it.
+     * @param handler Handler callable as 'handler()'.
+     */
+    template <typename Handler>
+    void run(Handler&& handler);
+
+    /**
+     * @brief wait Wait until every task of the group finished.
+     * @throws The first exception thrown by a task of the group. The group
+     * may be reused afterwards.
+     */
+    void wait();
+
+    /**
+     * @brief pending Return the number of unfinished tasks.
+     */
+    size_t pending() const;
+
+private:
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    /**
+     * @brief The GroupTask class wraps a handler of the group. A wrapper
+     * destroyed without having run, because the pool rejected or dropped
+     * it, runs the handler itself so the group never waits forever.
+     */
+    template <typename Fn>
+    class GroupTask
+    {
+    public:
+        GroupTask(TaskGroup* group, Fn&& fn)
+            : m_group(group), m_fn(std::move(fn))
+        {}
+
+        GroupTask(GroupTask&& rhs)
+            : m_group(rhs.m_group), m_fn(std::move(rhs.m_fn))
+        {
+            rhs.m_group = nullptr;
+        }
+
+        ~GroupTask()
+        {
+            if (m_group) {
+                m_group->execute(m_fn);
+            }
+        }
+
+        void operator()()
+        {
+            TaskGroup* group = m_group;
+            m_group = nullptr;
+            group->execute(m_fn);
+        }
+
+    private:
+        GroupTask(const GroupTask&) = delete;
+        GroupTask& operator=(const GroupTask&) = delete;
+        GroupTask& operator=(GroupTask&&) = delete;
+
+        TaskGroup* m_group;
+        Fn m_fn;
+    };
+
+    template <typename Fn>
+    void execute(Fn& fn);
+
+    Pool& m_pool;
+    std::atomic<size_t> m_pending;
+    std::atomic<bool> m_failed;
+    std::exception_ptr m_error;
+};
+
+
+/// Implementation
+
+template <typename Pool>
+inline TaskGroup<Pool>::TaskGroup(Pool& pool)
+    : m_pool(pool)
+    , m_pending(0)
+    , m_failed(false)
+{
+}
+
+template <typename Pool>
+inline TaskGroup<Pool>::~TaskGroup()
+{
+    try {
+        wait();
+    } catch (...) {
+    }
+}
+
+template <typename Pool>
+template <typename Handler>
+inline void TaskGroup<Pool>::run(Handler&& handler)
+{
+    typedef typename std::decay<Handler>::type Fn;
+
+    m_pending.fetch_add(1, std::memory_order_relaxed);
+    // A rejected task runs inline when the pool destroys it.
+    m_pool.tryPost(GroupTask<Fn>(this, Fn(std::forward<Handler>(handler))));
+}
+
+template <typename Pool>
+template <typename Fn>
+inline void TaskGroup<Pool>::execute(Fn& fn)
+{
+    try {
+        fn();
+    } catch (...) {
+        bool expected = false;
+        if (m_failed.compare_exchange_strong(expected, true)) {
+            m_error = std::current_exception();
+        }
+    }
+
+    // Last access to the group, a waiter may destroy it right after.
+    if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        detail::taskGroupEvent().notifyAll();
+    }
+}
+
+template <typename Pool>
+inline void TaskGroup<Pool>::wait()
+{
+    const bool helping = m_pool.isWorkerThread();
+    EventCount& event = detail::taskGroupEvent();
+
+    while (m_pending.load(std::memory_order_acquire) != 0) {
+        if (helping) {
+            if (!m_pool.runPendingTask()) {
+                std::this_thread::yield();
+            }
+            continue;
+        }
+
+        auto key = event.prepareWait();
+        if (m_pending.load(std::memory_order_acquire) == 0) {
+            event.cancelWait();
+            break;
+        }
+        event.commitWait(key);
+    }
+
+    if (m_failed.load(std::memory_order_acquire)) {
+        std::exception_ptr error = m_error;
+        m_error = nullptr;
+        m_failed.store(false, std::memory_order_relaxed);
+        std::rethrow_exception(error);
+    }
+}
+
+template <typename Pool>
+inline size_t TaskGroup<Pool>::pending() const
+{
+    return m_pending.load(std::memory_order_relaxed);
+}
+
+}
@@ -1,49 +1,209 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <thread>
 #include <string>
+#include <utility>
 #include <vector>
 
 #if defined(__unix__) || defined(__rtems__)
 #include <pthread.h>
+#include <sched.h>
 #endif
 
 namespace tp
 {
 
+/**
+ * @brief The ThreadParams class describes the thread name and CPU affinity
+ * to be applied while a task runs.
+ * Parameters are interned: equal name/cpuset pairs share one immutable
+ * descriptor holding the truncated thread name and the prebuilt native
+ * cpu set, so ThreadParams is cheap to copy and compare.
+ * Each thread remembers the last few descriptors it used, so building
+ * ThreadParams from repeated parameters neither locks nor allocates.
+ * Descriptors live until the process exits, so names should come from a
+ * bounded set.
+ * Pools measuring queue wait also stamp the queued copy with its post time.
+ * The stamp does not take part in comparisons.
+ */
 class ThreadParams
 {
 public:
     ThreadParams();
 
-    explicit ThreadParams(const std::string& name, const std::vector<int>& cpuset);
+    explicit ThreadParams(const std::string& name, const std::vector<int>& cpuset = std::vector<int>());
 
-    std::string& getName();
-    std::vector<int>& getCpuAffinity();
+    const std::string& getName() const;
+    const std::vector<int>& getCpuAffinity() const;
+
+    /**
+     * @brief getThreadName Name truncated to the platform limit.
+     */
+    const std::string& getThreadName() const;
+
+#if defined(__unix__) || defined(__rtems__)
+    /**
+     * @brief getNativeCpuSet Return prebuilt cpu set or nullptr if no
+     * affinity was requested.
+     */
+    const cpu_set_t* getNativeCpuSet() const;
+#endif
+
+    /**
+     * @brief setPostTime Stamp the time the task was posted at.
+     */
+    void setPostTime(std::chrono::steady_clock::time_point time);
+
+    /**
+     * @brief getPostTime Return the post time, or the epoch if unstamped.
+     */
+    std::chrono::steady_clock::time_point getPostTime() const;
+
+    bool operator==(const ThreadParams& rhs) const;
+    bool operator!=(const ThreadParams& rhs) const;
 
 private:
-    std::string name_;
+    struct Descriptor
+    {
+        std::string name;
+        std::string threadName;
+        std::vector<int> cpuset;
+#if defined(__unix__) || defined(__rtems__)
+        cpu_set_t nativeCpuset;
+#endif
+
+        bool matches(const std::string& name, const std::vector<int>& cpuset) const;
+    };
+
+    // Registry key pointing at the name and cpuset of a descriptor, or of
+    // the caller for lookups.
+    typedef std::pair<const std::string*, const std::vector<int>*> Key;
 
-    std::vector<int> cpuset_;
+    struct KeyLess
+    {
+        bool operator()(const Key& lhs, const Key& rhs) const;
+    };
+
+    // Descriptors remembered per thread, found without locking.
+    static const size_t RECENT_SIZE = 4;
+
+    static const Descriptor* intern(const std::string& name, const std::vector<int>& cpuset);
+    static const Descriptor* internLocked(const std::string& name, const std::vector<int>& cpuset);
+    static const Descriptor& emptyDescriptor();
+
+    const Descriptor* m_descriptor;
+    std::chrono::steady_clock::time_point m_post_time;
 };
 
 /// Implementation
 inline ThreadParams::ThreadParams()
-    : name_("")
-    , cpuset_()
+    : m_descriptor(nullptr)
 {}
 
 inline ThreadParams::ThreadParams(const std::string& name, const std::vector<int>& cpuset)
-    : name_(name)
-    , cpuset_(cpuset)
+    : m_descriptor((name.empty() && cpuset.empty()) ? nullptr : intern(name, cpuset))
 {}
 
-inline std::string& ThreadParams::getName() {
-    return name_;
+inline const std::string& ThreadParams::getName() const {
+    return (m_descriptor ? *m_descriptor : emptyDescriptor()).name;
 }
 
-inline std::vector<int>& ThreadParams::getCpuAffinity() {
-    return cpuset_;
+inline const std::vector<int>& ThreadParams::getCpuAffinity() const {
+    return (m_descriptor ? *m_descriptor : emptyDescriptor()).cpuset;
+}
+
+inline const std::string& ThreadParams::getThreadName() const {
+    return (m_descriptor ? *m_descriptor : emptyDescriptor()).threadName;
+}
+
+#if defined(__unix__) || defined(__rtems__)
+inline const cpu_set_t* ThreadParams::getNativeCpuSet() const {
+    return (m_descriptor && !m_descriptor->cpuset.empty()) ? &m_descriptor->nativeCpuset : nullptr;
+}
+#endif
+
+inline void ThreadParams::setPostTime(std::chrono::steady_clock::time_point time) {
+    m_post_time = time;
+}
+
+inline std::chrono::steady_clock::time_point ThreadParams::getPostTime() const {
+    return m_post_time;
+}
+
+inline bool ThreadParams::operator==(const ThreadParams& rhs) const {
+    return m_descriptor == rhs.m_descriptor;
+}
+
+inline bool ThreadParams::operator!=(const ThreadParams& rhs) const {
+    return m_descriptor != rhs.m_descriptor;
+}
+
+inline const ThreadParams::Descriptor& ThreadParams::emptyDescriptor() {
+    static const Descriptor empty = Descriptor();
+    return empty;
+}
+
+inline bool ThreadParams::Descriptor::matches(const std::string& name, const std::vector<int>& cpuset) const {
+    return this->name == name && this->cpuset == cpuset;
+}
+
+inline bool ThreadParams::KeyLess::operator()(const Key& lhs, const Key& rhs) const {
+    if (*lhs.first != *rhs.first) {
+        return *lhs.first < *rhs.first;
+    }
+    return *lhs.second < *rhs.second;
+}
+
+inline const ThreadParams::Descriptor* ThreadParams::intern(const std::string& name, const std::vector<int>& cpuset) {
+#if !(defined(__freertos__) || defined(KPSR_FREERTOS_EMUL))
+    // Threads mostly post with a few params, look them up without locking.
+    static thread_local const Descriptor* recent[RECENT_SIZE] = {};
+    static thread_local size_t recentNext = 0;
+    for (auto descriptor : recent) {
+        if (descriptor && descriptor->matches(name, cpuset)) {
+            return descriptor;
+        }
+    }
+    const Descriptor* descriptor = internLocked(name, cpuset);
+    recent[recentNext] = descriptor;
+    recentNext = (recentNext + 1) % RECENT_SIZE;
+    return descriptor;
+#else
+    return internLocked(name, cpuset);
+#endif
+}
+
+inline const ThreadParams::Descriptor* ThreadParams::internLocked(const std::string& name, const std::vector<int>& cpuset) {
+    // Keys point into their descriptor, so lookups copy nothing.
+    static std::map<Key, std::unique_ptr<Descriptor>, KeyLess> registry;
+    static std::mutex registryLock;
+
+    std::lock_guard<std::mutex> guard(registryLock);
+    auto it = registry.find(Key(&name, &cpuset));
+    if (it != registry.end()) {
+        return it->second.get();
+    }
+
+    std::unique_ptr<Descriptor> descriptor(new Descriptor());
+    descriptor->name = name;
+    // Linux limits thread names to 16 bytes including the terminator.
+    descriptor->threadName = name.substr(0, 15);
+    descriptor->cpuset = cpuset;
+#if defined(__unix__) || defined(__rtems__)
+    CPU_ZERO(&descriptor->nativeCpuset);
+    for (auto cpu : cpuset) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &descriptor->nativeCpuset);
+        }
+    }
+#endif
+    const Descriptor* result = descriptor.get();
+    registry.emplace(Key(&result->name, &result->cpuset), std::move(descriptor));
+    return result;
 }
 }
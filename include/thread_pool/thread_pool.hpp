@@ -1,36 +1,144 @@
 #pragma once
 
+#include <thread_pool/deadline_queue.hpp>
+#include <thread_pool/event_count.hpp>
 #include <thread_pool/fixed_function.hpp>
+#include <thread_pool/future.hpp>
+#include <thread_pool/histogram.hpp>
+#include <thread_pool/logging.hpp>
 #include <thread_pool/mpmc_bounded_queue.hpp>
+#include <thread_pool/slab_allocator.hpp>
+#include <thread_pool/stats.hpp>
 #include <thread_pool/thread_pool_options.hpp>
 #include <thread_pool/thread_params.hpp>
+#include <thread_pool/timer_scheduler.hpp>
+#include <thread_pool/trace.hpp>
 #include <thread_pool/worker.hpp>
 #include <thread_pool/free_workers_map.h>
 #include <thread_pool/thread_pool_blocking_queue.h>
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iterator>
 #include <memory>
 #include <stdexcept>
+#include <tuple>
+#include <utility>
 #include <vector>
 #include <mutex>
 
-#include <spdlog/spdlog.h>
 
 namespace tp
 {
 
+namespace detail
+{
+/**
+ * @brief make_task_pair Build the (task, params) pair stored in the pool
+ * queues. Tasks able to place large handlers out of line take them from
+ * slab; tasks being reposted are moved as they are.
+ */
+template <typename Task, typename Handler>
+inline typename std::enable_if<uses_slab_fallback<Task>::value &&
+                               !std::is_same<typename std::decay<Handler>::type, Task>::value,
+                               std::pair<Task, ThreadParams>>::type
+make_task_pair(Handler&& handler, const ThreadParams& params, SlabAllocator* slab)
+{
+    return std::pair<Task, ThreadParams>(std::piecewise_construct,
+                                         std::forward_as_tuple(std::forward<Handler>(handler), slab),
+                                         std::forward_as_tuple(params));
+}
+
+template <typename Task, typename Handler>
+inline typename std::enable_if<!uses_slab_fallback<Task>::value ||
+                               std::is_same<typename std::decay<Handler>::type, Task>::value,
+                               std::pair<Task, ThreadParams>>::type
+make_task_pair(Handler&& handler, const ThreadParams& params, SlabAllocator*)
+{
+    return std::pair<Task, ThreadParams>(std::forward<Handler>(handler), params);
+}
+
+/**
+ * @brief The TaskBatchIterator class adapts an iterator over handlers to
+ * one over the (task, params) pairs stored in the pool queues, so a batch
+ * is converted while it is pushed without an intermediate buffer.
+ */
+template <typename Task, typename Iterator>
+class TaskBatchIterator
+{
+public:
+    TaskBatchIterator(Iterator it, const ThreadParams& params, SlabAllocator* slab)
+        : m_it(it), m_params(params), m_slab(slab)
+    {}
+
+    std::pair<Task, ThreadParams> operator*() const
+    {
+        return make_task_pair<Task>(std::move(*m_it), m_params, m_slab);
+    }
+
+    TaskBatchIterator& operator++()
+    {
+        ++m_it;
+        return *this;
+    }
+
+private:
+    Iterator m_it;
+    const ThreadParams& m_params;
+    SlabAllocator* m_slab;
+};
+}
+
+/**
+ * @brief The DrainPolicy enum defines what ThreadPool::shutdown does with
+ * the jobs still queued.
+ */
+enum class DrainPolicy
+{
+    /// Run every queued job, including the ones they post.
+    DrainAll,
+    /// Run queued jobs until the deadline, discard the rest.
+    DrainUntilDeadline,
+    /// Discard queued jobs, only let running jobs finish.
+    CancelPending
+};
+
+/**
+ * @brief The ShutdownResult struct counts what ThreadPool::shutdown did
+ * with the jobs queued when it was called.
+ */
+struct ShutdownResult
+{
+    /// Jobs run during shutdown.
+    size_t executed;
+    /// Jobs destroyed without running.
+    size_t discarded;
+};
+
 template <typename Task, template<typename> class Queue>
 class ThreadPoolImpl;
 using NonBlockingThreadPool = ThreadPoolImpl<FixedFunction<void(), 128>, MPMCBoundedQueue>;
 using BlockingThreadPool = ThreadPoolImpl<FixedFunction<void(), 128>, BlockingQueue>;
+/// Non blocking pool with 64 byte tasks, placing larger handlers in a slab.
+using CompactThreadPool = ThreadPoolImpl<FixedFunction<void(), 64, SlabFallback>, MPMCBoundedQueue>;
 
 /**
  * @brief The ThreadPool class implements thread pool pattern.
  * It is highly scalable and fast.
  * It is header only.
- * It implements both work-stealing and work-distribution balancing
- * startegies.
+ * It implements both work-stealing (see ThreadPoolOptions::setWorkStealing)
+ * and work-distribution balancing startegies.
  * It implements cooperative scheduling strategy for tasks.
+ * With ThreadPoolOptions::setNumaAware workers are grouped by NUMA node,
+ * and each group is created on its node with its own shared queues. Jobs go
+ * to the queues of the posting thread's node.
+ * With ThreadPoolOptions::setMaxThreadCount above minThreadCount the pool
+ * is elastic: a worker is started whenever a job is posted while all
+ * running workers are busy, and workers idle for longer than
+ * ThreadPoolOptions::idleTimeout retire, down to the floor set by resize.
  */
 template <typename Task, template<typename> class Queue>
 class ThreadPoolImpl {
@@ -49,6 +157,7 @@ public:
 
     /**
      * @brief ~ThreadPool Stop all workers and destroy thread pool.
+     * Queued jobs are discarded unless shutdown was called.
      */
     ~ThreadPoolImpl();
 
@@ -64,10 +173,115 @@ public:
      * @param name Name to be set as thread name. Must have max length 15 For linux.
      * @return 'true' on success, false otherwise.
      * @note All exceptions thrown by handler will be suppressed.
+     * @note name and cpuset are interned into a ThreadParams that is never
+     * freed, so memory grows with every distinct pair ever posted. Build
+     * names from a bounded set, not from per task data.
+     * @note With work stealing enabled, jobs posted from a worker of this
+     * pool go to that worker's local deque first.
      */
     template <typename Handler>
     bool tryPost(Handler&& handler, const std::string& name = "", const std::vector<int>& cpuset = std::vector<int>());
 
+    /**
+     * @brief post Try post job to thread pool with precompiled parameters.
+     * @param handler Handler to be called from thread pool worker. It has
+     * to be callable as 'handler()'.
+     * @param params Thread name and affinity. Build it once and reuse it to
+     * avoid interning name and cpuset on every post.
+     * @return 'true' on success, false otherwise.
+     */
+    template <typename Handler>
+    bool tryPost(Handler&& handler, const ThreadParams& params);
+
+    /**
+     * @brief tryPostWithPriority Try post job at the given priority level.
+     * @param handler Handler to be called from thread pool worker. It has
+     * to be callable as 'handler()'.
+     * @param priority Level between 0, the most urgent, and
+     * ThreadPoolOptions::priorityLevels() - 1, which plain tryPost uses.
+     * Larger values are clamped.
+     * @param params Thread name and affinity.
+     * @return 'true' on success, false otherwise.
+     * @note Only jobs of the least urgent level go to a worker's local
+     * deque when work stealing is enabled.
+     * @note With deadline scheduling the priority is ignored and the job
+     * runs after every job that has a deadline.
+     */
+    template <typename Handler>
+    bool tryPostWithPriority(Handler&& handler, size_t priority, const ThreadParams& params = ThreadParams());
+
+    /**
+     * @brief tryPostWithDeadline Try post job that should finish by the given
+     * time point.
+     * With ThreadPoolOptions::setDeadlineScheduling on a critical pool the
+     * first free worker runs the pending job with the earliest deadline,
+     * and the job is counted in deadlinesMet() or deadlinesMissed(). Other
+     * pools ignore the deadline and post the job like tryPost.
+     * @param handler Handler to be called from thread pool worker. It has
+     * to be callable as 'handler()'.
+     * @param deadline Absolute time the job should be finished by.
+     * @param params Thread name and affinity.
+     * @return 'true' on success, false otherwise.
+     */
+    template <typename Handler>
+    bool tryPostWithDeadline(Handler&& handler, std::chrono::steady_clock::time_point deadline,
+                             const ThreadParams& params = ThreadParams());
+
+    /**
+     * @brief tryPostBatch Try post a range of jobs to thread pool.
+     * The shared queue is filled with a single slot reservation instead of
+     * one per job, which pays off when fanning out many jobs at once.
+     * @param first Iterator to the first handler. Handlers are moved from
+     * as they are posted; like with tryPost the one that fails to post may
+     * be moved from too.
+     * @param last Iterator past the last handler.
+     * @param params Thread name and affinity for all the jobs.
+     * @return Number of jobs posted, always a prefix of the range.
+     * @note Jobs go to the least urgent priority level.
+     */
+    template <typename Iterator>
+    size_t tryPostBatch(Iterator first, Iterator last, const ThreadParams& params = ThreadParams());
+
+    /**
+     * @brief tryPostTo Try post job to the given worker.
+     * The job waits in the worker's inbox, polled before any other queue,
+     * and is never stolen, so jobs working on the same data keep it in the
+     * caches of one core.
+     * @param worker_id Worker index below maxThreadCount(). A retired
+     * worker of an elastic pool is started again.
+     * @param handler Handler to be called from thread pool worker. It has
+     * to be callable as 'handler()'.
+     * @param params Thread name and affinity.
+     * @return false if the inbox is full or disabled, see
+     * ThreadPoolOptions::setAffinityQueueSize.
+     * @throw std::invalid_argument if worker_id is out of range.
+     */
+    template <typename Handler>
+    bool tryPostTo(size_t worker_id, Handler&& handler, const ThreadParams& params = ThreadParams());
+
+    /**
+     * @brief tryPostWithKey Try post job to the worker preferred by key, so
+     * jobs with the same key run on the same worker. If that worker is
+     * overloaded, its inbox being full, the job is posted like with tryPost
+     * and may run on any worker.
+     * @param key Key hashed with std::hash to pick the worker.
+     * @param handler Handler to be called from thread pool worker. It has
+     * to be callable as 'handler()'.
+     * @param params Thread name and affinity.
+     * @return 'true' on success, false otherwise.
+     * @note Jobs with the same key are not ordered, use a Strand for that.
+     * @note Jobs keyed to a retired worker of an elastic pool are posted
+     * like with tryPost.
+     */
+    template <typename Key, typename Handler>
+    bool tryPostWithKey(const Key& key, Handler&& handler, const ThreadParams& params = ThreadParams());
+
+    /**
+     * @brief workerForKey Return the worker preferred by key.
+     */
+    template <typename Key>
+    size_t workerForKey(const Key& key) const;
+
     /**
      * @brief post Post job to thread pool.
      * @param handler Handler to be called from thread pool worker. It has
@@ -78,14 +292,321 @@ public:
     template <typename Handler>
     void post(Handler&& handler);
 
+    /**
+     * @brief postWithPriority Post job to thread pool at the given priority
+     * level.
+     * @throw std::runtime_error if the level's queue is full.
+     */
+    template <typename Handler>
+    void postWithPriority(Handler&& handler, size_t priority);
+
+    /**
+     * @brief postTo Post job to the given worker.
+     * @throw std::runtime_error if the worker's inbox is full or disabled.
+     * @throw std::invalid_argument if worker_id is out of range.
+     */
+    template <typename Handler>
+    void postTo(size_t worker_id, Handler&& handler);
+
+    /**
+     * @brief postWithKey Post job to the worker preferred by key.
+     * @throw std::runtime_error if the queue is full.
+     */
+    template <typename Key, typename Handler>
+    void postWithKey(const Key& key, Handler&& handler);
+
+    /**
+     * @brief postAfter Post job to thread pool once the delay elapsed.
+     * Timers of a pool are kept in a hierarchical timer wheel advanced by
+     * a single timer thread, started by the first timer, with millisecond
+     * resolution. Expired jobs are posted like with tryPost and retried on
+     * the next tick if the queue is full.
+     * @param delay Time to wait before posting.
+     * @param handler Handler to be called from thread pool worker. It has
+     * to be callable as 'handler()'.
+     * @param params Thread name and affinity.
+     * @return Timer id to pass to cancelTimer.
+     * @note All exceptions thrown by handler will be suppressed.
+     */
+    template <typename Handler>
+    TimerId postAfter(std::chrono::steady_clock::duration delay, Handler&& handler,
+                      const ThreadParams& params = ThreadParams());
+
+    /**
+     * @brief postAt Post job to thread pool at the given time point.
+     * @see postAfter
+     */
+    template <typename Handler>
+    TimerId postAt(std::chrono::steady_clock::time_point time, Handler&& handler,
+                   const ThreadParams& params = ThreadParams());
+
+    /**
+     * @brief postEvery Post job to thread pool every period, the first time
+     * one period from now. The next run is scheduled when a run finishes,
+     * so runs never overlap; periods missed by a long run are skipped.
+     * @see postAfter
+     * @throw std::invalid_argument if period is not positive.
+     */
+    template <typename Handler>
+    TimerId postEvery(std::chrono::steady_clock::duration period, Handler&& handler,
+                      const ThreadParams& params = ThreadParams());
+
+    /**
+     * @brief cancelTimer Prevent the runs of a timer that did not start yet.
+     * @param id Timer id returned by postAfter, postAt or postEvery.
+     * @return false if the timer already ran or is running its last run.
+     */
+    bool cancelTimer(TimerId id);
+
+    /**
+     * @brief submit Post job to thread pool and get its result back.
+     * @param f Handler to be called from thread pool worker as 'f(args...)'.
+     * @param args Arguments bound to the handler, copied or moved like with
+     * std::bind.
+     * @return Future receiving the handler's result or exception. Its state
+     * is taken from a slab owned by the pool, sized to the queue, and falls
+     * back to the heap when the slab is exhausted.
+     * @throw std::runtime_error if the queue is full.
+     */
+    template <typename F, typename... Args>
+    Future<typename detail::SubmitTraits<F, Args...>::Result>
+    submit(F&& f, Args&&... args);
+
+    /**
+     * @brief resize Set the number of workers kept running by an elastic
+     * pool. Workers are started or retired right away; later, idle workers
+     * retire down to count and busy pools grow up to maxThreadCount().
+     * Retiring workers finish their current job and the jobs queued on them
+     * are moved to the remaining workers.
+     * @param count Number of workers, clamped to the pool's bounds.
+     * @return Number of running workers.
+     * @note Fixed size pools ignore the call.
+     */
+    size_t resize(size_t count);
+
+    /**
+     * @brief shutdown Stop the pool, handling the queued jobs according to
+     * policy, and wait for the workers to end.
+     * From the call on, jobs can only be posted from the pool's own workers;
+     * other posts fail, and timers still pending never fire. Parked workers
+     * wake at once. Running jobs always finish. Jobs the workers cannot
+     * take anymore, for example ones placed on a retired worker, are run
+     * or discarded on the calling thread, and cannot post further jobs.
+     * Later calls do nothing and return zero counts.
+     * @param policy What to do with queued jobs.
+     * @param deadline Time to stop running jobs at for
+     * DrainPolicy::DrainUntilDeadline.
+     * @return Number of jobs run and discarded during the call.
+     */
+    ShutdownResult shutdown(DrainPolicy policy = DrainPolicy::DrainAll,
+                            std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max());
+
+    /**
+     * @brief runPendingTask Run one queued task on the calling thread, so a
+     * thread waiting for pool work can help instead of blocking.
+     * The task comes from the caller's local deque when called from a
+     * worker of this pool, then the shared queues in priority order, then
+     * the siblings' deques. A worker of this pool first takes the jobs
+     * placed in its inbox. Its thread name and affinity are not applied.
+     * In critical mode tasks belong to the worker they were posted to, so
+     * only a worker of this pool finds tasks here, in its own queue. With
+     * deadline scheduling the most urgent task of the shared queue is run.
+     * @return false if nothing was run.
+     * @note All exceptions thrown by the task will be suppressed.
+     */
+    bool runPendingTask();
+
+    /**
+     * @brief threadCount Return the number of running workers.
+     */
+    size_t threadCount() const;
+
+    /**
+     * @brief maxThreadCount Return the number of workers the pool may run,
+     * which bounds worker ids.
+     */
+    size_t maxThreadCount() const;
+
+    /**
+     * @brief deadlinesMet Return the number of jobs posted with a deadline
+     * that finished in time. Always 0 without deadline scheduling.
+     */
+    size_t deadlinesMet() const;
+
+    /**
+     * @brief deadlinesMissed Return the number of jobs posted with a
+     * deadline that finished late. Always 0 without deadline scheduling.
+     */
+    size_t deadlinesMissed() const;
+
+    /**
+     * @brief stats Return a snapshot of the pool's runtime counters. The
+     * counters are always kept, at the cost of plain relaxed stores on the
+     * worker threads and a relaxed load of the queue size on each push.
+     * Busy and idle time cost two clock reads per task, which
+     * ThreadPoolOptions::setTimedStats can turn off; WorkerStats::timed
+     * tells whether they were measured.
+     */
+    PoolStats stats() const;
+
+    /**
+     * @brief queueWaitHistogram Return the time jobs waited from post until
+     * a worker took them, merged over the workers. Empty unless enabled by
+     * ThreadPoolOptions::setLatencyHistograms.
+     */
+    LatencyHistogram queueWaitHistogram() const;
+
+    /**
+     * @brief runTimeHistogram Return the time jobs ran, merged over the
+     * workers. Empty unless enabled by ThreadPoolOptions::setLatencyHistograms.
+     */
+    LatencyHistogram runTimeHistogram() const;
+
+    /**
+     * @brief flushTrace Write the events the workers traced since the last
+     * flush as a Chrome trace event JSON document, which chrome://tracing
+     * and Perfetto open. Each worker is a thread named after its ID.
+     * Nothing is traced unless enabled by ThreadPoolOptions::setTraceBufferSize.
+     * @param out Stream to write to.
+     * @return Number of events written.
+     */
+    size_t flushTrace(std::ostream& out);
+
+    /**
+     * @brief isWorkerThread Check if the calling thread is a worker of this
+     * pool.
+     */
+    bool isWorkerThread() const;
+
 private:
+    /**
+     * @brief getWorkerId Claim a free worker, preferably of the caller's
+     * node, or pick the next one round robin if none is free. The returned
+     * worker is marked busy.
+     */
     size_t getWorkerId();
 
+    /**
+     * @brief postingGroup Return the worker group of the calling thread's
+     * NUMA node: the node of the calling worker, else the node of the CPU
+     * the caller runs on. Always 0 unless the pool is NUMA aware.
+     */
+    size_t postingGroup() const;
+
+    /**
+     * @brief groupOf Return the group of worker id.
+     */
+    size_t groupOf(size_t id) const;
+
+    /**
+     * @brief pushShared Push job to the shared queues of a level, those of
+     * the caller's node first.
+     * @param handlerPair Job, left untouched on failure.
+     */
+    bool pushShared(size_t priority, std::pair<Task, ThreadParams>& handlerPair);
+
+    /**
+     * @brief growIfBusy Start a worker of an elastic pool if all running
+     * workers are busy. Called after a job was pushed to a shared queue.
+     */
+    void growIfBusy();
+
+    /**
+     * @brief startRetired Start a retired worker, preferably of the caller's
+     * node, unless another thread is resizing the pool.
+     * @param free Mark it free for critical pools, else keep it busy for
+     * the caller to post to it.
+     * @return Worker id, or maxThreadCount() if none was started.
+     */
+    size_t startRetired(bool free);
+
+    /**
+     * @brief wakeRetired Make sure the worker a job was pushed to is not
+     * retired. m_resize_mutex must not be held.
+     */
+    void wakeRetired(size_t id);
+
+    /**
+     * @brief restart Start worker id again once it retired.
+     * m_resize_mutex must be held.
+     */
+    void restart(size_t id, bool free);
+
+    /**
+     * @brief migrate Move the jobs left to retired worker id to the running
+     * ones, running jobs no worker can take on the calling thread.
+     * m_resize_mutex must be held.
+     */
+    void migrate(size_t id);
+
+    /**
+     * @brief postInbox Push job to the inbox of worker id.
+     * @param handlerPair Job, left untouched on failure.
+     */
+    bool postInbox(size_t id, std::pair<Task, ThreadParams>& handlerPair);
+
+    /**
+     * @brief stamp Return params stamped with the current time if latency
+     * histograms are enabled.
+     */
+    ThreadParams stamp(const ThreadParams& params) const;
+
+    /**
+     * @brief reject Count jobs the pool refused to queue.
+     * @return false, for the caller to return.
+     */
+    bool reject(size_t count = 1);
+
+    /**
+     * @brief accepting Return false if the pool shuts down and the caller
+     * is not one of its workers.
+     */
+    bool accepting() const;
+
+    /**
+     * @brief popLeftover Pop a job left in any queue of the stopped pool.
+     * @param deadline Set to the job's deadline, or to
+     * time_point::max() if it has none.
+     */
+    bool popLeftover(std::pair<Task, ThreadParams>& handlerPair, std::chrono::steady_clock::time_point& deadline);
+
+    /**
+     * @brief timers Return the timer scheduler, starting it on first use.
+     */
+    detail::TimerScheduler<Task, ThreadPoolImpl>& timers();
+
+    // Declared first, so it outlives every queued task.
+    SlabAllocator m_task_slab;
     std::vector<std::unique_ptr<Worker<Task, Queue>>> m_workers;
     FreeWorkersMap freeWorkers;
     std::atomic<size_t> m_next_worker;
     const bool m_critical;
-    std::shared_ptr<Queue<std::pair<Task, ThreadParams>>> m_non_critical_queue;
+    const bool m_work_stealing;
+    const size_t m_priority_levels;
+    Topology m_topology;
+    // Workers of group g are [m_group_begin[g], m_group_begin[g + 1]).
+    std::vector<size_t> m_group_begin;
+    std::vector<size_t> m_group_of_node;
+    // Shared queues of non critical pools, per group and priority level.
+    std::vector<std::vector<std::shared_ptr<Queue<std::pair<Task, ThreadParams>>>>> m_node_queues;
+    std::shared_ptr<DeadlineQueue<std::pair<Task, ThreadParams>>> m_deadline_queue;
+    std::shared_ptr<EventCount> m_idle_event;
+    std::shared_ptr<detail::FutureContext> m_future_context;
+    std::mutex m_timers_mutex;
+    std::shared_ptr<detail::TimerScheduler<Task, ThreadPoolImpl>> m_timers;
+    // Elastic pools only.
+    std::shared_ptr<detail::ElasticState> m_elastic;
+    size_t m_min_threads;
+    std::vector<int> m_cpus;
+    // Worker ids interleaved over the nodes, started first to last.
+    std::vector<size_t> m_start_order;
+    std::mutex m_resize_mutex;
+    std::atomic<bool> m_stopping;
+    detail::SharedCounter m_rejected;
+    // Highest size seen in a shared queue right after a push.
+    detail::SharedCounter m_shared_high_water;
+    const bool m_latency_histograms;
+    std::mutex m_trace_mutex;
 };
 
 
@@ -93,27 +614,114 @@ private:
 
 template <typename Task, template<typename> class Queue>
 inline ThreadPoolImpl<Task, Queue>::ThreadPoolImpl(const ThreadPoolOptions& options)
-    : m_workers(options.threadCount())
+    : m_task_slab(detail::uses_slab_fallback<Task>::value && options.taskBlockSize() ? options.queueSize() : 0,
+                  options.taskBlockSize())
+    , m_workers(options.maxThreadCount())
+    , freeWorkers(options.maxThreadCount())
     , m_next_worker(0)
     , m_critical(options.critical())
+    , m_work_stealing(options.workStealing() && !options.critical())
+    , m_priority_levels(options.priorityLevels())
+    , m_topology(options.numaAware() ? options.topology() : Topology())
+    , m_future_context(std::make_shared<detail::FutureContext>(options.queueSize()))
+    , m_min_threads(options.minThreadCount())
+    , m_stopping(false)
+    , m_latency_histograms(options.latencyHistograms())
 {
-    if (m_critical) {
-        for(auto& worker_ptr : m_workers)
-        {
-            worker_ptr.reset(new Worker<Task, Queue>(options.queueSize(), this->freeWorkers));
+    const bool numa = options.numaAware();
+    const size_t nodes = numa ? m_topology.nodeCount() : 1;
+
+    // Spread workers evenly over the nodes, in contiguous groups, and give
+    // them the node's CPUs in turn.
+    m_cpus.assign(m_workers.size(), -1);
+    std::vector<size_t> group_nodes;
+    for (size_t i = 0; i < m_workers.size(); ++i) {
+        const size_t node = i * nodes / m_workers.size();
+        if (group_nodes.empty() || group_nodes.back() != node) {
+            group_nodes.push_back(node);
+            m_group_begin.push_back(i);
         }
-    } else {
-        m_non_critical_queue = std::make_shared<Queue<std::pair<Task, ThreadParams>>>(options.queueSize());
-        for(auto& worker_ptr : m_workers)
-        {
-            worker_ptr.reset(new Worker<Task, Queue>(m_non_critical_queue, this->freeWorkers));
+        if (numa) {
+            const std::vector<int>& node_cpus = m_topology.node(node).cpus;
+            m_cpus[i] = node_cpus[(i - m_group_begin.back()) % node_cpus.size()];
         }
     }
+    m_group_begin.push_back(m_workers.size());
+    const size_t groups = group_nodes.size();
 
-    for(size_t i = 0; i < m_workers.size(); ++i)
-    {
-        freeWorkers.setFree(i, true);
-        m_workers[i]->start(i);
+    m_group_of_node.resize(nodes);
+    for (size_t node = 0; node < nodes; ++node) {
+        m_group_of_node[node] = groups ? node % groups : 0;
+    }
+    for (size_t group = 0; group < groups; ++group) {
+        m_group_of_node[group_nodes[group]] = group;
+    }
+
+    if (m_critical && options.deadlineScheduling()) {
+        m_deadline_queue = std::make_shared<DeadlineQueue<std::pair<Task, ThreadParams>>>(options.queueSize());
+        m_idle_event = std::make_shared<EventCount>();
+    } else if (!m_critical) {
+        m_node_queues.resize(groups);
+        m_idle_event = std::make_shared<EventCount>();
+    }
+
+    for (size_t group = 0; group < groups; ++group) {
+        auto create = [this, group, &options]() {
+            for (size_t level = 0; !m_critical && level < m_priority_levels; ++level) {
+                m_node_queues[group].push_back(std::make_shared<Queue<std::pair<Task, ThreadParams>>>(options.queueSize()));
+            }
+            for (size_t i = m_group_begin[group]; i < m_group_begin[group + 1]; ++i) {
+                if (m_deadline_queue) {
+                    m_workers[i].reset(new Worker<Task, Queue>(m_deadline_queue, m_idle_event, this->freeWorkers, options));
+                } else if (m_critical) {
+                    m_workers[i].reset(new Worker<Task, Queue>(options.queueSize(), this->freeWorkers, options));
+                } else {
+                    m_workers[i].reset(new Worker<Task, Queue>(m_node_queues[group], m_idle_event, this->freeWorkers, options));
+                }
+            }
+        };
+        // Queues and workers are first touched on their node.
+        if (numa) {
+            m_topology.runOnNode(group_nodes[group], create);
+        } else {
+            create();
+        }
+    }
+
+    if (m_node_queues.size() > 1) {
+        for (size_t group = 0; group < groups; ++group) {
+            std::vector<std::vector<std::shared_ptr<Queue<std::pair<Task, ThreadParams>>>>> remote;
+            for (size_t other = 1; other < groups; ++other) {
+                remote.push_back(m_node_queues[(group + other) % groups]);
+            }
+            for (size_t i = m_group_begin[group]; i < m_group_begin[group + 1]; ++i) {
+                m_workers[i]->setRemoteQueues(remote);
+            }
+        }
+    }
+
+    // Start the first workers of every node before the second ones.
+    for (size_t rank = 0; m_start_order.size() < m_workers.size(); ++rank) {
+        for (size_t group = 0; group < groups; ++group) {
+            if (m_group_begin[group] + rank < m_group_begin[group + 1]) {
+                m_start_order.push_back(m_group_begin[group] + rank);
+            }
+        }
+    }
+
+    size_t count = m_workers.size();
+    if (m_min_threads < m_workers.size()) {
+        count = options.threadCount();
+        m_elastic = std::make_shared<detail::ElasticState>(count, m_min_threads, options.idleTimeout());
+        for (auto& worker_ptr : m_workers) {
+            worker_ptr->setElastic(m_elastic);
+        }
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        const size_t id = m_start_order[i];
+        freeWorkers.setFree(id, true);
+        m_workers[id]->start(id, this, &m_workers, m_cpus[id], groupOf(id));
     }
 }
 
@@ -126,10 +734,7 @@ inline ThreadPoolImpl<Task, Queue>::ThreadPoolImpl(ThreadPoolImpl<Task, Queue>&&
 template <typename Task, template<typename> class Queue>
 inline ThreadPoolImpl<Task, Queue>::~ThreadPoolImpl()
 {
-    for (auto& worker_ptr : m_workers)
-    {
-        worker_ptr->stop();
-    }
+    shutdown(DrainPolicy::CancelPending);
 }
 
 template <typename Task, template<typename> class Queue>
@@ -148,18 +753,205 @@ template <typename Task, template<typename> class Queue>
 template <typename Handler>
 inline bool ThreadPoolImpl<Task, Queue>::tryPost(Handler&& handler, const std::string& name, const std::vector<int>& cpuset)
 {
-    auto id = getWorkerId();
-    ThreadParams params{name, cpuset};
+    return tryPost(std::forward<Handler>(handler), ThreadParams(name, cpuset));
+}
+
+template <typename Task, template<typename> class Queue>
+template <typename Handler>
+inline bool ThreadPoolImpl<Task, Queue>::tryPost(Handler&& handler, const ThreadParams& params)
+{
+    return tryPostWithPriority(std::forward<Handler>(handler), m_priority_levels - 1, params);
+}
+
+template <typename Task, template<typename> class Queue>
+template <typename Handler>
+inline bool ThreadPoolImpl<Task, Queue>::tryPostWithPriority(Handler&& handler, size_t priority, const ThreadParams& params)
+{
+    priority = std::min(priority, m_priority_levels - 1);
+
+    if (!accepting()) {
+        return reject();
+    }
+
+    if (m_deadline_queue) {
+        return tryPostWithDeadline(std::forward<Handler>(handler), std::chrono::steady_clock::time_point::max(), params);
+    }
+
     if (m_critical) {
+        auto id = getWorkerId();
         if (id >= m_workers.size()) {
-            return false;
+            return reject();
+        }
+        TP_LOG_DEBUG("ThreadPoolImpl::tryPost. id = {}, name = {}.", id, params.getName());
+        if (!m_workers[id]->postQueued(detail::make_task_pair<Task>(std::forward<Handler>(handler), stamp(params), &m_task_slab),
+                                       priority)) {
+            return reject();
+        }
+        if (m_elastic) {
+            wakeRetired(id);
+        }
+        return true;
+    }
+
+    std::pair<Task, ThreadParams> handlerPair =
+        detail::make_task_pair<Task>(std::forward<Handler>(handler), stamp(params), &m_task_slab);
+    if (m_work_stealing && priority == m_priority_levels - 1 && isWorkerThread()) {
+        auto id = Worker<Task, Queue>::getWorkerIdForCurrentThread();
+        if (m_workers[id]->postLocal(std::move(handlerPair))) {
+            return true;
         }
-        freeWorkers.setFree(id, false);
-        spdlog::debug("ThreadPoolImpl::tryPost. id = {}, name = {}.", id, name);
-        return m_workers[id % m_workers.size()]->post(std::forward<Handler>(handler), std::move(params));
     }
 
-    return m_non_critical_queue->push(std::make_pair<Task, ThreadParams>(std::forward<Handler>(handler), std::forward<ThreadParams>(params)));
+    if (!pushShared(priority, handlerPair)) {
+        return reject();
+    }
+    m_idle_event->notifyOne();
+    if (m_elastic) {
+        growIfBusy();
+    }
+    return true;
+}
+
+template <typename Task, template<typename> class Queue>
+template <typename Handler>
+inline bool ThreadPoolImpl<Task, Queue>::tryPostWithDeadline(Handler&& handler, std::chrono::steady_clock::time_point deadline,
+                                                             const ThreadParams& params)
+{
+    if (!m_deadline_queue) {
+        return tryPost(std::forward<Handler>(handler), params);
+    }
+    if (!accepting()) {
+        return reject();
+    }
+
+    if (!m_deadline_queue->push(detail::make_task_pair<Task>(std::forward<Handler>(handler), stamp(params), &m_task_slab),
+                                deadline)) {
+        return reject();
+    }
+    m_idle_event->notifyOne();
+    if (m_elastic) {
+        growIfBusy();
+    }
+    return true;
+}
+
+template <typename Task, template<typename> class Queue>
+template <typename Iterator>
+inline size_t ThreadPoolImpl<Task, Queue>::tryPostBatch(Iterator first, Iterator last, const ThreadParams& params)
+{
+    size_t posted = 0;
+
+    if (!accepting()) {
+        reject(static_cast<size_t>(std::distance(first, last)));
+        return 0;
+    }
+
+    if (m_critical) {
+        // Each critical worker has its own queue, so there is no shared
+        // slot range to claim.
+        for (; first != last; ++first, ++posted) {
+            if (!tryPost(std::move(*first), params)) {
+                // tryPost counted the job it refused.
+                reject(static_cast<size_t>(std::distance(first, last)) - 1);
+                break;
+            }
+        }
+        return posted;
+    }
+
+    const ThreadParams stamped = stamp(params);
+    if (m_work_stealing && isWorkerThread()) {
+        auto id = Worker<Task, Queue>::getWorkerIdForCurrentThread();
+        for (; first != last; ++first, ++posted) {
+            std::pair<Task, ThreadParams> handlerPair =
+                detail::make_task_pair<Task>(std::move(*first), stamped, &m_task_slab);
+            if (!m_workers[id]->postLocal(std::move(handlerPair))) {
+                // Local deque is full, the pair was left untouched.
+                if (!pushShared(m_priority_levels - 1, handlerPair)) {
+                    reject(static_cast<size_t>(std::distance(first, last)));
+                    return posted;
+                }
+                m_idle_event->notifyOne();
+                ++first;
+                ++posted;
+                break;
+            }
+        }
+    }
+
+    const size_t count = static_cast<size_t>(std::distance(first, last));
+    if (count == 0) {
+        return posted;
+    }
+
+    const size_t pushed = m_node_queues[postingGroup()].back()->push_bulk(
+        detail::TaskBatchIterator<Task, Iterator>(first, stamped, &m_task_slab), count);
+    reject(count - pushed);
+    if (pushed > 1) {
+        m_idle_event->notifyAll();
+    } else if (pushed == 1) {
+        m_idle_event->notifyOne();
+    }
+    if (m_elastic && pushed > 0) {
+        growIfBusy();
+    }
+    return posted + pushed;
+}
+
+template <typename Task, template<typename> class Queue>
+template <typename Handler>
+inline bool ThreadPoolImpl<Task, Queue>::tryPostTo(size_t worker_id, Handler&& handler, const ThreadParams& params)
+{
+    if (worker_id >= m_workers.size()) {
+        throw std::invalid_argument("worker id out of range");
+    }
+    std::pair<Task, ThreadParams> handlerPair =
+        detail::make_task_pair<Task>(std::forward<Handler>(handler), stamp(params), &m_task_slab);
+    return postInbox(worker_id, handlerPair) || reject();
+}
+
+template <typename Task, template<typename> class Queue>
+template <typename Key, typename Handler>
+inline bool ThreadPoolImpl<Task, Queue>::tryPostWithKey(const Key& key, Handler&& handler, const ThreadParams& params)
+{
+    std::pair<Task, ThreadParams> handlerPair =
+        detail::make_task_pair<Task>(std::forward<Handler>(handler), stamp(params), &m_task_slab);
+    const size_t id = workerForKey(key);
+    // Keys of retired workers are not worth starting a thread for.
+    if ((!m_elastic || m_workers[id]->state() == detail::WorkerState::Running) && postInbox(id, handlerPair)) {
+        return true;
+    }
+    // The preferred worker is overloaded, let any worker take the job.
+    return tryPost(std::move(handlerPair.first), params);
+}
+
+template <typename Task, template<typename> class Queue>
+template <typename Key>
+inline size_t ThreadPoolImpl<Task, Queue>::workerForKey(const Key& key) const
+{
+    // Scramble the hash, std::hash of integers is often the identity.
+    const std::uint64_t hash = static_cast<std::uint64_t>(std::hash<Key>()(key)) * 0x9e3779b97f4a7c15ull;
+    return static_cast<size_t>(hash >> 32) % m_workers.size();
+}
+
+template <typename Task, template<typename> class Queue>
+template <typename Handler>
+inline void ThreadPoolImpl<Task, Queue>::postTo(size_t worker_id, Handler&& handler)
+{
+    if (!tryPostTo(worker_id, std::forward<Handler>(handler)))
+    {
+        throw std::runtime_error("thread pool queue is full");
+    }
+}
+
+template <typename Task, template<typename> class Queue>
+template <typename Key, typename Handler>
+inline void ThreadPoolImpl<Task, Queue>::postWithKey(const Key& key, Handler&& handler)
+{
+    if (!tryPostWithKey(key, std::forward<Handler>(handler)))
+    {
+        throw std::runtime_error("thread pool queue is full");
+    }
 }
 
 template <typename Task, template<typename> class Queue>
@@ -173,17 +965,586 @@ inline void ThreadPoolImpl<Task, Queue>::post(Handler&& handler)
     }
 }
 
+template <typename Task, template<typename> class Queue>
+template <typename Handler>
+inline TimerId ThreadPoolImpl<Task, Queue>::postAfter(std::chrono::steady_clock::duration delay, Handler&& handler,
+                                                      const ThreadParams& params)
+{
+    return postAt(std::chrono::steady_clock::now() + delay, std::forward<Handler>(handler), params);
+}
+
+template <typename Task, template<typename> class Queue>
+template <typename Handler>
+inline TimerId ThreadPoolImpl<Task, Queue>::postAt(std::chrono::steady_clock::time_point time, Handler&& handler,
+                                                   const ThreadParams& params)
+{
+    return timers().schedule(std::forward<Handler>(handler), time,
+                             std::chrono::steady_clock::duration::zero(), params);
+}
+
+template <typename Task, template<typename> class Queue>
+template <typename Handler>
+inline TimerId ThreadPoolImpl<Task, Queue>::postEvery(std::chrono::steady_clock::duration period, Handler&& handler,
+                                                      const ThreadParams& params)
+{
+    if (period <= std::chrono::steady_clock::duration::zero()) {
+        throw std::invalid_argument("timer period must be positive");
+    }
+    return timers().schedule(std::forward<Handler>(handler), std::chrono::steady_clock::now() + period,
+                             period, params);
+}
+
+template <typename Task, template<typename> class Queue>
+inline bool ThreadPoolImpl<Task, Queue>::cancelTimer(TimerId id)
+{
+    std::shared_ptr<detail::TimerScheduler<Task, ThreadPoolImpl>> scheduler;
+    {
+        std::lock_guard<std::mutex> lock(m_timers_mutex);
+        scheduler = m_timers;
+    }
+    return scheduler && scheduler->cancel(id);
+}
+
+template <typename Task, template<typename> class Queue>
+template <typename F, typename... Args>
+inline Future<typename detail::SubmitTraits<F, Args...>::Result>
+ThreadPoolImpl<Task, Queue>::submit(F&& f, Args&&... args)
+{
+    typedef typename detail::SubmitTraits<F, Args...>::Fn Fn;
+    typedef typename detail::SubmitTraits<F, Args...>::Result R;
+
+    auto state = detail::FutureState<R>::create(m_future_context);
+    Future<R> future(state);
+
+    // On failure the task is destroyed unexecuted and breaks the future.
+    post(detail::SubmitTask<R, Fn>(std::bind(std::forward<F>(f), std::forward<Args>(args)...), state));
+
+    return future;
+}
+
+template <typename Task, template<typename> class Queue>
+template <typename Handler>
+inline void ThreadPoolImpl<Task, Queue>::postWithPriority(Handler&& handler, size_t priority)
+{
+    const auto ok = tryPostWithPriority(std::forward<Handler>(handler), priority);
+    if (!ok)
+    {
+        throw std::runtime_error("thread pool queue is full");
+    }
+}
+
+template <typename Task, template<typename> class Queue>
+inline size_t ThreadPoolImpl<Task, Queue>::resize(size_t count)
+{
+    if (!m_elastic || m_stopping.load()) {
+        return m_workers.size();
+    }
+    count = std::min(std::max(count, m_min_threads), m_workers.size());
+
+    std::vector<size_t> retiring;
+    {
+        std::lock_guard<std::mutex> lock(m_resize_mutex);
+        m_elastic->floor.store(count, std::memory_order_relaxed);
+
+        for (size_t i = 0; i < m_start_order.size() && m_elastic->running.load() < count; ++i) {
+            if (m_workers[m_start_order[i]]->state() == detail::WorkerState::Retired) {
+                restart(m_start_order[i], true);
+            }
+        }
+        for (size_t i = m_start_order.size(); i-- > 0 && m_elastic->running.load() > count;) {
+            if (m_workers[m_start_order[i]]->requestRetire()) {
+                m_elastic->running.fetch_sub(1);
+                retiring.push_back(m_start_order[i]);
+            }
+        }
+    }
+
+    // Unlocked: the current jobs of retiring workers may post to the pool.
+    for (auto id : retiring) {
+        while (m_workers[id]->state() != detail::WorkerState::Retired) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_resize_mutex);
+    for (auto id : retiring) {
+        // Skip workers restarted meanwhile for a job posted to them.
+        if (m_workers[id]->state() == detail::WorkerState::Retired) {
+            m_workers[id]->join();
+            migrate(id);
+        }
+    }
+    return m_elastic->running.load();
+}
+
+template <typename Task, template<typename> class Queue>
+inline ShutdownResult ThreadPoolImpl<Task, Queue>::shutdown(DrainPolicy policy,
+                                                            std::chrono::steady_clock::time_point deadline)
+{
+    ShutdownResult result = {0, 0};
+    if (m_stopping.exchange(true)) {
+        return result;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_timers_mutex);
+        if (m_timers) {
+            m_timers->stop();
+        }
+    }
+
+    std::chrono::steady_clock::time_point stop_at = deadline;
+    if (policy == DrainPolicy::DrainAll) {
+        stop_at = std::chrono::steady_clock::time_point::max();
+    } else if (policy == DrainPolicy::CancelPending) {
+        stop_at = std::chrono::steady_clock::time_point::min();
+    }
+
+    {
+        // No retired worker restarts once the stop is requested.
+        std::lock_guard<std::mutex> lock(m_resize_mutex);
+        for (auto& worker_ptr : m_workers) {
+            worker_ptr->requestStop(stop_at);
+        }
+    }
+    for (auto& worker_ptr : m_workers) {
+        worker_ptr->join();
+        result.executed += worker_ptr->drained();
+    }
+
+    std::pair<Task, ThreadParams> handlerPair;
+    std::chrono::steady_clock::time_point job_deadline;
+    while (popLeftover(handlerPair, job_deadline)) {
+        if (stop_at == std::chrono::steady_clock::time_point::max() ||
+            (stop_at != std::chrono::steady_clock::time_point::min() && std::chrono::steady_clock::now() < stop_at)) {
+            try {
+                handlerPair.first();
+            } catch (...) {
+                // suppress all exceptions
+                TP_LOG_WARN("{}. Exception during execution of {}.", __PRETTY_FUNCTION__, handlerPair.second.getName());
+            }
+            // Discarded jobs neither met nor missed their deadline.
+            if (m_deadline_queue) {
+                m_deadline_queue->recordCompletion(job_deadline);
+            }
+            ++result.executed;
+        } else {
+            ++result.discarded;
+        }
+        handlerPair = std::pair<Task, ThreadParams>();
+    }
+    return result;
+}
+
+template <typename Task, template<typename> class Queue>
+inline bool ThreadPoolImpl<Task, Queue>::runPendingTask()
+{
+    std::pair<Task, ThreadParams> handlerPair;
+    const bool worker = isWorkerThread();
+    const size_t id = worker ? Worker<Task, Queue>::getWorkerIdForCurrentThread() : 0;
+    bool found = worker && m_workers[id]->popInbox(handlerPair);
+    if (!found && m_deadline_queue) {
+        // The deadline queue is shared, so any thread may help.
+        std::chrono::steady_clock::time_point deadline;
+        if (!m_deadline_queue->tryPop(handlerPair, deadline)) {
+            return false;
+        }
+        try {
+            handlerPair.first();
+        } catch (...) {
+            // suppress all exceptions
+            TP_LOG_WARN("{}. Exception during execution of {}.", __PRETTY_FUNCTION__, handlerPair.second.getName());
+        }
+        m_deadline_queue->recordCompletion(deadline);
+        return true;
+    }
+    if (!found && m_critical) {
+        if (!worker) {
+            return false;
+        }
+        found = m_workers[id]->popQueued(handlerPair);
+    } else if (!found && m_work_stealing && worker) {
+        found = m_workers[id]->popLocal(handlerPair);
+    }
+    if (!found && !m_critical) {
+        const size_t local = worker ? m_workers[id]->node() : postingGroup();
+        for (size_t group = 0; !found && group < m_node_queues.size(); ++group) {
+            const auto& queues = m_node_queues[(local + group) % m_node_queues.size()];
+            for (size_t level = 0; !found && level < queues.size(); ++level) {
+                found = detail::try_pop(*queues[level], handlerPair);
+            }
+        }
+    }
+    for (size_t i = 0; !found && m_work_stealing && i < m_workers.size(); ++i) {
+        found = m_workers[i]->steal(handlerPair);
+    }
+    if (!found) {
+        return false;
+    }
+
+    try {
+        handlerPair.first();
+    } catch (...) {
+        // suppress all exceptions
+        TP_LOG_WARN("{}. Exception during execution of {}.", __PRETTY_FUNCTION__, handlerPair.second.getName());
+    }
+    return true;
+}
+
+template <typename Task, template<typename> class Queue>
+inline size_t ThreadPoolImpl<Task, Queue>::threadCount() const
+{
+    return m_elastic ? m_elastic->running.load(std::memory_order_relaxed) : m_workers.size();
+}
+
+template <typename Task, template<typename> class Queue>
+inline size_t ThreadPoolImpl<Task, Queue>::maxThreadCount() const
+{
+    return m_workers.size();
+}
+
+template <typename Task, template<typename> class Queue>
+inline size_t ThreadPoolImpl<Task, Queue>::deadlinesMet() const
+{
+    return m_deadline_queue ? m_deadline_queue->met() : 0;
+}
+
+template <typename Task, template<typename> class Queue>
+inline size_t ThreadPoolImpl<Task, Queue>::deadlinesMissed() const
+{
+    return m_deadline_queue ? m_deadline_queue->missed() : 0;
+}
+
+template <typename Task, template<typename> class Queue>
+inline PoolStats ThreadPoolImpl<Task, Queue>::stats() const
+{
+    PoolStats stats;
+    stats.total = WorkerStats();
+    for (const auto& worker_ptr : m_workers) {
+        const WorkerStats worker = worker_ptr->stats();
+        stats.total.executed += worker.executed;
+        stats.total.exceptions += worker.exceptions;
+        stats.total.steal_attempts += worker.steal_attempts;
+        stats.total.steals += worker.steals;
+        stats.total.queue_high_water = std::max(stats.total.queue_high_water, worker.queue_high_water);
+        stats.total.busy += worker.busy;
+        stats.total.idle += worker.idle;
+        stats.total.timed = stats.total.timed || worker.timed;
+        stats.workers.push_back(worker);
+    }
+    stats.total.queue_high_water = std::max<std::uint64_t>(
+        stats.total.queue_high_water, m_shared_high_water.value.load(std::memory_order_relaxed));
+    stats.rejected = m_rejected.value.load(std::memory_order_relaxed);
+    return stats;
+}
+
+template <typename Task, template<typename> class Queue>
+inline LatencyHistogram ThreadPoolImpl<Task, Queue>::queueWaitHistogram() const
+{
+    LatencyHistogram queue_wait;
+    for (const auto& worker_ptr : m_workers) {
+        worker_ptr->mergeQueueWait(queue_wait);
+    }
+    return queue_wait;
+}
+
+template <typename Task, template<typename> class Queue>
+inline LatencyHistogram ThreadPoolImpl<Task, Queue>::runTimeHistogram() const
+{
+    LatencyHistogram run_time;
+    for (const auto& worker_ptr : m_workers) {
+        worker_ptr->mergeRunTime(run_time);
+    }
+    return run_time;
+}
+
+template <typename Task, template<typename> class Queue>
+inline size_t ThreadPoolImpl<Task, Queue>::flushTrace(std::ostream& out)
+{
+    std::lock_guard<std::mutex> lock(m_trace_mutex);
+    size_t written = 0;
+    bool first = true;
+    out << "{\"traceEvents\":[";
+    for (size_t id = 0; id < m_workers.size(); ++id) {
+        detail::TraceBuffer* trace = m_workers[id]->trace();
+        if (!trace) {
+            continue;
+        }
+        out << (first ? "\n" : ",\n")
+            << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << id
+            << ",\"args\":{\"name\":\"worker " << id << "\"}}";
+        first = false;
+        written += trace->consume([&out, id, &first](const TraceEvent& event) {
+            detail::write_chrome_event(out, id, event, first);
+        });
+    }
+    out << "\n]}\n";
+    return written;
+}
+
+template <typename Task, template<typename> class Queue>
+inline bool ThreadPoolImpl<Task, Queue>::isWorkerThread() const
+{
+    return Worker<Task, Queue>::getOwnerForCurrentThread() == this;
+}
+
+template <typename Task, template<typename> class Queue>
+inline ThreadParams ThreadPoolImpl<Task, Queue>::stamp(const ThreadParams& params) const
+{
+    ThreadParams stamped(params);
+    if (m_latency_histograms) {
+        stamped.setPostTime(std::chrono::steady_clock::now());
+    }
+    return stamped;
+}
+
+template <typename Task, template<typename> class Queue>
+inline bool ThreadPoolImpl<Task, Queue>::reject(size_t count)
+{
+    if (count) {
+        m_rejected.value.fetch_add(count, std::memory_order_relaxed);
+    }
+    return false;
+}
+
+template <typename Task, template<typename> class Queue>
+inline bool ThreadPoolImpl<Task, Queue>::accepting() const
+{
+    return !m_stopping.load(std::memory_order_relaxed) || isWorkerThread();
+}
+
+template <typename Task, template<typename> class Queue>
+inline bool ThreadPoolImpl<Task, Queue>::popLeftover(std::pair<Task, ThreadParams>& handlerPair,
+                                                      std::chrono::steady_clock::time_point& deadline)
+{
+    deadline = std::chrono::steady_clock::time_point::max();
+    size_t level;
+    for (auto& worker_ptr : m_workers) {
+        if (worker_ptr->drain(handlerPair, level)) {
+            return true;
+        }
+    }
+    for (auto& queues : m_node_queues) {
+        for (auto& queue : queues) {
+            if (detail::try_pop(*queue, handlerPair)) {
+                return true;
+            }
+        }
+    }
+    return m_deadline_queue && m_deadline_queue->tryPop(handlerPair, deadline);
+}
+
+template <typename Task, template<typename> class Queue>
+inline detail::TimerScheduler<Task, ThreadPoolImpl<Task, Queue>>& ThreadPoolImpl<Task, Queue>::timers()
+{
+    std::lock_guard<std::mutex> lock(m_timers_mutex);
+    if (!m_timers) {
+        m_timers = detail::TimerScheduler<Task, ThreadPoolImpl>::create(*this);
+    }
+    return *m_timers;
+}
+
+template <typename Task, template<typename> class Queue>
+inline bool ThreadPoolImpl<Task, Queue>::postInbox(size_t id, std::pair<Task, ThreadParams>& handlerPair)
+{
+    if (!accepting()) {
+        return false;
+    }
+    // Like getWorkerId, mark the critical worker busy before it may run,
+    // and give it back if the job could not be pushed.
+    const bool claimed = m_critical && !m_deadline_queue && freeWorkers.claim(id);
+    if (!m_workers[id]->postInbox(std::move(handlerPair))) {
+        if (claimed) {
+            freeWorkers.setFree(id, true);
+        }
+        return false;
+    }
+    if (m_elastic) {
+        wakeRetired(id);
+    }
+    return true;
+}
+
 template <typename Task, template<typename> class Queue>
 inline size_t ThreadPoolImpl<Task, Queue>::getWorkerId()
 {
     size_t id;
-    bool found = freeWorkers.findFreeWorker(id);
+    bool found = false;
+    if (m_group_begin.size() > 2) {
+        const size_t group = postingGroup();
+        found = freeWorkers.claimFreeWorker(id, m_group_begin[group], m_group_begin[group + 1]);
+    }
+    found = found || freeWorkers.claimFreeWorker(id);
+    if (!found && m_elastic) {
+        id = startRetired(false);
+        found = id < m_workers.size();
+    }
     if (found) {
         m_next_worker.store(id+1, std::memory_order_relaxed);
     } else {
         id = m_next_worker.fetch_add(1, std::memory_order_relaxed);
+        freeWorkers.setFree(id, false);
     }
 
     return id;
 }
+
+template <typename Task, template<typename> class Queue>
+inline size_t ThreadPoolImpl<Task, Queue>::postingGroup() const
+{
+    if (m_group_begin.size() <= 2) {
+        return 0;
+    }
+    if (isWorkerThread()) {
+        return m_workers[Worker<Task, Queue>::getWorkerIdForCurrentThread()]->node();
+    }
+#if defined(__linux__)
+    const int cpu = sched_getcpu();
+    if (cpu >= 0) {
+        return m_group_of_node[m_topology.nodeOfCpu(cpu)];
+    }
+#endif
+    return 0;
+}
+
+template <typename Task, template<typename> class Queue>
+inline size_t ThreadPoolImpl<Task, Queue>::groupOf(size_t id) const
+{
+    return static_cast<size_t>(std::upper_bound(m_group_begin.begin(), m_group_begin.end() - 1, id) -
+                               m_group_begin.begin()) - 1;
+}
+
+template <typename Task, template<typename> class Queue>
+inline void ThreadPoolImpl<Task, Queue>::growIfBusy()
+{
+    if (m_elastic->busy.load(std::memory_order_relaxed) >= m_elastic->running.load(std::memory_order_relaxed) &&
+        m_elastic->running.load(std::memory_order_relaxed) < m_workers.size()) {
+        startRetired(true);
+    }
+}
+
+template <typename Task, template<typename> class Queue>
+inline size_t ThreadPoolImpl<Task, Queue>::startRetired(bool free)
+{
+    std::unique_lock<std::mutex> lock(m_resize_mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return m_workers.size();
+    }
+    const size_t begin = m_group_begin[postingGroup()];
+    for (size_t i = 0; i < m_workers.size(); ++i) {
+        const size_t id = (begin + i) % m_workers.size();
+        if (m_workers[id]->state() == detail::WorkerState::Retired) {
+            restart(id, free);
+            return id;
+        }
+    }
+    return m_workers.size();
+}
+
+template <typename Task, template<typename> class Queue>
+inline void ThreadPoolImpl<Task, Queue>::wakeRetired(size_t id)
+{
+    // Pairs with the fence of a worker retiring on its own: either it finds
+    // the job, or it is seen retiring here.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    for (;;) {
+        switch (m_workers[id]->state()) {
+        case detail::WorkerState::Running:
+        case detail::WorkerState::RetireRequested:
+            // resize moves the jobs of the workers it retires.
+            return;
+        case detail::WorkerState::Retired: {
+            std::lock_guard<std::mutex> lock(m_resize_mutex);
+            if (m_workers[id]->state() == detail::WorkerState::Retired) {
+                restart(id, false);
+            }
+            return;
+        }
+        default:
+            // Resumes or retires shortly.
+            std::this_thread::yield();
+        }
+    }
+}
+
+template <typename Task, template<typename> class Queue>
+inline void ThreadPoolImpl<Task, Queue>::restart(size_t id, bool free)
+{
+    // Jobs queued on workers that stay retired are left to shutdown.
+    if (m_stopping.load()) {
+        return;
+    }
+    m_workers[id]->join();
+    m_elastic->running.fetch_add(1);
+    if (free) {
+        freeWorkers.setFree(id, true);
+    }
+    m_workers[id]->start(id, this, &m_workers, m_cpus[id], groupOf(id));
+}
+
+template <typename Task, template<typename> class Queue>
+inline void ThreadPoolImpl<Task, Queue>::migrate(size_t id)
+{
+    std::pair<Task, ThreadParams> handlerPair;
+    size_t level;
+    while (m_workers[id]->drain(handlerPair, level)) {
+        bool moved = false;
+        if (m_deadline_queue) {
+            moved = m_deadline_queue->push(std::move(handlerPair), std::chrono::steady_clock::time_point::max());
+        } else if (!m_critical) {
+            moved = pushShared(std::min(level, m_priority_levels - 1), handlerPair);
+        } else {
+            // A free worker, else any running one.
+            size_t target = m_workers.size();
+            if (!freeWorkers.claimFreeWorker(target)) {
+                for (size_t i = 0; i < m_workers.size() && target == m_workers.size(); ++i) {
+                    if (m_workers[i]->state() == detail::WorkerState::Running) {
+                        target = i;
+                    }
+                }
+            }
+            if (target < m_workers.size() && m_workers[target]->postQueued(std::move(handlerPair), level)) {
+                moved = true;
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                // A worker retiring on its own never takes the lock.
+                while (m_workers[target]->state() == detail::WorkerState::Retiring) {
+                    std::this_thread::yield();
+                }
+                if (m_workers[target]->state() == detail::WorkerState::Retired) {
+                    restart(target, false);
+                }
+            }
+        }
+        if (moved) {
+            if (m_idle_event) {
+                m_idle_event->notifyOne();
+            }
+            continue;
+        }
+
+        // Every queue is full.
+        try {
+            handlerPair.first();
+        } catch (...) {
+            // suppress all exceptions
+            TP_LOG_WARN("{}. Exception during execution of {}.", __PRETTY_FUNCTION__, handlerPair.second.getName());
+        }
+        handlerPair.first = Task();
+    }
+}
+
+template <typename Task, template<typename> class Queue>
+inline bool ThreadPoolImpl<Task, Queue>::pushShared(size_t priority, std::pair<Task, ThreadParams>& handlerPair)
+{
+    // Cross to another node only when the local queue is full.
+    const size_t local = postingGroup();
+    for (size_t group = 0; group < m_node_queues.size(); ++group) {
+        const auto& queue = m_node_queues[(local + group) % m_node_queues.size()][priority];
+        if (queue->push(std::move(handlerPair))) {
+            detail::raise(m_shared_high_water.value, detail::queue_size(*queue, 0));
+            return true;
+        }
+    }
+    return false;
+}
 }
@@ -1,30 +1,100 @@
 #ifndef THREADPOOL_BLOCKING_QUEUE_H
 #define THREADPOOL_BLOCKING_QUEUE_H
 
+#include <thread_pool/event_count.hpp>
 #include <thread_pool/safe_queue.h>
 
+#include <atomic>
+
 namespace tp {
+/**
+ * @brief The BlockingQueue class is a bounded queue whose pop parks the
+ * caller until an item is pushed or the queue is closed.
+ * Parked consumers are woken through an EventCount, so an idle consumer
+ * never wakes up spuriously and close() releases all of them at once.
+ * Items are stored in a RingBuffer preallocated for 'size' items, so
+ * push and pop do not allocate.
+ */
 template<class T>
 class BlockingQueue {
 
 public:
-    //TODO: enable timeout via configuration
-    BlockingQueue(size_t size, std::uint64_t timeout = 10)
+    BlockingQueue(size_t size)
         : _decorableQueue(size)
-        , _timeout(timeout)
+        , _closed(false)
     {}
 
+    /**
+     * @brief pop Pops an item, blocking while the queue is empty.
+     * @param item The item.
+     * @return false if the queue is empty and was closed.
+     */
     bool pop(T& item) {
-        return _decorableQueue.timeout_move_pop(item, _timeout);
+        for (;;) {
+            if (_decorableQueue.try_move_pop(item)) {
+                return true;
+            }
+
+            auto key = _event.prepareWait();
+            if (_decorableQueue.try_move_pop(item)) {
+                _event.cancelWait();
+                return true;
+            }
+            if (_closed.load(std::memory_order_relaxed)) {
+                _event.cancelWait();
+                return false;
+            }
+            _event.commitWait(key);
+        }
+    }
+
+    /**
+     * @brief tryPop Pops an item without blocking.
+     * @param item The item.
+     * @return false if the queue is empty.
+     */
+    bool tryPop(T& item) {
+        return _decorableQueue.try_move_pop(item);
     }
 
     bool push(T&& item) {
-        return _decorableQueue.try_move_push(item);
+        if (!_decorableQueue.try_move_push(item)) {
+            return false;
+        }
+        _event.notifyOne();
+        return true;
+    }
+
+    /**
+     * @brief push_bulk Pushes up to count items under a single lock.
+     * @param first Iterator to the items. Only the pushed items are moved from.
+     * @param count Number of items available from first.
+     * @return Number of items pushed, 0 if the queue is full.
+     */
+    template <typename InputIt>
+    size_t push_bulk(InputIt first, size_t count) {
+        size_t pushed = _decorableQueue.try_move_push_bulk(first, count);
+        if (pushed > 1) {
+            _event.notifyAll();
+        } else if (pushed == 1) {
+            _event.notifyOne();
+        }
+        return pushed;
+    }
+
+    /**
+     * @brief close Wake all blocked consumers. Once the remaining items are
+     * popped, pop returns false instead of blocking.
+     */
+    void close() {
+        _closed.store(true, std::memory_order_relaxed);
+        _event.notifyAll();
     }
 
 private:
-    SafeQueue<T> _decorableQueue;
-    std::uint64_t _timeout;
+    SafeQueue<T, RingBuffer<T>> _decorableQueue;
+    EventCount _event;
+    std::atomic<bool> _closed;
 };
 }
 
@@ -1,11 +1,45 @@
 #pragma once
 
+#include <thread_pool/topology.hpp>
+
 #include <algorithm>
+#include <chrono>
+#include <memory>
 #include <thread>
+#include <vector>
 
 namespace tp
 {
 
+/**
+ * @brief The IdlePolicy enum defines what a worker does when it finds no
+ * task to execute.
+ */
+enum class IdlePolicy
+{
+    /// Poll again immediately. Lowest latency, burns a full core.
+    Spin,
+    /// Poll again after a CPU pause instruction.
+    SpinPause,
+    /// Spin with pause for spinCount polls, then yield between polls.
+    SpinYield,
+    /// Spin with pause for spinCount polls, then park until a task is posted.
+    SpinPark
+};
+
+/**
+ * @brief The PriorityScheduling enum defines how workers pick between the
+ * queues of the priority levels.
+ */
+enum class PriorityScheduling
+{
+    /// Always serve the most urgent non empty level first.
+    Strict,
+    /// Serve up to priorityWeight(level) tasks from each level in turn,
+    /// skipping empty levels. Low levels never starve.
+    Weighted
+};
+
 /**
  * @brief The ThreadPoolOptions class provides creation options for
  * ThreadPool.
@@ -24,6 +58,26 @@ public:
      */
     void setThreadCount(size_t count);
 
+    /**
+     * @brief setMinThreadCount Set the number of workers an elastic pool
+     * keeps running. Idle workers above it retire after idleTimeout.
+     * @param count Minimal thread count, capped to threadCount().
+     */
+    void setMinThreadCount(size_t count);
+
+    /**
+     * @brief setMaxThreadCount Set the number of workers an elastic pool
+     * may grow to when all of its running workers are busy.
+     * @param count Maximal thread count, raised to threadCount().
+     */
+    void setMaxThreadCount(size_t count);
+
+    /**
+     * @brief setIdleTimeout Set how long a worker of an elastic pool stays
+     * idle before it retires.
+     */
+    void setIdleTimeout(std::chrono::milliseconds timeout);
+
     /**
      * @brief setQueueSize Set single worker queue size.
      * @param count Maximum length of queue of single worker.
@@ -36,29 +90,253 @@ public:
      */
     void setCritical(bool critical);
 
+    /**
+     * @brief setWorkStealing Enable per-worker work-stealing deques.
+     * Tasks posted from inside a worker are pushed to its own deque and idle
+     * workers steal from their siblings. Ignored in critical mode.
+     * @param work_stealing True to enable work stealing.
+     */
+    void setWorkStealing(bool work_stealing);
+
+    /**
+     * @brief setIdlePolicy Set what idle workers do between polls.
+     * @param policy Idle policy.
+     */
+    void setIdlePolicy(IdlePolicy policy);
+
+    /**
+     * @brief setSpinCount Set number of empty polls before an idle worker
+     * yields or parks.
+     * @param count Number of polls.
+     */
+    void setSpinCount(size_t count);
+
+    /**
+     * @brief setPriorityLevels Set number of task priority levels. Every
+     * level gets its own queue, level 0 being the most urgent.
+     * @param levels Number of levels, at least 1.
+     */
+    void setPriorityLevels(size_t levels);
+
+    /**
+     * @brief setPriorityScheduling Set how workers pick between levels.
+     * @param scheduling Scheduling discipline.
+     */
+    void setPriorityScheduling(PriorityScheduling scheduling);
+
+    /**
+     * @brief setPriorityWeights Set weighted scheduling shares.
+     * @param weights Tasks served in a row per level. Missing or zero
+     * entries use the default weight.
+     */
+    void setPriorityWeights(const std::vector<size_t>& weights);
+
+    /**
+     * @brief setDeadlineScheduling Make critical pool workers share one
+     * earliest-deadline-first queue instead of owning a queue each. Any
+     * free worker takes the most urgent task. Ignored in non critical mode.
+     * @param deadline_scheduling True to enable deadline scheduling.
+     */
+    void setDeadlineScheduling(bool deadline_scheduling);
+
+    /**
+     * @brief setAffinityQueueSize Set size of the per-worker inbox taking
+     * jobs placed with postTo and postWithKey.
+     * @param size Power of 2 number of jobs, or 0 to disable placement.
+     * Workers without inbox may block in their queue instead of parking.
+     */
+    void setAffinityQueueSize(size_t size);
+
+    /**
+     * @brief setNumaAware Spread workers over the NUMA nodes and pin each
+     * one to a CPU of its node. Worker queues are allocated on the worker's
+     * node, non critical pools get one shared queue per node, and workers
+     * take tasks from their own node before crossing to another one.
+     * @param numa_aware True to enable NUMA awareness.
+     */
+    void setNumaAware(bool numa_aware);
+
+    /**
+     * @brief setTopology Set the topology used by NUMA aware pools instead
+     * of the one discovered from sysfs.
+     */
+    void setTopology(const Topology& topology);
+
+    /**
+     * @brief setLatencyHistograms Record how long jobs wait in the queues
+     * and how long they run, see ThreadPool::queueWaitHistogram. Costs a
+     * clock read per post and a histogram update per job.
+     * @param latency_histograms True to enable the histograms.
+     */
+    void setLatencyHistograms(bool latency_histograms);
+
+    /**
+     * @brief setTimedStats Measure busy and idle time of workers, see
+     * ThreadPool::stats. Costs two clock reads per job. On by default.
+     * @param timed_stats False to leave busy and idle time unmeasured.
+     */
+    void setTimedStats(bool timed_stats);
+
+    /**
+     * @brief setTraceBufferSize Make each worker trace task begin and end,
+     * steals and parking into a ring buffer of size events, see
+     * ThreadPool::flushTrace. Older events are overwritten when full.
+     * @param size Power of 2 number of events, or 0 to disable tracing.
+     */
+    void setTraceBufferSize(size_t size);
+
+    /**
+     * @brief setTaskBlockSize Set size of the slab blocks holding handlers
+     * too large for the internal storage of tasks, when the pool's task
+     * type is a FixedFunction with SlabFallback. The pool keeps queueSize()
+     * blocks; larger handlers, or any once the blocks run out, go to the
+     * heap.
+     * @param size Block size in bytes, or 0 to always use the heap.
+     */
+    void setTaskBlockSize(size_t size);
+
     /**
      * @brief threadCount Return thread count.
      */
     size_t threadCount() const;
 
+    /**
+     * @brief minThreadCount Return minimal thread count, threadCount() by
+     * default.
+     */
+    size_t minThreadCount() const;
+
+    /**
+     * @brief maxThreadCount Return maximal thread count, threadCount() by
+     * default. The pool is elastic if it exceeds minThreadCount().
+     */
+    size_t maxThreadCount() const;
+
+    /**
+     * @brief idleTimeout Return idle time after which workers retire.
+     */
+    std::chrono::milliseconds idleTimeout() const;
+
     /**
      * @brief queueSize Return single worker queue size.
      */
     size_t queueSize() const;
 
     bool critical() const;
+
+    /**
+     * @brief workStealing Return true if work stealing is enabled.
+     */
+    bool workStealing() const;
+
+    /**
+     * @brief idlePolicy Return idle policy.
+     */
+    IdlePolicy idlePolicy() const;
+
+    /**
+     * @brief spinCount Return number of empty polls before yield or park.
+     */
+    size_t spinCount() const;
+    /**
+     * @brief priorityLevels Return number of priority levels.
+     */
+    size_t priorityLevels() const;
+
+    /**
+     * @brief priorityScheduling Return scheduling discipline between levels.
+     */
+    PriorityScheduling priorityScheduling() const;
+
+    /**
+     * @brief priorityWeight Return weighted scheduling share of level.
+     * Defaults to priorityLevels() - level, so urgent levels get more.
+     */
+    size_t priorityWeight(size_t level) const;
+
+    /**
+     * @brief deadlineScheduling Return true if deadline scheduling is enabled.
+     */
+    bool deadlineScheduling() const;
+
+    /**
+     * @brief affinityQueueSize Return size of the per-worker inbox.
+     */
+    size_t affinityQueueSize() const;
+
+    /**
+     * @brief numaAware Return true if NUMA awareness is enabled.
+     */
+    bool numaAware() const;
+
+    /**
+     * @brief topology Return the topology set by setTopology, or discover it.
+     */
+    Topology topology() const;
+
+    /**
+     * @brief latencyHistograms Return true if latency histograms are enabled.
+     */
+    bool latencyHistograms() const;
+
+    /**
+     * @brief timedStats Return true if busy and idle time are measured.
+     */
+    bool timedStats() const;
+
+    /**
+     * @brief traceBufferSize Return size of the per-worker trace buffer.
+     */
+    size_t traceBufferSize() const;
+
+    /**
+     * @brief taskBlockSize Return size of the slab blocks of large handlers.
+     */
+    size_t taskBlockSize() const;
 private:
     size_t m_thread_count;
+    size_t m_min_thread_count;
+    size_t m_max_thread_count;
+    std::chrono::milliseconds m_idle_timeout;
     size_t m_queue_size;
     bool m_is_critical;
+    bool m_work_stealing;
+    IdlePolicy m_idle_policy;
+    size_t m_spin_count;
+    size_t m_priority_levels;
+    PriorityScheduling m_priority_scheduling;
+    std::vector<size_t> m_priority_weights;
+    bool m_deadline_scheduling;
+    size_t m_affinity_queue_size;
+    bool m_numa_aware;
+    std::shared_ptr<Topology> m_topology;
+    bool m_latency_histograms;
+    bool m_timed_stats;
+    size_t m_trace_buffer_size;
+    size_t m_task_block_size;
 };
 
 /// Implementation
 
 inline ThreadPoolOptions::ThreadPoolOptions()
     : m_thread_count(std::max<size_t>(1u, std::thread::hardware_concurrency()))
+    , m_min_thread_count(0u)
+    , m_max_thread_count(0u)
+    , m_idle_timeout(10000)
     , m_queue_size(1024u)
     , m_is_critical(false)
+    , m_work_stealing(false)
+    , m_idle_policy(IdlePolicy::Spin)
+    , m_spin_count(1024u)
+    , m_priority_levels(1u)
+    , m_priority_scheduling(PriorityScheduling::Strict)
+    , m_deadline_scheduling(false)
+    , m_affinity_queue_size(64u)
+    , m_numa_aware(false)
+    , m_latency_histograms(false)
+    , m_timed_stats(true)
+    , m_trace_buffer_size(0u)
+    , m_task_block_size(256u)
 {
 }
 
@@ -77,6 +355,36 @@ inline size_t ThreadPoolOptions::threadCount() const
     return m_thread_count;
 }
 
+inline void ThreadPoolOptions::setMinThreadCount(size_t count)
+{
+    m_min_thread_count = std::max<size_t>(1u, count);
+}
+
+inline void ThreadPoolOptions::setMaxThreadCount(size_t count)
+{
+    m_max_thread_count = count;
+}
+
+inline void ThreadPoolOptions::setIdleTimeout(std::chrono::milliseconds timeout)
+{
+    m_idle_timeout = timeout;
+}
+
+inline size_t ThreadPoolOptions::minThreadCount() const
+{
+    return m_min_thread_count ? std::min(m_min_thread_count, m_thread_count) : m_thread_count;
+}
+
+inline size_t ThreadPoolOptions::maxThreadCount() const
+{
+    return std::max(m_max_thread_count, m_thread_count);
+}
+
+inline std::chrono::milliseconds ThreadPoolOptions::idleTimeout() const
+{
+    return m_idle_timeout;
+}
+
 inline size_t ThreadPoolOptions::queueSize() const
 {
     return m_queue_size;
@@ -92,4 +400,147 @@ inline bool ThreadPoolOptions::critical() const
     return m_is_critical;
 }
 
+inline void ThreadPoolOptions::setWorkStealing(bool work_stealing)
+{
+    m_work_stealing = work_stealing;
+}
+
+inline bool ThreadPoolOptions::workStealing() const
+{
+    return m_work_stealing;
+}
+
+inline void ThreadPoolOptions::setIdlePolicy(IdlePolicy policy)
+{
+    m_idle_policy = policy;
+}
+
+inline IdlePolicy ThreadPoolOptions::idlePolicy() const
+{
+    return m_idle_policy;
+}
+
+inline void ThreadPoolOptions::setSpinCount(size_t count)
+{
+    m_spin_count = count;
+}
+
+inline size_t ThreadPoolOptions::spinCount() const
+{
+    return m_spin_count;
+}
+
+inline void ThreadPoolOptions::setPriorityLevels(size_t levels)
+{
+    m_priority_levels = std::max<size_t>(1u, levels);
+}
+
+inline size_t ThreadPoolOptions::priorityLevels() const
+{
+    return m_priority_levels;
+}
+
+inline void ThreadPoolOptions::setPriorityScheduling(PriorityScheduling scheduling)
+{
+    m_priority_scheduling = scheduling;
+}
+
+inline PriorityScheduling ThreadPoolOptions::priorityScheduling() const
+{
+    return m_priority_scheduling;
+}
+
+inline void ThreadPoolOptions::setPriorityWeights(const std::vector<size_t>& weights)
+{
+    m_priority_weights = weights;
+}
+
+inline size_t ThreadPoolOptions::priorityWeight(size_t level) const
+{
+    if (level < m_priority_weights.size() && m_priority_weights[level] > 0) {
+        return m_priority_weights[level];
+    }
+    return level < m_priority_levels ? m_priority_levels - level : 1u;
+}
+
+inline void ThreadPoolOptions::setDeadlineScheduling(bool deadline_scheduling)
+{
+    m_deadline_scheduling = deadline_scheduling;
+}
+
+inline bool ThreadPoolOptions::deadlineScheduling() const
+{
+    return m_deadline_scheduling;
+}
+
+inline void ThreadPoolOptions::setAffinityQueueSize(size_t size)
+{
+    m_affinity_queue_size = size;
+}
+
+inline size_t ThreadPoolOptions::affinityQueueSize() const
+{
+    return m_affinity_queue_size;
+}
+
+inline void ThreadPoolOptions::setNumaAware(bool numa_aware)
+{
+    m_numa_aware = numa_aware;
+}
+
+inline bool ThreadPoolOptions::numaAware() const
+{
+    return m_numa_aware;
+}
+
+inline void ThreadPoolOptions::setTopology(const Topology& topology)
+{
+    m_topology = std::make_shared<Topology>(topology);
+}
+
+inline Topology ThreadPoolOptions::topology() const
+{
+    return m_topology ? *m_topology : Topology::discover();
+}
+
+inline void ThreadPoolOptions::setLatencyHistograms(bool latency_histograms)
+{
+    m_latency_histograms = latency_histograms;
+}
+
+inline bool ThreadPoolOptions::latencyHistograms() const
+{
+    return m_latency_histograms;
+}
+
+inline void ThreadPoolOptions::setTimedStats(bool timed_stats)
+{
+    m_timed_stats = timed_stats;
+}
+
+inline bool ThreadPoolOptions::timedStats() const
+{
+    return m_timed_stats;
+}
+
+inline void ThreadPoolOptions::setTraceBufferSize(size_t size)
+{
+    m_trace_buffer_size = size;
+}
+
+inline size_t ThreadPoolOptions::traceBufferSize() const
+{
+    return m_trace_buffer_size;
+}
+
+inline void ThreadPoolOptions::setTaskBlockSize(size_t size)
+{
+    m_task_block_size = size;
+}
+
+inline size_t ThreadPoolOptions::taskBlockSize() const
+{
+    return m_task_block_size;
+}
+
 }
@@ -0,0 +1,393 @@
+#pragma once
+
+#include <thread_pool/logging.hpp>
+#include <thread_pool/thread_params.hpp>
+#include <thread_pool/timer_wheel.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace tp
+{
+
+/**
+ * @brief TimerId Identifies a timer scheduled on a pool. Never 0.
+ */
+typedef std::uint64_t TimerId;
+
+namespace detail
+{
+
+/**
+ * @brief The TimerScheduler class runs the timer thread of a pool.
+ * Timers sit in a TimerWheel with one millisecond ticks. The thread sleeps
+ * until the wheel's next tick and then posts a small TimerTask for every
+ * expired timer to the pool, so handlers run on the workers. Handlers stay
+ * in the scheduler meanwhile: a TimerTask the pool rejects or drops puts
+ * its timer back for the next tick. Periodic timers are re-armed when their
+ * run finishes, so runs of one timer never overlap and do not drift.
+ */
+template <typename Task, typename Pool>
+class TimerScheduler : public std::enable_shared_from_this<TimerScheduler<Task, Pool>>
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * @brief TimerScheduler Constructor. Starts the timer thread.
+     * @param pool Pool to post expired timers to. Must outlive stop().
+     */
+    static std::shared_ptr<TimerScheduler> create(Pool& pool);
+
+    /**
+     * @brief stop Join the timer thread. Timers are not posted anymore.
+     */
+    void stop();
+
+    /**
+     * @brief schedule Add a timer.
+     * @param handler Handler to run.
+     * @param due First time to run it at.
+     * @param period Period of a periodic timer, zero for a one-shot timer.
+     * @param params Thread name and affinity to post the handler with.
+     */
+    template <typename Handler>
+    TimerId schedule(Handler&& handler, Clock::time_point due, Clock::duration period,
+                     const ThreadParams& params);
+
+    /**
+     * @brief cancel Prevent the future runs of a timer.
+     * @return false if the timer already ran or is running its last run.
+     */
+    bool cancel(TimerId id);
+
+private:
+    enum class State
+    {
+        Free,
+        Armed,
+        Posted,
+        Running
+    };
+
+    struct Expired
+    {
+        std::uint32_t index;
+        std::uint32_t generation;
+        ThreadParams params;
+    };
+
+    struct Node
+    {
+        Task task;
+        ThreadParams params;
+        Clock::time_point due;
+        Clock::duration period;
+        std::uint32_t generation;
+        State state;
+        bool cancelled;
+    };
+
+    /**
+     * @brief The TimerTask class is what gets posted to the pool for an
+     * expired timer.
+     */
+    class TimerTask
+    {
+    public:
+        TimerTask(std::shared_ptr<TimerScheduler> owner, std::uint32_t index, std::uint32_t generation)
+            : m_owner(std::move(owner)), m_index(index), m_generation(generation)
+        {}
+
+        TimerTask(TimerTask&& rhs) = default;
+
+        ~TimerTask()
+        {
+            if (m_owner) {
+                m_owner->dropped(m_index, m_generation);
+            }
+        }
+
+        void operator()()
+        {
+            std::shared_ptr<TimerScheduler> owner = std::move(m_owner);
+            owner->run(m_index, m_generation);
+        }
+
+    private:
+        TimerTask(const TimerTask&) = delete;
+        TimerTask& operator=(const TimerTask&) = delete;
+        TimerTask& operator=(TimerTask&&) = delete;
+
+        std::shared_ptr<TimerScheduler> m_owner;
+        std::uint32_t m_index;
+        std::uint32_t m_generation;
+    };
+
+    explicit TimerScheduler(Pool& pool);
+
+    TimerScheduler(const TimerScheduler&) = delete;
+    TimerScheduler& operator=(const TimerScheduler&) = delete;
+
+    void threadFunc();
+
+    void run(std::uint32_t index, std::uint32_t generation);
+
+    void dropped(std::uint32_t index, std::uint32_t generation);
+
+    // The helpers below expect m_mutex to be held.
+    std::uint64_t tickOf(Clock::time_point time) const;
+    void arm(std::uint32_t index, Clock::time_point due);
+    void release(std::uint32_t index);
+
+    static const std::chrono::milliseconds TICK;
+
+    Pool& m_pool;
+    const Clock::time_point m_start;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    TimerWheel m_wheel;
+    std::deque<Node> m_nodes;
+    std::vector<std::uint32_t> m_free;
+    std::uint64_t m_wake_tick;
+    bool m_running;
+    std::thread m_thread;
+};
+
+template <typename Task, typename Pool>
+const std::chrono::milliseconds TimerScheduler<Task, Pool>::TICK(1);
+
+
+/// Implementation
+
+template <typename Task, typename Pool>
+inline std::shared_ptr<TimerScheduler<Task, Pool>> TimerScheduler<Task, Pool>::create(Pool& pool)
+{
+    std::shared_ptr<TimerScheduler> scheduler(new TimerScheduler(pool));
+    scheduler->m_thread = std::thread(&TimerScheduler::threadFunc, scheduler.get());
+    return scheduler;
+}
+
+template <typename Task, typename Pool>
+inline TimerScheduler<Task, Pool>::TimerScheduler(Pool& pool)
+    : m_pool(pool)
+    , m_start(Clock::now())
+    , m_wake_tick(TimerWheel::NEVER)
+    , m_running(true)
+{
+}
+
+template <typename Task, typename Pool>
+inline void TimerScheduler<Task, Pool>::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+    }
+    m_cv.notify_one();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+template <typename Task, typename Pool>
+template <typename Handler>
+inline TimerId TimerScheduler<Task, Pool>::schedule(Handler&& handler, Clock::time_point due,
+                                                    Clock::duration period, const ThreadParams& params)
+{
+    Task task(std::forward<Handler>(handler));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::uint32_t index;
+    if (m_free.empty()) {
+        index = static_cast<std::uint32_t>(m_nodes.size());
+        m_nodes.push_back(Node{Task(), ThreadParams(), due, period, 1, State::Free, false});
+    } else {
+        index = m_free.back();
+        m_free.pop_back();
+    }
+
+    Node& node = m_nodes[index];
+    node.task = std::move(task);
+    node.params = params;
+    node.period = period;
+    node.cancelled = false;
+    arm(index, due);
+
+    return (TimerId(node.generation) << 32) | index;
+}
+
+template <typename Task, typename Pool>
+inline bool TimerScheduler<Task, Pool>::cancel(TimerId id)
+{
+    const std::uint32_t index = static_cast<std::uint32_t>(id);
+    const std::uint32_t generation = static_cast<std::uint32_t>(id >> 32);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (index >= m_nodes.size()) {
+        return false;
+    }
+    Node& node = m_nodes[index];
+    if (node.generation != generation || node.cancelled || node.state == State::Free) {
+        return false;
+    }
+
+    switch (node.state) {
+    case State::Armed:
+        m_wheel.remove(index);
+        release(index);
+        return true;
+    case State::Running:
+        if (node.period == Clock::duration::zero()) {
+            return false;
+        }
+        node.cancelled = true;
+        return true;
+    default:
+        // Posted: the TimerTask releases the node instead of running it.
+        node.cancelled = true;
+        return true;
+    }
+}
+
+template <typename Task, typename Pool>
+inline void TimerScheduler<Task, Pool>::threadFunc()
+{
+    std::vector<Expired> expired;
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (m_running) {
+        const std::uint64_t now = static_cast<std::uint64_t>((Clock::now() - m_start) / TICK);
+        m_wheel.advance(now, [this, &expired](std::uint32_t index) {
+            Node& node = m_nodes[index];
+            node.state = State::Posted;
+            expired.push_back(Expired{index, node.generation, node.params});
+        });
+
+        if (!expired.empty()) {
+            // Rejected tasks re-arm themselves, which takes the lock.
+            lock.unlock();
+            auto self = this->shared_from_this();
+            for (const auto& timer : expired) {
+                m_pool.tryPost(TimerTask(self, timer.index, timer.generation), timer.params);
+            }
+            expired.clear();
+            lock.lock();
+            continue;
+        }
+
+        m_wake_tick = m_wheel.nextTick();
+        if (m_wake_tick == TimerWheel::NEVER) {
+            m_cv.wait(lock);
+        } else {
+            m_cv.wait_until(lock, m_start + TICK * static_cast<std::chrono::milliseconds::rep>(m_wake_tick));
+        }
+        m_wake_tick = TimerWheel::NEVER;
+    }
+}
+
+template <typename Task, typename Pool>
+inline void TimerScheduler<Task, Pool>::run(std::uint32_t index, std::uint32_t generation)
+{
+    Task* task;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Node& node = m_nodes[index];
+        if (node.generation != generation) {
+            return;
+        }
+        if (node.cancelled) {
+            release(index);
+            return;
+        }
+        node.state = State::Running;
+        // Deque elements never move, so the task may run unlocked.
+        task = &node.task;
+    }
+
+    try {
+        (*task)();
+    } catch (...) {
+        // suppress all exceptions
+        TP_LOG_WARN("{}. Exception during execution of timer.", __PRETTY_FUNCTION__);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Node& node = m_nodes[index];
+    if (node.period == Clock::duration::zero() || node.cancelled || !m_running) {
+        release(index);
+        return;
+    }
+
+    // Skip the periods the run overran instead of catching up.
+    Clock::time_point due = node.due + node.period;
+    const Clock::time_point now = Clock::now();
+    if (due <= now) {
+        due += node.period * ((now - due) / node.period + 1);
+    }
+    arm(index, due);
+}
+
+template <typename Task, typename Pool>
+inline void TimerScheduler<Task, Pool>::dropped(std::uint32_t index, std::uint32_t generation)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Node& node = m_nodes[index];
+    if (node.generation != generation) {
+        return;
+    }
+    if (node.cancelled || !m_running) {
+        release(index);
+        return;
+    }
+    // The pool queue was full: retry on the next tick.
+    arm(index, node.due);
+}
+
+template <typename Task, typename Pool>
+inline std::uint64_t TimerScheduler<Task, Pool>::tickOf(Clock::time_point time) const
+{
+    if (time <= m_start) {
+        return 0;
+    }
+    // Round up, so timers never fire early.
+    return static_cast<std::uint64_t>((time - m_start + TICK - Clock::duration(1)) / TICK);
+}
+
+template <typename Task, typename Pool>
+inline void TimerScheduler<Task, Pool>::arm(std::uint32_t index, Clock::time_point due)
+{
+    Node& node = m_nodes[index];
+    node.due = due;
+    node.state = State::Armed;
+    const std::uint64_t tick = tickOf(due);
+    m_wheel.insert(index, tick);
+    if (std::max(tick, m_wheel.currentTick() + 1) < m_wake_tick) {
+        m_cv.notify_one();
+    }
+}
+
+template <typename Task, typename Pool>
+inline void TimerScheduler<Task, Pool>::release(std::uint32_t index)
+{
+    Node& node = m_nodes[index];
+    node.task = Task();
+    node.state = State::Free;
+    ++node.generation;
+    if (node.generation == 0) {
+        node.generation = 1;
+    }
+    m_free.push_back(index);
+}
+
+}
+
+}
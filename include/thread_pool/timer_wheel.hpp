@@ -0,0 +1,247 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace tp
+{
+
+/**
+ * @brief The TimerWheel class is a hierarchical timing wheel keeping timer
+ * ids sorted by expiry tick.
+ * There are LEVELS wheels of SLOTS slots, each slot of a level spanning a
+ * whole rotation of the level below. A timer is linked into the lowest
+ * level its expiry shares the upper digits with the current tick, so
+ * insert and remove are O(1), and timers move one level down each time the
+ * slot they sit in comes up. Timers further away than the top level wait
+ * in an overflow list scanned once per top level rotation.
+ * Ids are small integers chosen by the caller, used to index link storage.
+ * The class is not thread safe.
+ */
+class TimerWheel
+{
+public:
+    static const unsigned LEVEL_BITS = 6;
+    static const unsigned SLOTS = 1u << LEVEL_BITS;
+    static const unsigned LEVELS = 4;
+    static const std::uint64_t NEVER = std::numeric_limits<std::uint64_t>::max();
+
+    /**
+     * @brief TimerWheel Constructor.
+     * @param tick Initial current tick.
+     */
+    explicit TimerWheel(std::uint64_t tick = 0);
+
+    /**
+     * @brief insert Add a timer. Timers expiring at or before the current
+     * tick expire on the next one.
+     * @param id Timer id, not currently inserted.
+     * @param expiry Tick to expire at.
+     */
+    void insert(std::uint32_t id, std::uint64_t expiry);
+
+    /**
+     * @brief remove Remove an inserted timer that did not expire yet.
+     * @param id Timer id.
+     */
+    void remove(std::uint32_t id);
+
+    /**
+     * @brief advance Move the current tick forward, calling expired(id) for
+     * every timer expiring on the way, in expiry order. Expired timers are
+     * removed before the call.
+     * @param tick New current tick.
+     * @param expired Callable as 'expired(std::uint32_t)'.
+     */
+    template <typename Callback>
+    void advance(std::uint64_t tick, Callback&& expired);
+
+    /**
+     * @brief nextTick Return the first tick after the current one at which
+     * advance has work to do, or NEVER if no timer is inserted.
+     */
+    std::uint64_t nextTick() const;
+
+    /**
+     * @brief currentTick Return the tick advanced to.
+     */
+    std::uint64_t currentTick() const;
+
+    /**
+     * @brief size Return number of inserted timers.
+     */
+    size_t size() const;
+
+private:
+    static const std::uint32_t NIL = 0xffffffffu;
+    static const unsigned OVERFLOW_LIST = LEVELS * SLOTS;
+
+    struct Link
+    {
+        std::uint64_t expiry;
+        std::uint32_t prev;
+        std::uint32_t next;
+        unsigned list;
+    };
+
+    static unsigned digit(std::uint64_t tick, unsigned level);
+
+    void place(std::uint32_t id, std::uint64_t earliest);
+    void link(std::uint32_t id, unsigned list);
+    void unlink(std::uint32_t id);
+    void cascade(unsigned list);
+
+    std::vector<Link> m_links;
+    std::uint32_t m_heads[LEVELS * SLOTS + 1];
+    std::uint64_t m_current;
+    size_t m_size;
+};
+
+
+/// Implementation
+
+inline TimerWheel::TimerWheel(std::uint64_t tick)
+    : m_current(tick)
+    , m_size(0)
+{
+    for (auto& head : m_heads) {
+        head = NIL;
+    }
+}
+
+inline void TimerWheel::insert(std::uint32_t id, std::uint64_t expiry)
+{
+    if (id >= m_links.size()) {
+        m_links.resize(id + 1);
+    }
+    m_links[id].expiry = expiry;
+    place(id, m_current + 1);
+    ++m_size;
+}
+
+inline void TimerWheel::remove(std::uint32_t id)
+{
+    unlink(id);
+    --m_size;
+}
+
+template <typename Callback>
+inline void TimerWheel::advance(std::uint64_t tick, Callback&& expired)
+{
+    for (;;) {
+        const std::uint64_t next = nextTick();
+        if (next > tick) {
+            m_current = std::max(m_current, tick);
+            return;
+        }
+        m_current = next;
+
+        // Upper levels first, so their timers can go down several levels.
+        if ((m_current & ((std::uint64_t(1) << (LEVEL_BITS * LEVELS)) - 1)) == 0) {
+            cascade(OVERFLOW_LIST);
+        }
+        for (unsigned level = LEVELS - 1; level > 0; --level) {
+            if ((m_current & ((std::uint64_t(1) << (LEVEL_BITS * level)) - 1)) == 0) {
+                cascade(level * SLOTS + digit(m_current, level));
+            }
+        }
+
+        const unsigned list = digit(m_current, 0);
+        while (m_heads[list] != NIL) {
+            const std::uint32_t id = m_heads[list];
+            unlink(id);
+            --m_size;
+            expired(id);
+        }
+    }
+}
+
+inline std::uint64_t TimerWheel::nextTick() const
+{
+    if (m_size == 0) {
+        return NEVER;
+    }
+
+    // Level l only holds slots after the current digit of the current
+    // rotation, and everything due in the rest of that rotation lives in
+    // the levels below.
+    for (unsigned level = 0; level < LEVELS; ++level) {
+        const unsigned shift = LEVEL_BITS * level;
+        for (unsigned slot = digit(m_current, level) + 1; slot < SLOTS; ++slot) {
+            if (m_heads[level * SLOTS + slot] != NIL) {
+                const std::uint64_t rotation = m_current >> (shift + LEVEL_BITS) << (shift + LEVEL_BITS);
+                return rotation | (std::uint64_t(slot) << shift);
+            }
+        }
+    }
+    const unsigned shift = LEVEL_BITS * LEVELS;
+    return ((m_current >> shift) + 1) << shift;
+}
+
+inline std::uint64_t TimerWheel::currentTick() const
+{
+    return m_current;
+}
+
+inline size_t TimerWheel::size() const
+{
+    return m_size;
+}
+
+inline unsigned TimerWheel::digit(std::uint64_t tick, unsigned level)
+{
+    return static_cast<unsigned>(tick >> (LEVEL_BITS * level)) & (SLOTS - 1);
+}
+
+inline void TimerWheel::place(std::uint32_t id, std::uint64_t earliest)
+{
+    const std::uint64_t expiry = std::max(m_links[id].expiry, earliest);
+    for (unsigned level = 0; level < LEVELS; ++level) {
+        const unsigned upper = LEVEL_BITS * (level + 1);
+        if ((expiry >> upper) == (m_current >> upper)) {
+            link(id, level * SLOTS + digit(expiry, level));
+            return;
+        }
+    }
+    link(id, OVERFLOW_LIST);
+}
+
+inline void TimerWheel::link(std::uint32_t id, unsigned list)
+{
+    Link& node = m_links[id];
+    node.list = list;
+    node.prev = NIL;
+    node.next = m_heads[list];
+    if (node.next != NIL) {
+        m_links[node.next].prev = id;
+    }
+    m_heads[list] = id;
+}
+
+inline void TimerWheel::unlink(std::uint32_t id)
+{
+    Link& node = m_links[id];
+    if (node.prev != NIL) {
+        m_links[node.prev].next = node.next;
+    } else {
+        m_heads[node.list] = node.next;
+    }
+    if (node.next != NIL) {
+        m_links[node.next].prev = node.prev;
+    }
+}
+
+inline void TimerWheel::cascade(unsigned list)
+{
+    std::uint32_t id = m_heads[list];
+    m_heads[list] = NIL;
+    while (id != NIL) {
+        const std::uint32_t next = m_links[id].next;
+        place(id, m_current);
+        id = next;
+    }
+}
+
+}
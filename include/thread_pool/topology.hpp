@@ -0,0 +1,229 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__rtems__)
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace tp
+{
+
+/**
+ * @brief The Topology class describes the NUMA nodes of the machine and the
+ * CPUs belonging to each of them.
+ */
+class Topology
+{
+public:
+    struct Node
+    {
+        /// Node number as known to the operating system.
+        size_t id;
+        /// CPUs of the node, in ascending order.
+        std::vector<int> cpus;
+    };
+
+    /**
+     * @brief Topology Construct a single node holding all CPUs.
+     */
+    Topology();
+
+    /**
+     * @brief Topology Construct from a known node list.
+     * @param nodes Nodes. Nodes without CPUs are dropped.
+     */
+    explicit Topology(std::vector<Node> nodes);
+
+    /**
+     * @brief discover Read the topology from sysfs.
+     * @param root Directory holding the 'nodeN/cpulist' files.
+     * @return Discovered nodes, or a single node holding all CPUs if the
+     * directory is missing or lists no CPU.
+     */
+    static Topology discover(const std::string& root = "/sys/devices/system/node");
+
+    /**
+     * @brief parseCpuList Parse a kernel cpu list such as "0-3,8,10-11".
+     * @return CPUs in ascending order. Malformed entries are skipped.
+     */
+    static std::vector<int> parseCpuList(const std::string& list);
+
+    /**
+     * @brief nodeCount Return number of nodes, at least 1.
+     */
+    size_t nodeCount() const;
+
+    /**
+     * @brief node Return node by index, not by operating system id.
+     */
+    const Node& node(size_t index) const;
+
+    /**
+     * @brief nodeOfCpu Return index of the node holding cpu, 0 if unknown.
+     */
+    size_t nodeOfCpu(int cpu) const;
+
+    /**
+     * @brief runOnNode Call f on a thread pinned to the CPUs of a node and
+     * wait for it. The kernel allocates pages on the node of the CPU first
+     * touching them, so memory f initializes ends up local to the node.
+     * @param index Node index.
+     * @param f Callable as 'f()'. Its exceptions are rethrown.
+     */
+    template <typename F>
+    void runOnNode(size_t index, F&& f) const;
+
+private:
+    std::vector<Node> m_nodes;
+};
+
+
+/// Implementation
+
+inline Topology::Topology()
+{
+    Node node;
+    node.id = 0;
+    const int count = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    for (int cpu = 0; cpu < count; ++cpu) {
+        node.cpus.push_back(cpu);
+    }
+    m_nodes.push_back(node);
+}
+
+inline Topology::Topology(std::vector<Node> nodes)
+{
+    for (auto& node : nodes) {
+        if (!node.cpus.empty()) {
+            m_nodes.push_back(std::move(node));
+        }
+    }
+    if (m_nodes.empty()) {
+        *this = Topology();
+    }
+    std::sort(m_nodes.begin(), m_nodes.end(), [](const Node& lhs, const Node& rhs) {
+        return lhs.id < rhs.id;
+    });
+}
+
+inline Topology Topology::discover(const std::string& root)
+{
+    std::vector<Node> nodes;
+#if defined(__unix__) || defined(__rtems__)
+    if (DIR* dir = opendir(root.c_str())) {
+        while (const dirent* entry = readdir(dir)) {
+            const std::string name = entry->d_name;
+            if (name.size() <= 4 || name.compare(0, 4, "node") != 0 ||
+                name.find_first_not_of("0123456789", 4) != std::string::npos) {
+                continue;
+            }
+            std::ifstream file(root + "/" + name + "/cpulist");
+            std::string list;
+            if (std::getline(file, list)) {
+                Node node;
+                node.id = std::strtoul(name.c_str() + 4, nullptr, 10);
+                node.cpus = parseCpuList(list);
+                nodes.push_back(node);
+            }
+        }
+        closedir(dir);
+    }
+#else
+    (void)root;
+#endif
+    return Topology(std::move(nodes));
+}
+
+inline std::vector<int> Topology::parseCpuList(const std::string& list)
+{
+    std::vector<int> cpus;
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t end = list.find(',', pos);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        const std::string range = list.substr(pos, end - pos);
+        pos = end + 1;
+
+        char* tail = nullptr;
+        const long first = std::strtol(range.c_str(), &tail, 10);
+        if (tail == range.c_str() || first < 0) {
+            continue;
+        }
+        long last = first;
+        if (*tail == '-') {
+            const char* from = tail + 1;
+            last = std::strtol(from, &tail, 10);
+            if (tail == from || last < first) {
+                continue;
+            }
+        }
+        for (long cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+inline size_t Topology::nodeCount() const
+{
+    return m_nodes.size();
+}
+
+inline const Topology::Node& Topology::node(size_t index) const
+{
+    return m_nodes[index];
+}
+
+inline size_t Topology::nodeOfCpu(int cpu) const
+{
+    for (size_t index = 0; index < m_nodes.size(); ++index) {
+        if (std::binary_search(m_nodes[index].cpus.begin(), m_nodes[index].cpus.end(), cpu)) {
+            return index;
+        }
+    }
+    return 0;
+}
+
+template <typename F>
+inline void Topology::runOnNode(size_t index, F&& f) const
+{
+#if defined(__unix__) || defined(__rtems__)
+    const std::vector<int>& cpus = m_nodes[index].cpus;
+    std::exception_ptr error;
+    std::thread thread([&cpus, &f, &error]() {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        for (int cpu : cpus) {
+            CPU_SET(cpu, &cpuset);
+        }
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+        try {
+            f();
+        } catch (...) {
+            error = std::current_exception();
+        }
+    });
+    thread.join();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+#else
+    (void)index;
+    f();
+#endif
+}
+
+}
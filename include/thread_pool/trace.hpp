@@ -0,0 +1,233 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+namespace tp
+{
+
+/**
+ * @brief The TraceEventType enum lists what a worker traces.
+ */
+enum class TraceEventType : std::uint8_t
+{
+    /// A task starts running. Named after its ThreadParams.
+    TaskBegin,
+    /// The running task ended.
+    TaskEnd,
+    /// A task was stolen from a sibling.
+    Steal,
+    /// The worker parks, out of tasks.
+    Park,
+    /// The parked worker woke up.
+    Wake
+};
+
+/**
+ * @brief The TraceEvent struct is one traced event.
+ */
+struct TraceEvent
+{
+    /// Time since the steady clock epoch.
+    std::chrono::nanoseconds time;
+    /// Task name for TaskBegin, interned by ThreadParams. May be null.
+    const std::string* name;
+    TraceEventType type;
+};
+
+namespace detail
+{
+    /**
+     * @brief The TraceBuffer class is a ring of trace events written by one
+     * thread and read by another without locks. When full, new events
+     * overwrite the oldest ones. A reader racing with the writer skips the
+     * events it may have seen half overwritten, like a seqlock reader.
+     */
+    class TraceBuffer
+    {
+    public:
+        /**
+         * @brief TraceBuffer Constructor.
+         * @param size Power of 2 number of events kept.
+         * @throws std::invalid_argument if size is bad.
+         */
+        explicit TraceBuffer(size_t size);
+
+        /**
+         * @brief record Append an event. Writer thread only.
+         */
+        void record(TraceEventType type, std::chrono::steady_clock::time_point time,
+                    const std::string* name = nullptr);
+
+        /**
+         * @brief consume Call f for each event recorded since the previous
+         * call, oldest first. One reader at a time.
+         * @param f Callable as 'f(const TraceEvent&)'.
+         * @return Number of events passed to f.
+         */
+        template <typename F>
+        size_t consume(F&& f);
+
+    private:
+        struct Slot
+        {
+            std::atomic<std::int64_t> time;
+            std::atomic<const std::string*> name;
+            std::atomic<TraceEventType> type;
+        };
+
+        typedef char Cacheline[64];
+
+        std::unique_ptr<Slot[]> m_slots;
+        const std::uint64_t m_mask;
+        std::uint64_t m_tail;
+        Cacheline pad0;
+        std::atomic<std::uint64_t> m_reserved;
+        std::atomic<std::uint64_t> m_head;
+        Cacheline pad1;
+    };
+
+    /**
+     * @brief write_json_string Write s as a quoted JSON string.
+     */
+    inline void write_json_string(std::ostream& out, const std::string& s)
+    {
+        out << '"';
+        for (char c : s) {
+            if (c == '"' || c == '\\') {
+                out << '\\' << c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                out << escaped;
+            } else {
+                out << c;
+            }
+        }
+        out << '"';
+    }
+
+    /**
+     * @brief write_chrome_event Write an event of thread tid in Chrome trace
+     * event format, preceded by a comma unless first.
+     */
+    inline void write_chrome_event(std::ostream& out, size_t tid, const TraceEvent& event, bool& first)
+    {
+        static const std::string task = "task";
+        static const std::string steal = "steal";
+        static const std::string park = "park";
+
+        const char* phase = "i";
+        const std::string* name = &steal;
+        switch (event.type) {
+        case TraceEventType::TaskBegin:
+            phase = "B";
+            name = (event.name && !event.name->empty()) ? event.name : &task;
+            break;
+        case TraceEventType::TaskEnd:
+            phase = "E";
+            name = &task;
+            break;
+        case TraceEventType::Steal:
+            break;
+        case TraceEventType::Park:
+            phase = "B";
+            name = &park;
+            break;
+        case TraceEventType::Wake:
+            phase = "E";
+            name = &park;
+            break;
+        }
+
+        char ts[32];
+        std::snprintf(ts, sizeof(ts), "%lld.%03lld",
+                      static_cast<long long>(event.time.count() / 1000),
+                      static_cast<long long>(event.time.count() % 1000));
+        out << (first ? "\n" : ",\n") << "{\"name\":";
+        write_json_string(out, *name);
+        out << ",\"ph\":\"" << phase << "\",\"ts\":" << ts << ",\"pid\":0,\"tid\":" << tid;
+        if (event.type == TraceEventType::Steal) {
+            out << ",\"s\":\"t\"";
+        }
+        out << '}';
+        first = false;
+    }
+}
+
+
+/// Implementation
+
+namespace detail
+{
+    inline TraceBuffer::TraceBuffer(size_t size)
+        : m_slots(new Slot[size > 0 ? size : 1])
+        , m_mask(size - 1)
+        , m_tail(0)
+        , m_reserved(0)
+        , m_head(0)
+    {
+        bool size_is_power_of_2 = (size >= 2) && ((size & (size - 1)) == 0);
+        if (!size_is_power_of_2) {
+            throw std::invalid_argument("buffer size should be a power of 2");
+        }
+        for (size_t i = 0; i < size; ++i) {
+            m_slots[i].time.store(0, std::memory_order_relaxed);
+            m_slots[i].name.store(nullptr, std::memory_order_relaxed);
+            m_slots[i].type.store(TraceEventType::TaskBegin, std::memory_order_relaxed);
+        }
+    }
+
+    inline void TraceBuffer::record(TraceEventType type, std::chrono::steady_clock::time_point time,
+                                    const std::string* name)
+    {
+        const std::uint64_t pos = m_head.load(std::memory_order_relaxed);
+        // Announce the slot before overwriting it, for racing readers.
+        m_reserved.store(pos + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        Slot& slot = m_slots[pos & m_mask];
+        slot.time.store(std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count(),
+                        std::memory_order_relaxed);
+        slot.name.store(name, std::memory_order_relaxed);
+        slot.type.store(type, std::memory_order_relaxed);
+        m_head.store(pos + 1, std::memory_order_release);
+    }
+
+    template <typename F>
+    inline size_t TraceBuffer::consume(F&& f)
+    {
+        const std::uint64_t size = m_mask + 1;
+        const std::uint64_t head = m_head.load(std::memory_order_acquire);
+        std::uint64_t first = std::max(m_tail, head > size ? head - size : 0);
+
+        std::unique_ptr<TraceEvent[]> events(new TraceEvent[head - first]);
+        for (std::uint64_t pos = first; pos < head; ++pos) {
+            const Slot& slot = m_slots[pos & m_mask];
+            TraceEvent& event = events[pos - first];
+            event.time = std::chrono::nanoseconds(slot.time.load(std::memory_order_relaxed));
+            event.name = slot.name.load(std::memory_order_relaxed);
+            event.type = slot.type.load(std::memory_order_relaxed);
+        }
+
+        // Slots the writer reserved meanwhile may have been read torn.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const std::uint64_t reserved = m_reserved.load(std::memory_order_relaxed);
+        const std::uint64_t valid = std::max(first, reserved > size ? reserved - size : 0);
+
+        for (std::uint64_t pos = valid; pos < head; ++pos) {
+            f(static_cast<const TraceEvent&>(events[pos - first]));
+        }
+        m_tail = head;
+        return static_cast<size_t>(head - std::min(valid, head));
+    }
+}
+
+}
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace tp
+{
+
+/**
+ * @brief The WorkStealingQueue class implements bounded single-owner
+ * work-stealing deque.
+ * The owner thread pushes and pops at the bottom (LIFO), any other thread
+ * may steal from the top (FIFO).
+ * Based on the Chase-Lev deque ("Dynamic Circular Work-Stealing Deque",
+ * Chase & Lev 2005) with the memory ordering of Le et al. 2013.
+ * Every cell carries a 'full' flag which is cleared only once the stolen
+ * or popped value was moved out, so the owner never overwrites a cell that
+ * a slow thief is still reading. This allows non trivially copyable T.
+ */
+template <typename T>
+class WorkStealingQueue
+{
+    static_assert(
+        std::is_move_constructible<T>::value, "Should be of movable type");
+
+public:
+    /**
+     * @brief WorkStealingQueue Constructor.
+     * @param size Power of 2 number - queue length.
+     * @throws std::invalid_argument if size is bad.
+     */
+    explicit WorkStealingQueue(size_t size);
+
+    /**
+     * @brief push Push data to the bottom of the queue. Owner thread only.
+     * @param data Data to be pushed. It is left untouched on failure.
+     * @return true on success, false if the queue is full.
+     */
+    template <typename U>
+    bool push(U&& data);
+
+    /**
+     * @brief pop Pop the most recently pushed data. Owner thread only.
+     * @param data Place to store popped data.
+     * @return true on sucess.
+     */
+    bool pop(T& data);
+
+    /**
+     * @brief steal Pop the least recently pushed data. Any thread.
+     * @param data Place to store stolen data.
+     * @return true on sucess.
+     */
+    bool steal(T& data);
+
+    /**
+     * @brief empty Check if the queue looks empty. The result is a snapshot
+     * only and may be stale by the time it is returned.
+     */
+    bool empty() const;
+
+    /**
+     * @brief size Return the number of queued elements, a snapshot like
+     * empty().
+     */
+    size_t size() const;
+
+private:
+    struct Cell
+    {
+        std::atomic<bool> full;
+        T data;
+
+        Cell() : full(false), data() {}
+    };
+
+    WorkStealingQueue(const WorkStealingQueue&) = delete;
+    WorkStealingQueue& operator=(const WorkStealingQueue&) = delete;
+
+private:
+    typedef char Cacheline[64];
+
+    Cacheline pad0;
+    std::vector<Cell> m_buffer;
+    /* const */ std::ptrdiff_t m_buffer_mask;
+    Cacheline pad1;
+    std::atomic<std::ptrdiff_t> m_top;
+    Cacheline pad2;
+    std::atomic<std::ptrdiff_t> m_bottom;
+    Cacheline pad3;
+};
+
+
+/// Implementation
+
+template <typename T>
+inline WorkStealingQueue<T>::WorkStealingQueue(size_t size)
+    : m_buffer(size), m_buffer_mask(static_cast<std::ptrdiff_t>(size) - 1),
+      m_top(0), m_bottom(0)
+{
+    bool size_is_power_of_2 = (size >= 2) && ((size & (size - 1)) == 0);
+    if(!size_is_power_of_2)
+    {
+        throw std::invalid_argument("buffer size should be a power of 2");
+    }
+}
+
+template <typename T>
+template <typename U>
+inline bool WorkStealingQueue<T>::push(U&& data)
+{
+    std::ptrdiff_t b = m_bottom.load(std::memory_order_relaxed);
+    std::ptrdiff_t t = m_top.load(std::memory_order_acquire);
+    if(b - t > m_buffer_mask)
+    {
+        return false;
+    }
+
+    Cell& cell = m_buffer[b & m_buffer_mask];
+    if(cell.full.load(std::memory_order_acquire))
+    {
+        // A thief claimed this cell one lap ago and is still moving it out.
+        return false;
+    }
+
+    cell.data = std::forward<U>(data);
+    cell.full.store(true, std::memory_order_relaxed);
+
+    m_bottom.store(b + 1, std::memory_order_release);
+
+    return true;
+}
+
+template <typename T>
+inline bool WorkStealingQueue<T>::pop(T& data)
+{
+    std::ptrdiff_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+    m_bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::ptrdiff_t t = m_top.load(std::memory_order_relaxed);
+
+    if(t > b)
+    {
+        m_bottom.store(b + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    if(t == b)
+    {
+        // Single element left, race against thieves for it.
+        bool won = m_top.compare_exchange_strong(
+            t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        m_bottom.store(b + 1, std::memory_order_relaxed);
+        if(!won)
+        {
+            return false;
+        }
+    }
+
+    Cell& cell = m_buffer[b & m_buffer_mask];
+    data = std::move(cell.data);
+    cell.full.store(false, std::memory_order_release);
+
+    return true;
+}
+
+template <typename T>
+inline bool WorkStealingQueue<T>::steal(T& data)
+{
+    std::ptrdiff_t t = m_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::ptrdiff_t b = m_bottom.load(std::memory_order_acquire);
+
+    if(t >= b)
+    {
+        return false;
+    }
+
+    if(!m_top.compare_exchange_strong(
+           t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+        return false;
+    }
+
+    Cell& cell = m_buffer[t & m_buffer_mask];
+    data = std::move(cell.data);
+    cell.full.store(false, std::memory_order_release);
+
+    return true;
+}
+
+template <typename T>
+inline bool WorkStealingQueue<T>::empty() const
+{
+    std::ptrdiff_t t = m_top.load(std::memory_order_relaxed);
+    std::ptrdiff_t b = m_bottom.load(std::memory_order_relaxed);
+    return t >= b;
+}
+
+template <typename T>
+inline size_t WorkStealingQueue<T>::size() const
+{
+    std::ptrdiff_t t = m_top.load(std::memory_order_relaxed);
+    std::ptrdiff_t b = m_bottom.load(std::memory_order_relaxed);
+    return t >= b ? 0 : static_cast<size_t>(b - t);
+}
+
+}
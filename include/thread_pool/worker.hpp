@@ -1,41 +1,128 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
 #include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #if defined(__unix__) || defined(__rtems__)
 #include <pthread.h>
 #endif
 
+#include <thread_pool/cpu_relax.hpp>
+#include <thread_pool/deadline_queue.hpp>
+#include <thread_pool/event_count.hpp>
+#include <thread_pool/mpmc_bounded_queue.hpp>
 #include <thread_pool/thread_params.hpp>
+#include <thread_pool/thread_pool_options.hpp>
+#include <thread_pool/trace.hpp>
 #include <thread_pool/free_workers_map.h>
+#include <thread_pool/histogram.hpp>
+#include <thread_pool/logging.hpp>
 #include <thread_pool/reader_writer_lock.h>
+#include <thread_pool/stats.hpp>
+#include <thread_pool/work_stealing_queue.hpp>
 
-#include <spdlog/spdlog.h>
 
 namespace tp
 {
+namespace detail
+{
+/**
+ * @brief The WorkerState enum tracks the thread of an elastic worker.
+ */
+enum class WorkerState
+{
+    /// Started, taking tasks.
+    Running,
+    /// Retiring on its own, shortly Running or Retired again.
+    Retiring,
+    /// Asked by the pool to retire after its current task.
+    RetireRequested,
+    /// Thread ended, or never started.
+    Retired
+};
+
+/**
+ * @brief The ElasticState struct holds the worker accounting of an elastic
+ * pool, shared by the pool and its workers.
+ */
+struct ElasticState
+{
+    ElasticState(size_t running_count, size_t floor_count, std::chrono::steady_clock::duration timeout)
+        : running(running_count), busy(0), floor(floor_count), idle_timeout(timeout)
+    {}
+
+    /// Workers started and not retiring.
+    std::atomic<size_t> running;
+    /// Workers executing a task.
+    std::atomic<size_t> busy;
+    /// Idle workers retire only while more than floor are running.
+    std::atomic<size_t> floor;
+    /// Idle time after which a worker retires.
+    const std::chrono::steady_clock::duration idle_timeout;
+};
+}
+
 /**
  * @brief The Worker class owns task queue and executing thread.
- * In thread it tries to pop task from queue. If queue is empty then it tries
- * to steal task from the sibling worker. If steal was unsuccessful then spins
- * with one millisecond delay.
+ * In thread it tries to pop task from its local work-stealing deque, then
+ * from the task queue. If both are empty then it tries to steal task from
+ * the deque of a randomly chosen sibling worker. If nothing was found it
+ * idles according to ThreadPoolOptions::idlePolicy.
+ * With several priority levels there is one task queue per level, picked
+ * according to ThreadPoolOptions::priorityScheduling, and they are polled
+ * before the local deque.
+ * With deadline scheduling all workers share one earliest-deadline-first
+ * queue and count the tasks that met or missed their deadline.
+ * Tasks placed on this very worker wait in its inbox, polled before
+ * everything else.
+ * On NUMA aware pools the worker is pinned to a CPU of its node. It tries
+ * its own node's queues and siblings first, and only then the queues and
+ * siblings of the other nodes.
+ * Workers of elastic pools retire, ending their thread, when idle for too
+ * long or when the pool asks them to, and may be started again later.
+ * The worker thread keeps statistics in counters only it writes, so they
+ * cost no read-modify-write and any thread may read them. Optional latency
+ * histograms and trace events are kept the same way.
  */
 template <typename Task, template<typename> class Queue>
 class Worker
 {
 public:
     /**
-     * @brief Worker Constructor.
-     * @param queue_size Length of undelaying task queue.
+     * @brief Worker Constructor for critical pools. The worker owns its
+     * queues and marks itself free in freeWorkers after each task.
+     * @param queue_size Length of undelaying task queue of each level.
+     * @param options Idle policy and priority options.
      */
-    explicit Worker(size_t queue_size, FreeWorkersMap & freeWorkers);
+    explicit Worker(size_t queue_size, FreeWorkersMap & freeWorkers,
+                    const ThreadPoolOptions& options = ThreadPoolOptions());
 
     /**
      * @brief Worker Constructor.
-     * @param queue shared pointer to the queue.
+     * @param queues shared pointers to the queues, one per priority level.
+     * @param idle_event Event notified when tasks are posted to the queues.
+     * @param options Idle policy, priority and work stealing options.
+     */
+    explicit Worker(std::vector<std::shared_ptr<Queue<std::pair<Task, ThreadParams>>>> queues,
+                    std::shared_ptr<EventCount> idle_event, FreeWorkersMap & freeWorkers,
+                    const ThreadPoolOptions& options = ThreadPoolOptions());
+
+    /**
+     * @brief Worker Constructor for deadline scheduling.
+     * @param deadline_queue Earliest-deadline-first queue shared by workers.
+     * @param idle_event Event notified when tasks are posted to the queue.
+     * @param options Idle policy options.
      */
-    explicit Worker(std::shared_ptr<Queue<std::pair<Task, ThreadParams>> > queue, FreeWorkersMap & freeWorkers);
+    explicit Worker(std::shared_ptr<DeadlineQueue<std::pair<Task, ThreadParams>>> deadline_queue,
+                    std::shared_ptr<EventCount> idle_event, FreeWorkersMap & freeWorkers,
+                    const ThreadPoolOptions& options = ThreadPoolOptions());
 
     /**
      * @brief Move ctor implementation.
@@ -50,8 +137,64 @@ public:
     /**
      * @brief start Create the executing thread and start tasks execution.
      * @param id Worker ID.
+     * @param owner Opaque pointer identifying the owning thread pool.
+     * @param siblings Workers of the same pool to steal from.
+     * @param cpu CPU to pin the executing thread to, or -1.
+     * @param node NUMA node index of the worker.
+     */
+    void start(size_t id, const void* owner = nullptr,
+               const std::vector<std::unique_ptr<Worker>>* siblings = nullptr,
+               int cpu = -1, size_t node = 0);
+
+    /**
+     * @brief setRemoteQueues Set the task queues of the other NUMA nodes,
+     * polled when the worker's own queues and node are out of tasks.
+     * Must be called before start().
+     * @param queues Queues of each other node, one per priority level.
+     */
+    void setRemoteQueues(std::vector<std::vector<std::shared_ptr<Queue<std::pair<Task, ThreadParams>>>>> queues);
+
+    /**
+     * @brief node Return the NUMA node index passed to start().
+     */
+    size_t node() const;
+
+    /**
+     * @brief setElastic Let the worker retire once idle for the idle timeout
+     * of elastic, as long as more than its floor of workers are running.
+     * Must be called before start().
+     * @param elastic Accounting shared by the workers of the pool.
      */
-    void start(size_t id);
+    void setElastic(std::shared_ptr<detail::ElasticState> elastic);
+
+    /**
+     * @brief requestRetire Make a running elastic worker retire after its
+     * current task, leaving its queued tasks to the caller. The caller
+     * accounts for it in ElasticState::running.
+     * @return false if the worker is not running.
+     */
+    bool requestRetire();
+
+    /**
+     * @brief state Return the state of the worker's thread. A Retired
+     * worker may be started again after join().
+     */
+    detail::WorkerState state() const;
+
+    /**
+     * @brief join Wait for the thread of a retired worker to end.
+     */
+    void join();
+
+    /**
+     * @brief drain Pop a task left to a retired worker: from its inbox, its
+     * local deque and, in critical pools, its task queues.
+     * Must not be called while the worker runs.
+     * @param handlerPair Place to store the task.
+     * @param level Place to store the priority level the task was queued at.
+     * @return true on success.
+     */
+    bool drain(std::pair<Task, ThreadParams>& handlerPair, size_t& level);
 
     /**
      * @brief stop Stop all worker's thread and stealing activity.
@@ -59,13 +202,108 @@ public:
      */
     void stop();
 
+    /**
+     * @brief requestStop Make the executing thread finish its current task,
+     * run the tasks it still finds until deadline, and end. A parked thread
+     * wakes at once. Returns without waiting, see join().
+     * @param deadline Time to stop taking tasks at. time_point::min() to
+     * take none, time_point::max() to take all.
+     */
+    void requestStop(std::chrono::steady_clock::time_point deadline);
+
+    /**
+     * @brief drained Return the number of tasks run after requestStop.
+     * Only valid once the thread ended.
+     */
+    size_t drained() const;
+
+    /**
+     * @brief stats Return a snapshot of the worker's counters.
+     */
+    WorkerStats stats() const;
+
+    /**
+     * @brief mergeQueueWait Add the worker's histogram of the time from post
+     * to pop, if enabled by ThreadPoolOptions::setLatencyHistograms.
+     */
+    void mergeQueueWait(LatencyHistogram& queue_wait) const;
+
+    /**
+     * @brief mergeRunTime Add the worker's histogram of the time handlers
+     * ran, if enabled by ThreadPoolOptions::setLatencyHistograms.
+     */
+    void mergeRunTime(LatencyHistogram& run_time) const;
+
+    /**
+     * @brief trace Return the worker's trace buffer, or nullptr if tracing
+     * is disabled by ThreadPoolOptions::setTraceBufferSize.
+     */
+    detail::TraceBuffer* trace();
+
     /**
      * @brief post Post task to queue.
      * @param handler Handler to be executed in executing thread.
+     * @param priority Priority level, clamped to the least urgent one.
      * @return true on success.
      */
     template <typename Handler>
-    bool post(Handler&& handler, ThreadParams&& params);
+    bool post(Handler&& handler, ThreadParams&& params, size_t priority = 0);
+
+    /**
+     * @brief postQueued Push task to the queue of a priority level.
+     * @param handlerPair Task to be pushed. It is left untouched on failure.
+     * @param priority Priority level, clamped to the least urgent one.
+     * @return true on success.
+     */
+    bool postQueued(std::pair<Task, ThreadParams>&& handlerPair, size_t priority);
+
+    /**
+     * @brief postLocal Push task to the local work-stealing deque.
+     * Must be called from this worker's executing thread only.
+     * @param handlerPair Task to be pushed. It is left untouched on failure.
+     * @return true on success, false if work stealing is disabled or the
+     * deque is full.
+     */
+    bool postLocal(std::pair<Task, ThreadParams>&& handlerPair);
+
+    /**
+     * @brief postInbox Push task to this worker's inbox.
+     * @param handlerPair Task to be pushed. It is left untouched on failure.
+     * @return true on success, false if the inbox is disabled or full.
+     */
+    bool postInbox(std::pair<Task, ThreadParams>&& handlerPair);
+
+    /**
+     * @brief popInbox Pop a task from this worker's inbox.
+     * Must be called from this worker's executing thread only.
+     * @param handlerPair Place to store popped task.
+     * @return true on success.
+     */
+    bool popInbox(std::pair<Task, ThreadParams>& handlerPair);
+
+    /**
+     * @brief popLocal Pop the newest task from the local deque.
+     * Must be called from this worker's executing thread only.
+     * @param handlerPair Place to store popped task.
+     * @return true on success.
+     */
+    bool popLocal(std::pair<Task, ThreadParams>& handlerPair);
+
+    /**
+     * @brief popQueued Pop a task from the task queues without blocking,
+     * choosing the level by the priority scheduling.
+     * Must be called from this worker's executing thread only.
+     * @param handlerPair Place to store popped task.
+     * @return true on success.
+     */
+    bool popQueued(std::pair<Task, ThreadParams>& handlerPair);
+
+    /**
+     * @brief steal Steal the oldest task from the local deque.
+     * @param handlerPair Place to store stolen task.
+     * @return true on success.
+     */
+    bool steal(std::pair<Task, ThreadParams>& handlerPair);
 
     /**
      * @brief getWorkerIdForCurrentThread Return worker ID associated with
@@ -74,15 +312,117 @@ public:
      */
     static size_t getWorkerIdForCurrentThread();
 
+    /**
+     * @brief getOwnerForCurrentThread Return the owner pointer passed to
+     * start() by the pool running the current thread.
+     * @return Owner pointer or nullptr if not called from a worker.
+     */
+    static const void* getOwnerForCurrentThread();
+
 private:
     /**
      * @brief threadFunc Executing thread function.
      * @param id Worker ID to be associated with this thread.
      */
-    void threadFunc(size_t id);
+    void threadFunc(size_t id, const void* owner);
+
+    /**
+     * @brief popTask Pop task from inbox, local deque, then queue, then
+     * siblings.
+     * @param handlerPair Place to store the task.
+     * @param wait Allow a blocking queue to park until a task is pushed.
+     * Only used when the queue is the worker's single task source, without
+     * inbox.
+     * @return true if a task was found.
+     */
+    bool popTask(std::pair<Task, ThreadParams>& handlerPair, bool wait);
+
+    /**
+     * @brief popElsewhere Take a task from the worker's siblings on the same
+     * node, then from the queues and siblings of the other nodes.
+     * @param handlerPair Place to store the task.
+     * @return true on success.
+     */
+    bool popElsewhere(std::pair<Task, ThreadParams>& handlerPair);
 
-    std::shared_ptr<Queue<std::pair<Task, ThreadParams>> > m_queue;
+    /**
+     * @brief stealTask Try to steal a task from a random sibling.
+     * @param handlerPair Place to store stolen task.
+     * @param same_node Steal from siblings on this worker's node if true,
+     * from the others otherwise.
+     * @return true on success.
+     */
+    bool stealTask(std::pair<Task, ThreadParams>& handlerPair, bool same_node);
+
+    /**
+     * @brief waitForTask Apply the idle policy after an empty poll.
+     * @param handlerPair Place to store a task found while parking.
+     * @return true if a task was stored to handlerPair.
+     */
+    bool waitForTask(std::pair<Task, ThreadParams>& handlerPair);
+
+    /**
+     * @brief retireIfIdle Retire the worker of an elastic pool once idle
+     * for the idle timeout.
+     * @param handlerPair Place to store a task posted while retiring.
+     * @param found Set to true if a task was stored to handlerPair.
+     * @return true if the worker retired and its thread must end.
+     */
+    bool retireIfIdle(size_t id, std::pair<Task, ThreadParams>& handlerPair, bool& found);
+
+    /**
+     * @brief execute Run a popped task with its thread parameters applied,
+     * suppressing its exceptions, and account for it.
+     */
+    void execute(size_t id, std::pair<Task, ThreadParams>& handlerPair);
+
+    /**
+     * @brief idlePolicyFor Idle policy to apply. Workers of blocking queues
+     * never busy spin, so plain Spin is turned into SpinPark for them.
+     */
+    static IdlePolicy idlePolicyFor(const ThreadPoolOptions& options);
+
+    /**
+     * @brief applyParams Apply task thread name and CPU affinity to the
+     * executing thread. Syscalls are skipped if already applied.
+     */
+    void applyParams(const ThreadParams& params);
+
+    std::vector<std::shared_ptr<Queue<std::pair<Task, ThreadParams>>>> m_queues;
+    std::vector<std::vector<std::shared_ptr<Queue<std::pair<Task, ThreadParams>>>>> m_remote_queues;
+    std::shared_ptr<DeadlineQueue<std::pair<Task, ThreadParams>>> m_deadline_queue;
+    std::chrono::steady_clock::time_point m_deadline;
+    std::shared_ptr<EventCount> m_idle_event;
+    const PriorityScheduling m_scheduling;
+    std::vector<size_t> m_weights;
+    size_t m_weighted_level;
+    size_t m_weighted_served;
+    const IdlePolicy m_idle_policy;
+    const size_t m_spin_count;
+    size_t m_idle_spins;
+    std::unique_ptr<WorkStealingQueue<std::pair<Task, ThreadParams>>> m_local_queue;
+    std::unique_ptr<MPMCBoundedQueue<std::pair<Task, ThreadParams>>> m_inbox;
+    const std::vector<std::unique_ptr<Worker>>* m_siblings;
+    std::uint32_t m_steal_seed;
+    int m_cpu;
+    size_t m_node;
+    std::shared_ptr<detail::ElasticState> m_elastic;
+    std::atomic<detail::WorkerState> m_state;
+    std::chrono::steady_clock::time_point m_idle_start;
+#if defined(__unix__) || defined(__rtems__)
+    const std::string* m_applied_name;
+    const cpu_set_t* m_applied_cpuset;
+#endif
     std::atomic<bool> m_running_flag;
+    std::chrono::steady_clock::time_point m_stop_deadline;
+    size_t m_drained;
+    detail::WorkerCounters m_counters;
+    std::unique_ptr<detail::AtomicHistogram> m_queue_wait;
+    std::unique_ptr<detail::AtomicHistogram> m_run_time;
+    std::unique_ptr<detail::TraceBuffer> m_trace;
+    std::chrono::steady_clock::time_point m_task_end;
+    const bool m_timed;
+    const bool m_track_free;
     FreeWorkersMap & m_freeWorkers;
     std::thread m_thread;
 };
@@ -98,6 +438,12 @@ namespace detail
         static thread_local size_t tss_id = -1u;
         return &tss_id;
     }
+
+    inline const void** thread_owner()
+    {
+        static thread_local const void* tss_owner = nullptr;
+        return &tss_owner;
+    }
 #else
     enum
     {
@@ -143,23 +489,240 @@ namespace detail
     {
         thread_id_op(&id, thread_id_WR);
     }
+
+    inline void thread_owner_op(const void **owner, int op)
+    {
+        static std::map<std::thread::id, const void*> thread_owner_map;
+        static ReaderWriterLock l;
+
+        if (op == thread_id_RD)
+        {
+            l.lock_shared();
+            auto it = thread_owner_map.find(std::this_thread::get_id());
+            *owner = (it != thread_owner_map.end()) ? it->second : nullptr;
+            l.unlock_shared();
+        }
+        else if (op == thread_id_WR)
+        {
+            l.lock();
+            thread_owner_map[std::this_thread::get_id()] = *owner;
+            l.unlock();
+        }
+    }
+
+    inline const void* thread_owner_get()
+    {
+        const void* owner;
+        thread_owner_op(&owner, thread_id_RD);
+        return owner;
+    }
+
+    inline void thread_owner_set(const void* owner)
+    {
+        thread_owner_op(&owner, thread_id_WR);
+    }
+#endif
+
+    /**
+     * @brief is_blocking_queue Detects queues whose pop may block. Such
+     * queues provide a non blocking tryPop.
+     */
+    template <typename Q, typename T>
+    class is_blocking_queue
+    {
+        template <typename U>
+        static auto test(int) -> decltype(std::declval<U&>().tryPop(std::declval<T&>()), std::true_type());
+        template <typename U>
+        static std::false_type test(...);
+
+    public:
+        static const bool value = decltype(test<Q>(0))::value;
+    };
+
+    /**
+     * @brief try_pop Pop without blocking, whatever the queue flavour.
+     */
+    template <typename Q, typename T>
+    inline typename std::enable_if<is_blocking_queue<Q, T>::value, bool>::type
+    try_pop(Q& queue, T& item)
+    {
+        return queue.tryPop(item);
+    }
+
+    template <typename Q, typename T>
+    inline typename std::enable_if<!is_blocking_queue<Q, T>::value, bool>::type
+    try_pop(Q& queue, T& item)
+    {
+        return queue.pop(item);
+    }
+
+    /**
+     * @brief close_queue Release consumers parked in a blocking queue.
+     */
+    template <typename Q>
+    inline auto close_queue(Q& queue, int) -> decltype(queue.close(), void())
+    {
+        queue.close();
+    }
+
+    template <typename Q>
+    inline void close_queue(Q&, long)
+    {
+    }
+
+    /**
+     * @brief queue_size Number of items in a queue that can tell it
+     * without locking, 0 for the others.
+     */
+    template <typename Q>
+    inline auto queue_size(const Q& queue, int) -> decltype(size_t(queue.size()))
+    {
+        return queue.size();
+    }
+
+    template <typename Q>
+    inline size_t queue_size(const Q&, long)
+    {
+        return 0;
+    }
+
+    /**
+     * @brief xorshift32 Cheap per-worker pseudo random generator used to
+     * pick steal victims.
+     */
+    inline std::uint32_t xorshift32(std::uint32_t& state)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+}
+
+template <typename Task, template<typename> class Queue>
+inline Worker<Task, Queue>::Worker(size_t queue_size, FreeWorkersMap & freeWorkers,
+                                   const ThreadPoolOptions& options)
+    : m_idle_event(std::make_shared<EventCount>())
+    , m_scheduling(options.priorityScheduling())
+    , m_weighted_level(0)
+    , m_weighted_served(0)
+    , m_idle_policy(idlePolicyFor(options))
+    , m_spin_count(options.spinCount())
+    , m_idle_spins(0)
+    , m_siblings(nullptr)
+    , m_steal_seed(1)
+    , m_cpu(-1)
+    , m_node(0)
+    , m_state(detail::WorkerState::Retired)
+#if defined(__unix__) || defined(__rtems__)
+    , m_applied_name(nullptr)
+    , m_applied_cpuset(nullptr)
 #endif
+    , m_running_flag(true)
+    , m_drained(0)
+    , m_timed(options.timedStats() || options.latencyHistograms() || options.traceBufferSize())
+    , m_track_free(true)
+    , m_freeWorkers(freeWorkers)
+{
+    for (size_t level = 0; level < options.priorityLevels(); ++level) {
+        m_queues.push_back(std::make_shared<Queue<std::pair<Task, ThreadParams>>>(queue_size));
+        m_weights.push_back(options.priorityWeight(level));
+    }
+    if (options.affinityQueueSize()) {
+        m_inbox.reset(new MPMCBoundedQueue<std::pair<Task, ThreadParams>>(options.affinityQueueSize()));
+    }
+    if (options.latencyHistograms()) {
+        m_queue_wait.reset(new detail::AtomicHistogram());
+        m_run_time.reset(new detail::AtomicHistogram());
+    }
+    if (options.traceBufferSize()) {
+        m_trace.reset(new detail::TraceBuffer(options.traceBufferSize()));
+    }
 }
 
 template <typename Task, template<typename> class Queue>
-inline Worker<Task, Queue>::Worker(size_t queue_size, FreeWorkersMap & freeWorkers)
-    : m_queue(std::make_shared<Queue<std::pair<Task, ThreadParams>>>(queue_size))
+inline Worker<Task, Queue>::Worker(std::vector<std::shared_ptr<Queue<std::pair<Task, ThreadParams>>>> queues,
+                                   std::shared_ptr<EventCount> idle_event, FreeWorkersMap & freeWorkers,
+                                   const ThreadPoolOptions& options)
+    : m_queues(std::move(queues))
+    , m_idle_event(idle_event)
+    , m_scheduling(options.priorityScheduling())
+    , m_weighted_level(0)
+    , m_weighted_served(0)
+    , m_idle_policy(idlePolicyFor(options))
+    , m_spin_count(options.spinCount())
+    , m_idle_spins(0)
+    , m_siblings(nullptr)
+    , m_steal_seed(1)
+    , m_cpu(-1)
+    , m_node(0)
+    , m_state(detail::WorkerState::Retired)
+#if defined(__unix__) || defined(__rtems__)
+    , m_applied_name(nullptr)
+    , m_applied_cpuset(nullptr)
+#endif
     , m_running_flag(true)
+    , m_drained(0)
+    , m_timed(options.timedStats() || options.latencyHistograms() || options.traceBufferSize())
+    , m_track_free(false)
     , m_freeWorkers(freeWorkers)
 {
+    for (size_t level = 0; level < m_queues.size(); ++level) {
+        m_weights.push_back(options.priorityWeight(level));
+    }
+    if (options.workStealing()) {
+        m_local_queue.reset(new WorkStealingQueue<std::pair<Task, ThreadParams>>(options.queueSize()));
+    }
+    if (options.affinityQueueSize()) {
+        m_inbox.reset(new MPMCBoundedQueue<std::pair<Task, ThreadParams>>(options.affinityQueueSize()));
+    }
+    if (options.latencyHistograms()) {
+        m_queue_wait.reset(new detail::AtomicHistogram());
+        m_run_time.reset(new detail::AtomicHistogram());
+    }
+    if (options.traceBufferSize()) {
+        m_trace.reset(new detail::TraceBuffer(options.traceBufferSize()));
+    }
 }
 
 template <typename Task, template<typename> class Queue>
-inline Worker<Task, Queue>::Worker(std::shared_ptr<Queue<std::pair<Task, ThreadParams>> > queue, FreeWorkersMap & freeWorkers)
-    : m_queue(queue)
+inline Worker<Task, Queue>::Worker(std::shared_ptr<DeadlineQueue<std::pair<Task, ThreadParams>>> deadline_queue,
+                                   std::shared_ptr<EventCount> idle_event, FreeWorkersMap & freeWorkers,
+                                   const ThreadPoolOptions& options)
+    : m_deadline_queue(std::move(deadline_queue))
+    , m_deadline(std::chrono::steady_clock::time_point::max())
+    , m_idle_event(idle_event)
+    , m_scheduling(options.priorityScheduling())
+    , m_weighted_level(0)
+    , m_weighted_served(0)
+    , m_idle_policy(idlePolicyFor(options))
+    , m_spin_count(options.spinCount())
+    , m_idle_spins(0)
+    , m_siblings(nullptr)
+    , m_steal_seed(1)
+    , m_cpu(-1)
+    , m_node(0)
+    , m_state(detail::WorkerState::Retired)
+#if defined(__unix__) || defined(__rtems__)
+    , m_applied_name(nullptr)
+    , m_applied_cpuset(nullptr)
+#endif
     , m_running_flag(true)
+    , m_drained(0)
+    , m_timed(options.timedStats() || options.latencyHistograms() || options.traceBufferSize())
+    , m_track_free(false)
     , m_freeWorkers(freeWorkers)
 {
+    if (options.affinityQueueSize()) {
+        m_inbox.reset(new MPMCBoundedQueue<std::pair<Task, ThreadParams>>(options.affinityQueueSize()));
+    }
+    if (options.latencyHistograms()) {
+        m_queue_wait.reset(new detail::AtomicHistogram());
+        m_run_time.reset(new detail::AtomicHistogram());
+    }
+    if (options.traceBufferSize()) {
+        m_trace.reset(new detail::TraceBuffer(options.traceBufferSize()));
+    }
 }
 
 template <typename Task, template<typename> class Queue>
@@ -173,7 +736,7 @@ inline Worker<Task, Queue>& Worker<Task, Queue>::operator=(Worker&& rhs) noexcep
 {
     if (this != &rhs)
     {
-        m_queue = rhs.m_queue;
+        m_queues = rhs.m_queues;
         m_running_flag = rhs.m_running_flag.load();
         m_thread = std::move(rhs.m_thread);
     }
@@ -183,14 +746,134 @@ inline Worker<Task, Queue>& Worker<Task, Queue>::operator=(Worker&& rhs) noexcep
 template <typename Task, template<typename> class Queue>
 inline void Worker<Task, Queue>::stop()
 {
-    m_running_flag.store(false, std::memory_order_relaxed);
-    m_thread.join();
+    requestStop(std::chrono::steady_clock::time_point::min());
+    join();
+}
+
+template <typename Task, template<typename> class Queue>
+inline void Worker<Task, Queue>::requestStop(std::chrono::steady_clock::time_point deadline)
+{
+    m_stop_deadline = deadline;
+    m_running_flag.store(false, std::memory_order_release);
+    for (auto& queue : m_queues) {
+        detail::close_queue(*queue, 0);
+    }
+    m_idle_event->notifyAll();
 }
 
 template <typename Task, template<typename> class Queue>
-inline void Worker<Task, Queue>::start(size_t id)
+inline size_t Worker<Task, Queue>::drained() const
 {
-    m_thread = std::thread(&Worker<Task, Queue>::threadFunc, this, id);
+    return m_drained;
+}
+
+template <typename Task, template<typename> class Queue>
+inline WorkerStats Worker<Task, Queue>::stats() const
+{
+    WorkerStats stats = m_counters.snapshot();
+    stats.timed = m_timed;
+    return stats;
+}
+
+template <typename Task, template<typename> class Queue>
+inline detail::TraceBuffer* Worker<Task, Queue>::trace()
+{
+    return m_trace.get();
+}
+
+template <typename Task, template<typename> class Queue>
+inline void Worker<Task, Queue>::mergeQueueWait(LatencyHistogram& queue_wait) const
+{
+    if (m_queue_wait) {
+        m_queue_wait->mergeInto(queue_wait);
+    }
+}
+
+template <typename Task, template<typename> class Queue>
+inline void Worker<Task, Queue>::mergeRunTime(LatencyHistogram& run_time) const
+{
+    if (m_run_time) {
+        m_run_time->mergeInto(run_time);
+    }
+}
+
+template <typename Task, template<typename> class Queue>
+inline void Worker<Task, Queue>::start(size_t id, const void* owner,
+                                       const std::vector<std::unique_ptr<Worker>>* siblings,
+                                       int cpu, size_t node)
+{
+    m_siblings = siblings;
+    m_cpu = cpu;
+    m_node = node;
+    m_steal_seed = static_cast<std::uint32_t>(id) * 2654435761u + 1u;
+    m_idle_start = std::chrono::steady_clock::time_point();
+#if defined(__unix__) || defined(__rtems__)
+    // A restarted worker runs on a new thread with default attributes.
+    m_applied_name = nullptr;
+    m_applied_cpuset = nullptr;
+#endif
+    m_state.store(detail::WorkerState::Running, std::memory_order_seq_cst);
+    m_thread = std::thread(&Worker<Task, Queue>::threadFunc, this, id, owner);
+}
+
+template <typename Task, template<typename> class Queue>
+inline void Worker<Task, Queue>::setRemoteQueues(
+    std::vector<std::vector<std::shared_ptr<Queue<std::pair<Task, ThreadParams>>>>> queues)
+{
+    m_remote_queues = std::move(queues);
+}
+
+template <typename Task, template<typename> class Queue>
+inline size_t Worker<Task, Queue>::node() const
+{
+    return m_node;
+}
+
+template <typename Task, template<typename> class Queue>
+inline void Worker<Task, Queue>::setElastic(std::shared_ptr<detail::ElasticState> elastic)
+{
+    m_elastic = std::move(elastic);
+}
+
+template <typename Task, template<typename> class Queue>
+inline bool Worker<Task, Queue>::requestRetire()
+{
+    detail::WorkerState state = detail::WorkerState::Running;
+    if (!m_state.compare_exchange_strong(state, detail::WorkerState::RetireRequested)) {
+        return false;
+    }
+    m_idle_event->notifyAll();
+    return true;
+}
+
+template <typename Task, template<typename> class Queue>
+inline detail::WorkerState Worker<Task, Queue>::state() const
+{
+    return m_state.load(std::memory_order_seq_cst);
+}
+
+template <typename Task, template<typename> class Queue>
+inline void Worker<Task, Queue>::join()
+{
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+template <typename Task, template<typename> class Queue>
+inline bool Worker<Task, Queue>::drain(std::pair<Task, ThreadParams>& handlerPair, size_t& level)
+{
+    level = m_queues.empty() ? 0 : m_queues.size() - 1;
+    if (popInbox(handlerPair) || popLocal(handlerPair)) {
+        return true;
+    }
+    // The other queues are shared with the rest of the pool.
+    for (level = 0; m_track_free && level < m_queues.size(); ++level) {
+        if (detail::try_pop(*m_queues[level], handlerPair)) {
+            return true;
+        }
+    }
+    return false;
 }
 
 template <typename Task, template<typename> class Queue>
@@ -203,63 +886,427 @@ inline size_t Worker<Task, Queue>::getWorkerIdForCurrentThread()
 #endif
 }
 
+template <typename Task, template<typename> class Queue>
+inline const void* Worker<Task, Queue>::getOwnerForCurrentThread()
+{
+#if !(defined(__freertos__) || defined(KPSR_FREERTOS_EMUL))
+    return *detail::thread_owner();
+#else
+    return detail::thread_owner_get();
+#endif
+}
+
 template <typename Task, template<typename> class Queue>
 template <typename Handler>
-inline bool Worker<Task, Queue>::post(Handler&& handler, ThreadParams&& params)
+inline bool Worker<Task, Queue>::post(Handler&& handler, ThreadParams&& params, size_t priority)
+{
+    auto& queue = m_queues[std::min(priority, m_queues.size() - 1)];
+    if (!queue->push(std::make_pair<Task, ThreadParams>(std::forward<Handler>(handler), std::forward<ThreadParams>(params)))) {
+        return false;
+    }
+    m_idle_event->notifyOne();
+    return true;
+}
+
+template <typename Task, template<typename> class Queue>
+inline bool Worker<Task, Queue>::postQueued(std::pair<Task, ThreadParams>&& handlerPair, size_t priority)
+{
+    const auto& queue = m_queues[std::min(priority, m_queues.size() - 1)];
+    if (!queue->push(std::move(handlerPair))) {
+        return false;
+    }
+    detail::raise(m_counters.queue_high_water, detail::queue_size(*queue, 0));
+    m_idle_event->notifyOne();
+    return true;
+}
+
+template <typename Task, template<typename> class Queue>
+inline bool Worker<Task, Queue>::postLocal(std::pair<Task, ThreadParams>&& handlerPair)
+{
+    if (!m_local_queue || !m_local_queue->push(std::move(handlerPair))) {
+        return false;
+    }
+    detail::raise(m_counters.queue_high_water, m_local_queue->size());
+    m_idle_event->notifyOne();
+    return true;
+}
+
+template <typename Task, template<typename> class Queue>
+inline bool Worker<Task, Queue>::postInbox(std::pair<Task, ThreadParams>&& handlerPair)
+{
+    if (!m_inbox || !m_inbox->push(std::move(handlerPair))) {
+        return false;
+    }
+    detail::raise(m_counters.queue_high_water, m_inbox->size());
+    // The idle event may be shared: make sure this worker is among the woken.
+    m_idle_event->notifyAll();
+    return true;
+}
+
+template <typename Task, template<typename> class Queue>
+inline bool Worker<Task, Queue>::popInbox(std::pair<Task, ThreadParams>& handlerPair)
+{
+    if (!m_inbox || !m_inbox->pop(handlerPair)) {
+        return false;
+    }
+    // Inbox tasks carry no deadline, unlike the previous task may have.
+    m_deadline = std::chrono::steady_clock::time_point::max();
+    return true;
+}
+
+template <typename Task, template<typename> class Queue>
+inline bool Worker<Task, Queue>::popLocal(std::pair<Task, ThreadParams>& handlerPair)
+{
+    return m_local_queue && m_local_queue->pop(handlerPair);
+}
+
+template <typename Task, template<typename> class Queue>
+inline bool Worker<Task, Queue>::popQueued(std::pair<Task, ThreadParams>& handlerPair)
+{
+    const size_t levels = m_queues.size();
+    if (levels == 1 || m_scheduling == PriorityScheduling::Strict) {
+        for (auto& queue : m_queues) {
+            if (detail::try_pop(*queue, handlerPair)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Weighted round robin: serve the current level until its share is
+    // used up or it runs empty, then move on. One extra step revisits the
+    // starting level with a fresh share when all others are empty.
+    for (size_t i = 0; i <= levels; ++i) {
+        if (m_weighted_served < m_weights[m_weighted_level] &&
+            detail::try_pop(*m_queues[m_weighted_level], handlerPair)) {
+            ++m_weighted_served;
+            return true;
+        }
+        m_weighted_level = (m_weighted_level + 1) % levels;
+        m_weighted_served = 0;
+    }
+    return false;
+}
+
+template <typename Task, template<typename> class Queue>
+inline bool Worker<Task, Queue>::steal(std::pair<Task, ThreadParams>& handlerPair)
+{
+    return m_local_queue && m_local_queue->steal(handlerPair);
+}
+
+template <typename Task, template<typename> class Queue>
+inline bool Worker<Task, Queue>::popTask(std::pair<Task, ThreadParams>& handlerPair, bool wait)
+{
+    if (popInbox(handlerPair)) {
+        return true;
+    }
+
+    if (m_deadline_queue) {
+        return m_deadline_queue->tryPop(handlerPair, m_deadline);
+    }
+
+    if (m_queues.size() > 1) {
+        // Prioritized queues go first so urgent tasks never wait behind
+        // the local deque.
+        if (popQueued(handlerPair) || (m_local_queue && m_local_queue->pop(handlerPair))) {
+            return true;
+        }
+        return popElsewhere(handlerPair);
+    }
+
+    if (m_local_queue && m_local_queue->pop(handlerPair)) {
+        return true;
+    }
+    // A worker blocked in its queue would not see other sources.
+    if (wait && !m_local_queue && !m_inbox && m_remote_queues.empty() && !m_elastic) {
+        if (m_queues[0]->pop(handlerPair)) {
+            return true;
+        }
+    } else if (detail::try_pop(*m_queues[0], handlerPair)) {
+        return true;
+    }
+    return popElsewhere(handlerPair);
+}
+
+template <typename Task, template<typename> class Queue>
+inline bool Worker<Task, Queue>::popElsewhere(std::pair<Task, ThreadParams>& handlerPair)
+{
+    if (m_local_queue && stealTask(handlerPair, true)) {
+        return true;
+    }
+    if (m_remote_queues.empty()) {
+        return false;
+    }
+    for (auto& queues : m_remote_queues) {
+        for (auto& queue : queues) {
+            if (detail::try_pop(*queue, handlerPair)) {
+                return true;
+            }
+        }
+    }
+    return m_local_queue && stealTask(handlerPair, false);
+}
+
+template <typename Task, template<typename> class Queue>
+inline bool Worker<Task, Queue>::stealTask(std::pair<Task, ThreadParams>& handlerPair, bool same_node)
+{
+    if (!m_siblings || m_siblings->size() < 2) {
+        return false;
+    }
+
+    detail::bump(m_counters.steal_attempts);
+    const size_t count = m_siblings->size();
+    const size_t start = detail::xorshift32(m_steal_seed) % count;
+    for (size_t i = 0; i < count; ++i) {
+        const auto& victim = (*m_siblings)[(start + i) % count];
+        if (victim.get() != this && (victim->node() == m_node) == same_node && victim->steal(handlerPair)) {
+            detail::bump(m_counters.steals);
+            if (m_trace) {
+                m_trace->record(TraceEventType::Steal, std::chrono::steady_clock::now());
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename Task, template<typename> class Queue>
+inline IdlePolicy Worker<Task, Queue>::idlePolicyFor(const ThreadPoolOptions& options)
+{
+    if (detail::is_blocking_queue<Queue<std::pair<Task, ThreadParams>>, std::pair<Task, ThreadParams>>::value &&
+        options.idlePolicy() == IdlePolicy::Spin) {
+        return IdlePolicy::SpinPark;
+    }
+    return options.idlePolicy();
+}
+
+template <typename Task, template<typename> class Queue>
+inline void Worker<Task, Queue>::applyParams(const ThreadParams& params)
+{
+#if defined(__unix__) || defined(__rtems__)
+    // Interned parameters: same pointer means already applied.
+    const std::string& name = params.getThreadName();
+    if (!name.empty() && &name != m_applied_name) {
+        if (!m_applied_name || *m_applied_name != name) {
+            pthread_setname_np(pthread_self(), name.c_str());
+        }
+        m_applied_name = &name;
+    }
+
+    const cpu_set_t* cpuset = params.getNativeCpuSet();
+    if (cpuset && cpuset != m_applied_cpuset) {
+        if (!m_applied_cpuset || !CPU_EQUAL(cpuset, m_applied_cpuset)) {
+            pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), cpuset);
+        }
+        m_applied_cpuset = cpuset;
+    }
+#else
+    (void)params;
+#endif
+}
+
+template <typename Task, template<typename> class Queue>
+inline bool Worker<Task, Queue>::waitForTask(std::pair<Task, ThreadParams>& handlerPair)
+{
+    if (m_idle_policy == IdlePolicy::Spin) {
+        return false;
+    }
+
+    if (m_idle_policy == IdlePolicy::SpinPause || m_idle_spins < m_spin_count) {
+        ++m_idle_spins;
+        detail::cpu_relax();
+        return false;
+    }
+
+    if (m_idle_policy == IdlePolicy::SpinYield) {
+        std::this_thread::yield();
+        return false;
+    }
+
+    // Re-poll after registering as waiter so that no post is missed.
+    auto key = m_idle_event->prepareWait();
+    if (popTask(handlerPair, false)) {
+        m_idle_event->cancelWait();
+        return true;
+    }
+    if (!m_running_flag.load(std::memory_order_relaxed) ||
+        (m_elastic && m_state.load(std::memory_order_seq_cst) == detail::WorkerState::RetireRequested)) {
+        m_idle_event->cancelWait();
+        return false;
+    }
+    if (m_trace) {
+        m_trace->record(TraceEventType::Park, std::chrono::steady_clock::now());
+    }
+    if (m_elastic) {
+        // Wake up in time to retire.
+        if (m_idle_start == std::chrono::steady_clock::time_point()) {
+            m_idle_start = std::chrono::steady_clock::now();
+        }
+        m_idle_event->commitWaitUntil(key, m_idle_start + m_elastic->idle_timeout);
+    } else {
+        m_idle_event->commitWait(key);
+    }
+    if (m_trace) {
+        m_trace->record(TraceEventType::Wake, std::chrono::steady_clock::now());
+    }
+    return false;
+}
+
+template <typename Task, template<typename> class Queue>
+inline bool Worker<Task, Queue>::retireIfIdle(size_t id, std::pair<Task, ThreadParams>& handlerPair, bool& found)
 {
-    return m_queue->push(std::make_pair<Task, ThreadParams>(std::forward<Handler>(handler), std::forward<ThreadParams>(params)));
+    const auto now = std::chrono::steady_clock::now();
+    if (m_idle_start == std::chrono::steady_clock::time_point()) {
+        m_idle_start = now;
+        return false;
+    }
+    if (now - m_idle_start < m_elastic->idle_timeout) {
+        return false;
+    }
+    m_idle_start = now;
+
+    size_t running = m_elastic->running.load(std::memory_order_relaxed);
+    do {
+        if (running <= m_elastic->floor.load(std::memory_order_relaxed)) {
+            return false;
+        }
+    } while (!m_elastic->running.compare_exchange_weak(running, running - 1));
+
+    // Back off if the pool asked to retire, or a poster just claimed us.
+    detail::WorkerState state = detail::WorkerState::Running;
+    if (!m_state.compare_exchange_strong(state, detail::WorkerState::Retiring)) {
+        m_elastic->running.fetch_add(1);
+        return false;
+    }
+    if (m_track_free && !m_freeWorkers.claim(id)) {
+        m_state.store(detail::WorkerState::Running, std::memory_order_seq_cst);
+        m_elastic->running.fetch_add(1);
+        return false;
+    }
+
+    // Posters push, then check the state. Either they see us retiring and
+    // restart us once retired, or we see their task here.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (popInbox(handlerPair) || (m_track_free && popQueued(handlerPair))) {
+        m_elastic->running.fetch_add(1);
+        m_state.store(detail::WorkerState::Running, std::memory_order_seq_cst);
+        found = true;
+        return false;
+    }
+    m_state.store(detail::WorkerState::Retired, std::memory_order_seq_cst);
+    return true;
 }
 
 template <typename Task, template<typename> class Queue>
-inline void Worker<Task, Queue>::threadFunc(size_t id)
+inline void Worker<Task, Queue>::threadFunc(size_t id, const void* owner)
 {
 #if !(defined(__freertos__) || defined(KPSR_FREERTOS_EMUL))
     *detail::thread_id() = id;
+    *detail::thread_owner() = owner;
 #else
     detail::thread_id_set(id);
+    detail::thread_owner_set(owner);
+#endif
+
+#if defined(__unix__) || defined(__rtems__)
+    if (m_cpu >= 0) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(m_cpu, &cpuset);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    }
 #endif
 
     // Task handler & name pair
     std::pair<Task, ThreadParams> handlerPair;
+    m_task_end = std::chrono::steady_clock::now();
 
     while (m_running_flag.load(std::memory_order_relaxed))
     {
-        if (m_queue->pop(handlerPair))
-        {
-            try
-            {
-                spdlog::debug("{}. Executing new job with name {}.", __PRETTY_FUNCTION__, handlerPair.second.getName());
+        if (m_elastic && m_state.load(std::memory_order_relaxed) == detail::WorkerState::RetireRequested) {
+            // Asked to retire: the pool takes over the queued tasks.
+            if (m_track_free) {
                 m_freeWorkers.setFree(id, false);
-#if defined(__unix__) || defined(__rtems__)
-                auto threadName = handlerPair.second.getName();
-                if (!threadName.empty()) {
-                    if (threadName.size() > 15) {
-                        threadName.erase(16, std::string::npos);
-                    }
-                    pthread_setname_np(m_thread.native_handle(), threadName.c_str());
-                }
-                auto cpu_affinity_vector = handlerPair.second.getCpuAffinity();
-                cpu_set_t cpuset;
-                CPU_ZERO(&cpuset);
-                if (!cpu_affinity_vector.empty()) {
-                    for (auto& i: cpu_affinity_vector) {
-                        CPU_SET(i, &cpuset);
-                    }
-                    pthread_setaffinity_np(m_thread.native_handle(),
-                                                    sizeof(cpu_set_t), &cpuset);
-                }
-#endif
-                handlerPair.first();
-                m_freeWorkers.setFree(id, true);
-                spdlog::debug("{}. Finished job with name {}.", __PRETTY_FUNCTION__, handlerPair.second.getName());
-
-            }
-            catch(...)
-            {
-                // suppress all exceptions
-                spdlog::warn("{}. Exception during execution of {}.", __PRETTY_FUNCTION__, handlerPair.second.getName());
             }
+            m_state.store(detail::WorkerState::Retired, std::memory_order_seq_cst);
+            return;
+        }
+
+        bool found = popTask(handlerPair, true) || waitForTask(handlerPair);
+        if (!found && m_elastic && retireIfIdle(id, handlerPair, found)) {
+            return;
+        }
+        if (found)
+        {
+            m_idle_spins = 0;
+            execute(id, handlerPair);
+        }
+    }
+
+    // Stopping: run what is left until the deadline set by requestStop.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const auto deadline = m_stop_deadline;
+    while (deadline != std::chrono::steady_clock::time_point::min() &&
+           (deadline == std::chrono::steady_clock::time_point::max() || std::chrono::steady_clock::now() < deadline) &&
+           popTask(handlerPair, false)) {
+        execute(id, handlerPair);
+        ++m_drained;
+    }
+}
+
+template <typename Task, template<typename> class Queue>
+inline void Worker<Task, Queue>::execute(size_t id, std::pair<Task, ThreadParams>& handlerPair)
+{
+    if (m_elastic) {
+        m_elastic->busy.fetch_add(1, std::memory_order_relaxed);
+    }
+    // Timed stats, histograms and trace share the two clock reads.
+    const bool timed = m_timed;
+    const auto start = timed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+    if (m_trace) {
+        m_trace->record(TraceEventType::TaskBegin, start, &handlerPair.second.getName());
+    }
+    try
+    {
+        TP_LOG_DEBUG("{}. Executing new job with name {}.", __PRETTY_FUNCTION__, handlerPair.second.getName());
+        applyParams(handlerPair.second);
+        handlerPair.first();
+        TP_LOG_DEBUG("{}. Finished job with name {}.", __PRETTY_FUNCTION__, handlerPair.second.getName());
+
+    }
+    catch(...)
+    {
+        // suppress all exceptions
+        TP_LOG_WARN("{}. Exception during execution of {}.", __PRETTY_FUNCTION__, handlerPair.second.getName());
+        detail::bump(m_counters.exceptions);
+    }
+    detail::bump(m_counters.executed);
+    const auto end = timed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+    if (timed) {
+        detail::bump(m_counters.idle_ns, std::chrono::duration_cast<std::chrono::nanoseconds>(start - m_task_end).count());
+        detail::bump(m_counters.busy_ns, std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+        m_task_end = end;
+    }
+    if (m_trace) {
+        m_trace->record(TraceEventType::TaskEnd, end);
+    }
+    if (m_queue_wait) {
+        const auto posted = handlerPair.second.getPostTime();
+        if (posted != std::chrono::steady_clock::time_point()) {
+            m_queue_wait->record(std::chrono::duration_cast<std::chrono::nanoseconds>(start - posted));
         }
+        m_run_time->record(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start));
+    }
+    if (m_deadline_queue) {
+        m_deadline_queue->recordCompletion(m_deadline);
+    }
+    // The poster marked this worker busy when it claimed it.
+    if (m_track_free) {
+        m_freeWorkers.setFree(id, true);
+    }
+    if (m_elastic) {
+        m_elastic->busy.fetch_sub(1, std::memory_order_relaxed);
+        m_idle_start = std::chrono::steady_clock::time_point();
     }
 }
 
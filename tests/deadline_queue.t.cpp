@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+
+#include <thread_pool/deadline_queue.hpp>
+
+#include <chrono>
+#include <memory>
+
+typedef tp::DeadlineQueue<int>::Clock Clock;
+
+TEST(DeadlineQueue, earliestFirst)
+{
+    tp::DeadlineQueue<int> queue(8);
+    const Clock::time_point now = Clock::now();
+
+    ASSERT_TRUE(queue.push(3, now + std::chrono::seconds(3)));
+    ASSERT_TRUE(queue.push(1, now + std::chrono::seconds(1)));
+    ASSERT_TRUE(queue.push(4, Clock::time_point::max()));
+    ASSERT_TRUE(queue.push(2, now + std::chrono::seconds(2)));
+    ASSERT_TRUE(queue.push(5, Clock::time_point::max()));
+
+    int item = 0;
+    Clock::time_point deadline;
+    for (int expected = 1; expected <= 5; ++expected) {
+        ASSERT_TRUE(queue.tryPop(item, deadline));
+        ASSERT_EQ(expected, item);
+    }
+    ASSERT_EQ(Clock::time_point::max(), deadline);
+    ASSERT_FALSE(queue.tryPop(item, deadline));
+}
+
+TEST(DeadlineQueue, bounded)
+{
+    tp::DeadlineQueue<std::unique_ptr<int>> queue(2);
+    const Clock::time_point now = Clock::now();
+
+    ASSERT_TRUE(queue.push(std::unique_ptr<int>(new int(1)), now));
+    ASSERT_TRUE(queue.push(std::unique_ptr<int>(new int(2)), now));
+    ASSERT_FALSE(queue.push(std::unique_ptr<int>(new int(3)), now));
+
+    std::unique_ptr<int> item;
+    Clock::time_point deadline;
+    ASSERT_TRUE(queue.tryPop(item, deadline));
+    ASSERT_EQ(1, *item);
+    ASSERT_EQ(now, deadline);
+}
+
+TEST(DeadlineQueue, completionCounters)
+{
+    tp::DeadlineQueue<int> queue(1);
+    const Clock::time_point now = Clock::now();
+
+    queue.recordCompletion(now + std::chrono::hours(1));
+    queue.recordCompletion(now - std::chrono::hours(1));
+    queue.recordCompletion(now - std::chrono::hours(1));
+    queue.recordCompletion(Clock::time_point::max());
+
+    ASSERT_EQ(1u, queue.met());
+    ASSERT_EQ(2u, queue.missed());
+}
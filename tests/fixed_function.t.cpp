@@ -2,6 +2,7 @@
 
 #include <thread_pool/fixed_function.hpp>
 
+#include <stdexcept>
 #include <string>
 #include <type_traits>
 #include <functional>
@@ -187,6 +188,88 @@ TEST(FixedFunction, lambda)
     ASSERT_EQ(s1, f1());
 }
 
+namespace
+{
+struct Big
+{
+    static size_t alive;
+
+    Big(int v) : value(v) { ++alive; }
+    Big(Big&& o) : value(o.value) { ++alive; }
+    ~Big() { --alive; }
+    int operator()() { return value; }
+
+    int value;
+    char payload[200];
+};
+
+size_t Big::alive = 0;
+}
+
+TEST(FixedFunction, slabFallback)
+{
+    typedef tp::FixedFunction<int(), 32, tp::SlabFallback> func_type;
+    tp::SlabAllocator slab(1, 256);
+
+    {
+        func_type small([]() { return 1; }, &slab);
+        ASSERT_EQ(1, small());
+        // Small objects stay inline and leave the slab alone.
+        void* block = slab.allocate();
+        ASSERT_NE(nullptr, block);
+        slab.deallocate(block);
+
+        func_type in_slab(Big(2), &slab);
+        ASSERT_EQ(nullptr, slab.allocate());
+
+        // The slab is exhausted, the heap takes over.
+        func_type on_heap(Big(3), &slab);
+        func_type no_slab(Big(4));
+        ASSERT_EQ(static_cast<size_t>(3), Big::alive);
+
+        // Moving hands the block over without moving the object.
+        func_type moved(std::move(in_slab));
+        ASSERT_EQ(static_cast<size_t>(3), Big::alive);
+        on_heap = std::move(moved);
+        ASSERT_EQ(static_cast<size_t>(2), Big::alive);
+        ASSERT_EQ(2, on_heap());
+        ASSERT_EQ(4, no_slab());
+    }
+    ASSERT_EQ(static_cast<size_t>(0), Big::alive);
+
+    void* block = slab.allocate();
+    ASSERT_NE(nullptr, block);
+    slab.deallocate(block);
+}
+
+TEST(FixedFunction, sizeTiers)
+{
+    ASSERT_LT(sizeof(tp::FixedFunction<void(), 32, tp::SlabFallback>),
+              sizeof(tp::FixedFunction<void(), 128>));
+    ASSERT_EQ(sizeof(tp::FixedFunction<void(), 128>),
+              sizeof(tp::FixedFunction<void(), 128, tp::SlabFallback>));
+}
+
+TEST(FixedFunction, trivialRelocation)
+{
+    typedef tp::FixedFunction<int(), 64> func_type;
+    // One pointer to the per-type operations besides the storage.
+    ASSERT_EQ(sizeof(std::aligned_storage<64, sizeof(size_t)>::type) + sizeof(void*),
+              sizeof(func_type));
+
+    int a = 1, b = 2;
+    func_type f1([a, b]() { return a + b; });
+    func_type f2(std::move(f1));
+    ASSERT_EQ(3, f2());
+    ASSERT_THROW(f1(), std::runtime_error);
+
+    func_type f3([]() { return 0; });
+    f3 = std::move(f2);
+    ASSERT_EQ(3, f3());
+    f2 = std::move(f3);
+    ASSERT_EQ(3, f2());
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
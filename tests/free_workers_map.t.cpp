@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+
+#include <thread_pool/free_workers_map.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+TEST(FreeWorkersMap, startsBusy)
+{
+    tp::FreeWorkersMap map(3);
+
+    size_t id;
+    ASSERT_FALSE(map.findFreeWorker(id));
+    ASSERT_FALSE(map.claimFreeWorker(id));
+    ASSERT_FALSE(map.isFree(0));
+}
+
+TEST(FreeWorkersMap, setAndClaim)
+{
+    tp::FreeWorkersMap map(3);
+
+    map.setFree(2, true);
+    map.setFree(1, true);
+
+    size_t id = 0;
+    ASSERT_TRUE(map.findFreeWorker(id));
+    ASSERT_EQ(static_cast<size_t>(1), id);
+    ASSERT_TRUE(map.isFree(1));
+
+    ASSERT_TRUE(map.claimFreeWorker(id));
+    ASSERT_EQ(static_cast<size_t>(1), id);
+    ASSERT_FALSE(map.isFree(1));
+
+    ASSERT_FALSE(map.claim(1));
+    ASSERT_TRUE(map.claim(2));
+    ASSERT_FALSE(map.claimFreeWorker(id));
+
+    // Out of range ids are ignored.
+    map.setFree(3, true);
+    ASSERT_FALSE(map.isFree(3));
+    ASSERT_FALSE(map.findFreeWorker(id));
+}
+
+TEST(FreeWorkersMap, multipleWords)
+{
+    tp::FreeWorkersMap map(200);
+
+    map.setFree(130, true);
+    map.setFree(199, true);
+
+    size_t id = 0;
+    ASSERT_TRUE(map.claimFreeWorker(id));
+    ASSERT_EQ(static_cast<size_t>(130), id);
+    ASSERT_TRUE(map.claimFreeWorker(id));
+    ASSERT_EQ(static_cast<size_t>(199), id);
+    ASSERT_FALSE(map.claimFreeWorker(id));
+}
+
+TEST(FreeWorkersMap, claimInRange)
+{
+    tp::FreeWorkersMap map(150);
+    map.setFree(3, true);
+    map.setFree(70, true);
+    map.setFree(140, true);
+
+    size_t id = 0;
+    ASSERT_FALSE(map.claimFreeWorker(id, 4, 70));
+    ASSERT_TRUE(map.claimFreeWorker(id, 4, 71));
+    ASSERT_EQ(static_cast<size_t>(70), id);
+    ASSERT_TRUE(map.claimFreeWorker(id, 64, 200));
+    ASSERT_EQ(static_cast<size_t>(140), id);
+    ASSERT_FALSE(map.claimFreeWorker(id, 3, 3));
+    ASSERT_TRUE(map.claimFreeWorker(id, 0, 4));
+    ASSERT_EQ(static_cast<size_t>(3), id);
+    ASSERT_FALSE(map.claimFreeWorker(id));
+}
+
+TEST(FreeWorkersMap, concurrentClaimIsExclusive)
+{
+    const size_t workers = 128;
+    tp::FreeWorkersMap map(workers);
+    for (size_t i = 0; i < workers; ++i) {
+        map.setFree(i, true);
+    }
+
+    std::vector<std::atomic<int>> claims(workers);
+    for (auto& c : claims) {
+        c = 0;
+    }
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&]() {
+            size_t id;
+            while (map.claimFreeWorker(id)) {
+                claims[id]++;
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    for (auto& c : claims) {
+        ASSERT_EQ(1, c.load());
+    }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
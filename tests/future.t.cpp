@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+
+#include <thread_pool/thread_pool.hpp>
+
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(Future, submitReturnsValue)
+{
+    tp::NonBlockingThreadPool pool;
+
+    auto r = pool.submit([](int a, int b) { return a + b; }, 40, 2);
+
+    ASSERT_TRUE(r.valid());
+    ASSERT_EQ(42, r.get());
+    ASSERT_FALSE(r.valid());
+}
+
+TEST(Future, submitVoid)
+{
+    tp::BlockingThreadPool pool;
+
+    bool called = false;
+    auto r = pool.submit([&called]() { called = true; });
+    r.wait();
+
+    ASSERT_TRUE(r.ready());
+    r.get();
+    ASSERT_TRUE(called);
+}
+
+TEST(Future, submitMoveOnlyResult)
+{
+    tp::NonBlockingThreadPool pool;
+
+    auto r = pool.submit([]() { return std::unique_ptr<std::string>(new std::string("result")); });
+
+    ASSERT_EQ("result", *r.get());
+}
+
+TEST(Future, exceptionPropagated)
+{
+    tp::NonBlockingThreadPool pool;
+
+    auto r = pool.submit([]() -> int { throw std::logic_error("failed"); });
+
+    ASSERT_THROW(r.get(), std::logic_error);
+
+    // The worker survives the exception.
+    ASSERT_EQ(7, pool.submit([]() { return 7; }).get());
+}
+
+TEST(Future, invalidFutureThrows)
+{
+    tp::Future<int> r;
+
+    ASSERT_FALSE(r.valid());
+    ASSERT_THROW(r.get(), std::runtime_error);
+}
+
+TEST(Future, submitThrowsWhenQueueIsFull)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    options.setQueueSize(2);
+    tp::BlockingThreadPool pool(options);
+
+    std::promise<void> unblock;
+    std::shared_future<void> blocker = unblock.get_future().share();
+    std::vector<tp::Future<void>> futures;
+
+    // Occupy the worker and fill the queue, then overflow it.
+    ASSERT_THROW({
+        for (int i = 0; i < 16; ++i) {
+            futures.push_back(pool.submit([blocker]() { blocker.wait(); }));
+        }
+    }, std::runtime_error);
+
+    unblock.set_value();
+    for (auto& r : futures) {
+        r.get();
+    }
+}
+
+TEST(Future, moreTasksThanSlabSlots)
+{
+    tp::ThreadPoolOptions options;
+    options.setQueueSize(4);
+    tp::BlockingThreadPool pool(options);
+
+    // States outlive their tasks here, so the slab runs dry and the heap
+    // takes over.
+    std::vector<tp::Future<int>> futures;
+    for (int i = 0; i < 64; ++i) {
+        for (;;) {
+            try {
+                futures.push_back(pool.submit([i]() { return i; }));
+                break;
+            } catch (const std::runtime_error&) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    for (int i = 0; i < 64; ++i) {
+        ASSERT_EQ(i, futures[i].get());
+    }
+}
+
+TEST(Future, outlivesPool)
+{
+    tp::Future<int> r;
+    {
+        tp::NonBlockingThreadPool pool;
+        r = pool.submit([]() { return 5; });
+        r.wait();
+    }
+    ASSERT_EQ(5, r.get());
+}
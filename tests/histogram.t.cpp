@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+
+#include <thread_pool/histogram.hpp>
+
+#include <chrono>
+#include <cstdint>
+
+TEST(LatencyHistogram, bucketBounds)
+{
+    for (std::uint64_t value = 0; value < 16; ++value) {
+        ASSERT_EQ(value, tp::LatencyHistogram::bucketEnd(tp::LatencyHistogram::bucketOf(value)));
+    }
+    // Buckets are contiguous and within 1/16 of their values.
+    for (size_t bucket = 1; bucket < 400; ++bucket) {
+        const std::uint64_t first = tp::LatencyHistogram::bucketEnd(bucket - 1) + 1;
+        const std::uint64_t last = tp::LatencyHistogram::bucketEnd(bucket);
+        ASSERT_EQ(bucket, tp::LatencyHistogram::bucketOf(first));
+        ASSERT_EQ(bucket, tp::LatencyHistogram::bucketOf(last));
+        ASSERT_LE(last - first, first / 16);
+    }
+    const std::uint64_t highest = ~std::uint64_t(0);
+    ASSERT_EQ(highest, tp::LatencyHistogram::bucketEnd(tp::LatencyHistogram::bucketOf(highest)));
+}
+
+TEST(LatencyHistogram, percentile)
+{
+    tp::LatencyHistogram histogram;
+    ASSERT_EQ(std::chrono::nanoseconds(0), histogram.percentile(50));
+
+    for (int i = 1; i <= 1000; ++i) {
+        histogram.record(std::chrono::microseconds(i));
+    }
+    histogram.record(std::chrono::nanoseconds(-5));
+    ASSERT_EQ(static_cast<std::uint64_t>(1001), histogram.count());
+    ASSERT_EQ(static_cast<std::uint64_t>(1), histogram.bucketCount(0));
+
+    const auto p50 = histogram.percentile(50);
+    ASSERT_GE(p50, std::chrono::microseconds(500));
+    ASSERT_LE(p50, std::chrono::microseconds(500) + std::chrono::microseconds(500) / 16);
+    const auto p999 = histogram.percentile(99.9);
+    ASSERT_GE(p999, std::chrono::microseconds(999));
+    ASSERT_LE(p999, histogram.max());
+    ASSERT_EQ(histogram.max(), histogram.percentile(100));
+    ASSERT_EQ(std::chrono::nanoseconds(0), histogram.percentile(0));
+}
+
+TEST(LatencyHistogram, merge)
+{
+    tp::LatencyHistogram a;
+    tp::LatencyHistogram b;
+    a.record(std::chrono::nanoseconds(10));
+    b.record(std::chrono::milliseconds(10));
+    b.record(std::chrono::milliseconds(10));
+
+    tp::detail::AtomicHistogram atomic;
+    atomic.record(std::chrono::seconds(1));
+
+    a.merge(b);
+    atomic.mergeInto(a);
+    ASSERT_EQ(static_cast<std::uint64_t>(4), a.count());
+    ASSERT_EQ(std::chrono::nanoseconds(10), a.percentile(25));
+    ASSERT_GE(a.percentile(75), std::chrono::milliseconds(10));
+    ASSERT_LT(a.percentile(75), std::chrono::milliseconds(11));
+    ASSERT_GE(a.max(), std::chrono::seconds(1));
+}
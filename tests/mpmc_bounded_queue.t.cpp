@@ -0,0 +1,215 @@
+#include <gtest/gtest.h>
+
+#include <thread_pool/mpmc_bounded_queue.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace
+{
+struct Large
+{
+    char payload[96];
+};
+}
+
+TEST(MPMCBoundedQueue, badSize)
+{
+    ASSERT_THROW(tp::MPMCBoundedQueue<int>(0), std::invalid_argument);
+    ASSERT_THROW(tp::MPMCBoundedQueue<int>(3), std::invalid_argument);
+}
+
+TEST(MPMCBoundedQueue, cellAlignment)
+{
+    ASSERT_FALSE(tp::CacheAlignedCells<int>::value);
+    ASSERT_TRUE(tp::CacheAlignedCells<Large>::value);
+}
+
+TEST(MPMCBoundedQueue, moveKeepsContents)
+{
+    tp::MPMCBoundedQueue<std::unique_ptr<int>> a(4);
+    ASSERT_TRUE(a.push(std::unique_ptr<int>(new int(1))));
+    ASSERT_TRUE(a.push(std::unique_ptr<int>(new int(2))));
+
+    tp::MPMCBoundedQueue<std::unique_ptr<int>> b(std::move(a));
+
+    std::unique_ptr<int> value;
+    ASSERT_TRUE(b.pop(value));
+    ASSERT_EQ(1, *value);
+    ASSERT_TRUE(b.pop(value));
+    ASSERT_EQ(2, *value);
+    ASSERT_FALSE(b.pop(value));
+}
+
+TEST(MPMCBoundedQueue, bulkRoundTrip)
+{
+    tp::MPMCBoundedQueue<int> queue(8);
+
+    std::vector<int> in = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    ASSERT_EQ(0u, queue.size());
+    ASSERT_EQ(8u, queue.push_bulk(in.begin(), in.size()));
+    ASSERT_EQ(0u, queue.push_bulk(in.begin() + 8, 2));
+    ASSERT_EQ(8u, queue.size());
+
+    std::vector<int> out(3);
+    ASSERT_EQ(3u, queue.pop_bulk(out.begin(), out.size()));
+    ASSERT_EQ(5u, queue.size());
+    ASSERT_EQ(std::vector<int>({0, 1, 2}), out);
+
+    // Partial push into the space freed by the pop.
+    ASSERT_EQ(2u, queue.push_bulk(in.begin() + 8, 2));
+
+    out.assign(16, -1);
+    ASSERT_EQ(7u, queue.pop_bulk(out.begin(), out.size()));
+    ASSERT_EQ(std::vector<int>({3, 4, 5, 6, 7, 8, 9}), std::vector<int>(out.begin(), out.begin() + 7));
+    ASSERT_EQ(0u, queue.pop_bulk(out.begin(), out.size()));
+}
+
+TEST(MPMCBoundedQueue, alignedCellsRoundTrip)
+{
+    tp::MPMCBoundedQueue<Large> queue(4);
+
+    Large in;
+    in.payload[0] = 'x';
+    ASSERT_TRUE(queue.push(in));
+
+    Large out;
+    ASSERT_TRUE(queue.pop(out));
+    ASSERT_EQ('x', out.payload[0]);
+}
+
+TEST(MPMCBoundedQueue, concurrentBulk)
+{
+    const size_t producers = 4;
+    const size_t per_producer = 10000;
+    const size_t batch = 32;
+
+    tp::MPMCBoundedQueue<std::uint64_t> queue(256);
+    std::atomic<std::uint64_t> sum(0);
+    std::atomic<size_t> consumed(0);
+
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&, p]() {
+            std::vector<std::uint64_t> items;
+            for (size_t i = 0; i < per_producer; ++i)
+            {
+                items.push_back(p * per_producer + i);
+            }
+            size_t done = 0;
+            while (done < items.size())
+            {
+                size_t n = std::min(batch, items.size() - done);
+                done += queue.push_bulk(items.begin() + done, n);
+            }
+        });
+    }
+    for (size_t c = 0; c < 2; ++c)
+    {
+        threads.emplace_back([&]() {
+            std::vector<std::uint64_t> items(batch);
+            while (consumed.load() < producers * per_producer)
+            {
+                size_t n = queue.pop_bulk(items.begin(), items.size());
+                for (size_t i = 0; i < n; ++i)
+                {
+                    sum += items[i];
+                }
+                consumed += n;
+            }
+        });
+    }
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+
+    const std::uint64_t total = producers * per_producer;
+    ASSERT_EQ(total, consumed.load());
+    ASSERT_EQ(total * (total - 1) / 2, sum.load());
+}
+
+TEST(MPMCBoundedQueue, concurrentMixedBulk)
+{
+    // Single and bulk producers and consumers racing on a small queue, so
+    // positions go stale and slots are often still held by peers.
+    const size_t per_producer = 5000;
+    const size_t batch = 3;
+
+    tp::MPMCBoundedQueue<std::uint64_t> queue(8);
+    std::atomic<std::uint64_t> sum(0);
+    std::atomic<size_t> consumed(0);
+
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < 4; ++p)
+    {
+        threads.emplace_back([&, p]() {
+            std::vector<std::uint64_t> items;
+            for (size_t i = 0; i < per_producer; ++i)
+            {
+                items.push_back(p * per_producer + i);
+            }
+            size_t done = 0;
+            while (done < items.size())
+            {
+                size_t n = 0;
+                if (p % 2)
+                {
+                    n = queue.push_bulk(items.begin() + done, std::min(batch, items.size() - done));
+                }
+                else if (queue.push(items[done]))
+                {
+                    n = 1;
+                }
+                if (n == 0)
+                {
+                    std::this_thread::yield();
+                }
+                done += n;
+            }
+        });
+    }
+    for (size_t c = 0; c < 4; ++c)
+    {
+        threads.emplace_back([&, c]() {
+            std::vector<std::uint64_t> items(batch);
+            while (consumed.load() < 4 * per_producer)
+            {
+                size_t n = 0;
+                if (c % 2)
+                {
+                    n = queue.pop_bulk(items.begin(), items.size());
+                }
+                else if (queue.pop(items[0]))
+                {
+                    n = 1;
+                }
+                if (n == 0)
+                {
+                    std::this_thread::yield();
+                }
+                for (size_t i = 0; i < n; ++i)
+                {
+                    sum += items[i];
+                }
+                consumed += n;
+            }
+        });
+    }
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+
+    const std::uint64_t total = 4 * per_producer;
+    ASSERT_EQ(total, consumed.load());
+    ASSERT_EQ(total * (total - 1) / 2, sum.load());
+    std::uint64_t item;
+    ASSERT_FALSE(queue.pop(item));
+}
@@ -0,0 +1,208 @@
+#include <gtest/gtest.h>
+
+#include <thread_pool.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(Parallel, forVisitsEveryIndexOnce)
+{
+    tp::NonBlockingThreadPool pool;
+
+    std::vector<std::atomic<int>> visits(10007);
+    for (auto& v : visits) {
+        v = 0;
+    }
+
+    tp::parallel_for(pool, 0, 10007, 16, [&visits](int i) { ++visits[i]; });
+
+    for (auto& v : visits) {
+        ASSERT_EQ(1, v.load());
+    }
+}
+
+TEST(Parallel, forAutomaticGrainAndOffsetRange)
+{
+    tp::BlockingThreadPool pool;
+
+    std::atomic<std::int64_t> sum(0);
+    tp::parallel_for(pool, -500, 1500, 0, [&sum](int i) { sum += i; });
+
+    ASSERT_EQ(999000, sum.load());
+}
+
+TEST(Parallel, forEmptyRange)
+{
+    tp::NonBlockingThreadPool pool;
+
+    bool called = false;
+    tp::parallel_for(pool, 10, 10, 1, [&called](int) { called = true; });
+    tp::parallel_for(pool, 10, 5, 1, [&called](int) { called = true; });
+
+    ASSERT_FALSE(called);
+}
+
+TEST(Parallel, forPropagatesException)
+{
+    tp::NonBlockingThreadPool pool;
+
+    ASSERT_THROW(tp::parallel_for(pool, 0, 1000, 1, [](int i) {
+        if (i == 500) {
+            throw std::logic_error("failed");
+        }
+    }), std::logic_error);
+
+    // The pool is still usable.
+    std::atomic<int> count(0);
+    tp::parallel_for(pool, 0, 100, 1, [&count](int) { ++count; });
+    ASSERT_EQ(100, count.load());
+}
+
+TEST(Parallel, forCriticalPool)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(2);
+    options.setCritical(true);
+    tp::NonBlockingThreadPool pool(options);
+
+    std::atomic<int> count(0);
+    tp::parallel_for(pool, 0, 5000, 8, [&count](int) { ++count; });
+
+    ASSERT_EQ(5000, count.load());
+}
+
+TEST(Parallel, nestedFromWorkers)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(2);
+    options.setWorkStealing(true);
+    tp::NonBlockingThreadPool pool(options);
+
+    std::atomic<int> count(0);
+    tp::parallel_for(pool, 0, 16, 1, [&pool, &count](int) {
+        // Workers wait for their inner loops by running pending tasks.
+        tp::parallel_for(pool, 0, 64, 4, [&count](int) { ++count; });
+    });
+
+    ASSERT_EQ(16 * 64, count.load());
+}
+
+TEST(Parallel, reduceSum)
+{
+    tp::NonBlockingThreadPool pool;
+
+    std::int64_t sum = tp::parallel_reduce(pool, std::int64_t(1), std::int64_t(100001), std::int64_t(0),
+                                           std::int64_t(0),
+                                           [](std::int64_t i) { return i; },
+                                           [](std::int64_t a, std::int64_t b) { return a + b; });
+
+    ASSERT_EQ(5000050000, sum);
+}
+
+TEST(Parallel, reduceKeepsOrder)
+{
+    tp::BlockingThreadPool pool;
+
+    // String concatenation is associative but not commutative.
+    std::string digits = tp::parallel_reduce(pool, 0, 200, 3, std::string(),
+                                             [](int i) { return std::to_string(i % 10); },
+                                             [](const std::string& a, const std::string& b) { return a + b; });
+
+    std::string expected;
+    for (int i = 0; i < 200; ++i) {
+        expected += std::to_string(i % 10);
+    }
+    ASSERT_EQ(expected, digits);
+}
+
+TEST(Parallel, reduceBool)
+{
+    tp::NonBlockingThreadPool pool;
+
+    // Partials of neighbouring chunks must not share a word.
+    for (int odd = 0; odd < 64; ++odd) {
+        const bool all = tp::parallel_reduce(pool, 0, 64, 1, true,
+                                             [odd](int i) { return i != odd; },
+                                             [](bool a, bool b) { return a && b; });
+        ASSERT_FALSE(all);
+    }
+    ASSERT_TRUE(tp::parallel_reduce(pool, 0, 64, 1, true, [](int) { return true; },
+                                    [](bool a, bool b) { return a && b; }));
+}
+
+TEST(Parallel, forSurvivesCancelledHalves)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    tp::NonBlockingThreadPool pool(options);
+
+    // Occupy the only worker, so posted halves wait in the queue.
+    std::atomic<bool> release(false);
+    std::atomic<bool> started(false);
+    pool.post([&]() {
+        started = true;
+        while (!release.load()) {
+            std::this_thread::yield();
+        }
+    });
+    while (!started.load()) {
+        std::this_thread::yield();
+    }
+
+    std::vector<std::atomic<int>> visits(64);
+    for (auto& v : visits) {
+        v = 0;
+    }
+    tp::parallel_for(pool, 0, 64, 1, [&](int i) {
+        if (i == 0) {
+            // The caller runs chunk 0 once every half is posted: drop them.
+            release = true;
+            pool.shutdown(tp::DrainPolicy::CancelPending);
+        }
+        ++visits[i];
+    });
+
+    for (auto& v : visits) {
+        ASSERT_EQ(1, v.load());
+    }
+}
+
+TEST(Parallel, reduceEmptyRangeIsIdentity)
+{
+    tp::NonBlockingThreadPool pool;
+
+    ASSERT_EQ(7, tp::parallel_reduce(pool, 3, 3, 1, 7, [](int i) { return i; }, [](int a, int b) { return a + b; }));
+}
+
+TEST(ThreadPool, runPendingTask)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    tp::NonBlockingThreadPool pool(options);
+
+    std::atomic<bool> release(false);
+    std::atomic<bool> started(false);
+    pool.post([&release, &started]() {
+        started = true;
+        while (!release.load()) {
+            std::this_thread::yield();
+        }
+    });
+    while (!started.load()) {
+        std::this_thread::yield();
+    }
+
+    bool ran = false;
+    pool.post([&ran]() { ran = true; });
+
+    // The only worker is busy, so the caller runs the queued task.
+    ASSERT_TRUE(pool.runPendingTask());
+    ASSERT_TRUE(ran);
+    ASSERT_FALSE(pool.runPendingTask());
+
+    release = true;
+}
@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+
+#include <thread_pool/ring_buffer.hpp>
+#include <thread_pool/safe_queue.h>
+
+#include <memory>
+#include <queue>
+#include <string>
+
+TEST(RingBuffer, fifoAcrossWrap)
+{
+    tp::RingBuffer<int> buffer(4);
+
+    for (int round = 0; round < 10; ++round) {
+        buffer.push_back(round * 2);
+        buffer.push_back(round * 2 + 1);
+        ASSERT_EQ(round * 2 + 1, buffer.back());
+        ASSERT_EQ(round * 2, buffer.front());
+        buffer.pop_front();
+        ASSERT_EQ(round * 2 + 1, buffer.front());
+        buffer.pop_front();
+        ASSERT_TRUE(buffer.empty());
+    }
+    ASSERT_EQ(4u, buffer.capacity());
+}
+
+TEST(RingBuffer, growsWhenFull)
+{
+    tp::RingBuffer<std::string> buffer(2);
+
+    // Start off the beginning of the storage so growth has to unwrap.
+    buffer.push_back("x");
+    buffer.pop_front();
+
+    for (int i = 0; i < 5; ++i) {
+        buffer.push_back(std::to_string(i));
+    }
+    ASSERT_EQ(5u, buffer.size());
+    ASSERT_LE(5u, buffer.capacity());
+
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_EQ(std::to_string(i), buffer.front());
+        buffer.pop_front();
+    }
+    ASSERT_TRUE(buffer.empty());
+}
+
+TEST(RingBuffer, destroysElements)
+{
+    auto tracked = std::make_shared<int>(0);
+    {
+        tp::RingBuffer<std::shared_ptr<int>> buffer(4);
+        buffer.push_back(tracked);
+        buffer.push_back(tracked);
+        buffer.pop_front();
+        ASSERT_EQ(2, tracked.use_count());
+    }
+    ASSERT_EQ(1, tracked.use_count());
+}
+
+TEST(RingBuffer, copyAndMove)
+{
+    tp::RingBuffer<std::string> a(4);
+    a.push_back("a");
+    a.push_back("b");
+
+    tp::RingBuffer<std::string> b(a);
+    ASSERT_EQ(2u, b.size());
+    ASSERT_EQ("a", b.front());
+
+    tp::RingBuffer<std::string> c(std::move(a));
+    ASSERT_TRUE(a.empty());
+    ASSERT_EQ("b", c.back());
+
+    a = c;
+    ASSERT_EQ(2u, a.size());
+    c = std::move(b);
+    ASSERT_EQ("a", c.front());
+}
+
+TEST(RingBuffer, safeQueueBackend)
+{
+    tp::SafeQueue<int, tp::RingBuffer<int>> queue(2);
+
+    int item = 1;
+    ASSERT_TRUE(queue.try_move_push(item));
+    item = 2;
+    ASSERT_TRUE(queue.try_move_push(item));
+    item = 3;
+    ASSERT_FALSE(queue.try_move_push(item));
+
+    ASSERT_TRUE(queue.try_move_pop(item));
+    ASSERT_EQ(1, item);
+    ASSERT_TRUE(queue.try_move_pop(item));
+    ASSERT_EQ(2, item);
+    ASSERT_FALSE(queue.try_move_pop(item));
+}
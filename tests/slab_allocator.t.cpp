@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+
+#include <thread_pool/slab_allocator.hpp>
+
+#include <cstdint>
+#include <set>
+#include <thread>
+#include <vector>
+
+TEST(SlabAllocator, exhaustAndReuse)
+{
+    tp::SlabAllocator slab(4, 100);
+
+    ASSERT_EQ(128u, slab.blockSize());
+
+    std::set<void*> blocks;
+    for (int i = 0; i < 4; ++i) {
+        void* block = slab.allocate();
+        ASSERT_NE(nullptr, block);
+        ASSERT_TRUE(slab.owns(block));
+        ASSERT_EQ(0u, reinterpret_cast<std::uintptr_t>(block) % tp::SlabAllocator::BLOCK_ALIGNMENT);
+        blocks.insert(block);
+    }
+    ASSERT_EQ(4u, blocks.size());
+    ASSERT_EQ(nullptr, slab.allocate());
+
+    void* freed = *blocks.begin();
+    slab.deallocate(freed);
+    ASSERT_EQ(freed, slab.allocate());
+}
+
+TEST(SlabAllocator, empty)
+{
+    tp::SlabAllocator slab(0, 64);
+
+    ASSERT_EQ(nullptr, slab.allocate());
+    int on_stack = 0;
+    ASSERT_FALSE(slab.owns(&on_stack));
+}
+
+TEST(SlabAllocator, concurrentAllocate)
+{
+    const size_t threads = 4;
+    tp::SlabAllocator slab(16, 64);
+
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&slab]() {
+            for (int i = 0; i < 100000; ++i) {
+                auto block = static_cast<std::uintptr_t*>(slab.allocate());
+                if (!block) {
+                    continue;
+                }
+                // A block handed out twice would be clobbered by its other owner.
+                *block = reinterpret_cast<std::uintptr_t>(&i);
+                std::this_thread::yield();
+                ASSERT_EQ(reinterpret_cast<std::uintptr_t>(&i), *block);
+                slab.deallocate(block);
+            }
+        });
+    }
+    for (auto& t : workers) {
+        t.join();
+    }
+
+    size_t available = 0;
+    while (slab.allocate()) {
+        ++available;
+    }
+    ASSERT_EQ(16u, available);
+}
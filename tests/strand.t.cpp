@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+
+#include <thread_pool/thread_pool.hpp>
+#include <thread_pool/strand.hpp>
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST(Strand, serialFifoExecution)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(4);
+    tp::NonBlockingThreadPool pool(options);
+    tp::Strand<tp::NonBlockingThreadPool> strand(pool, 4096);
+
+    const int producers = 4;
+    const int per_producer = 500;
+    std::vector<std::vector<int>> seen(producers);
+    std::atomic<int> active(0);
+    std::atomic<bool> overlapped(false);
+    std::atomic<int> remaining(producers * per_producer);
+    std::promise<void> done;
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p]() {
+            for (int i = 0; i < per_producer; ++i) {
+                strand.post([&, p, i]() {
+                    if (active.fetch_add(1) != 0) {
+                        overlapped = true;
+                    }
+                    // No lock: the strand serialises the handlers.
+                    seen[p].push_back(i);
+                    active.fetch_sub(1);
+                    if (--remaining == 0) {
+                        done.set_value();
+                    }
+                });
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    done.get_future().wait();
+
+    ASSERT_FALSE(overlapped.load());
+    for (int p = 0; p < producers; ++p) {
+        ASSERT_EQ(static_cast<size_t>(per_producer), seen[p].size());
+        for (int i = 0; i < per_producer; ++i) {
+            ASSERT_EQ(i, seen[p][i]);
+        }
+    }
+}
+
+TEST(Strand, strandsRunInParallel)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(2);
+    tp::NonBlockingThreadPool pool(options);
+    tp::Strand<tp::NonBlockingThreadPool> first(pool);
+    tp::Strand<tp::NonBlockingThreadPool> second(pool);
+
+    // Each strand waits for the other one: only parallel strands finish.
+    std::atomic<bool> first_in(false);
+    std::atomic<bool> second_in(false);
+    std::promise<void> first_done;
+    std::promise<void> second_done;
+    first.post([&]() {
+        first_in = true;
+        while (!second_in.load()) {
+            std::this_thread::yield();
+        }
+        first_done.set_value();
+    });
+    second.post([&]() {
+        second_in = true;
+        while (!first_in.load()) {
+            std::this_thread::yield();
+        }
+        second_done.set_value();
+    });
+
+    first_done.get_future().wait();
+    second_done.get_future().wait();
+}
+
+TEST(Strand, exceptionsAndOverflow)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    tp::NonBlockingThreadPool pool(options);
+    tp::Strand<tp::NonBlockingThreadPool> strand(pool, 2);
+
+    std::atomic<bool> release(false);
+    std::promise<void> started;
+    strand.post([&]() {
+        started.set_value();
+        while (!release.load()) {
+            std::this_thread::yield();
+        }
+        throw std::runtime_error("ignored");
+    });
+    started.get_future().wait();
+
+    std::promise<void> after;
+    strand.post([&after]() { after.set_value(); });
+    strand.post([]() {});
+    ASSERT_FALSE(strand.tryPost([]() {}));
+    ASSERT_THROW(strand.post([]() {}), std::runtime_error);
+
+    release = true;
+    after.get_future().wait();
+
+    ASSERT_THROW((tp::Strand<tp::NonBlockingThreadPool>(pool, 3)), std::invalid_argument);
+}
@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+
+#include <thread_pool.hpp>
+
+#include <atomic>
+#include <future>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+template <typename Pool>
+long fib(Pool& pool, int n)
+{
+    if (n < 2) {
+        return n;
+    }
+    long a = 0;
+    long b = 0;
+    tp::TaskGroup<Pool> group(pool);
+    group.run([&pool, &a, n]() { a = fib(pool, n - 1); });
+    group.run([&pool, &b, n]() { b = fib(pool, n - 2); });
+    group.wait();
+    return a + b;
+}
+}
+
+TEST(TaskGroup, waitForAll)
+{
+    tp::BlockingThreadPool pool;
+    tp::TaskGroup<tp::BlockingThreadPool> group(pool);
+
+    std::atomic<int> count(0);
+    for (int i = 0; i < 100; ++i) {
+        group.run([&count]() { ++count; });
+    }
+    group.wait();
+
+    ASSERT_EQ(100, count.load());
+    ASSERT_EQ(0u, group.pending());
+}
+
+TEST(TaskGroup, forkJoinOnSmallPool)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(2);
+    tp::NonBlockingThreadPool pool(options);
+
+    std::packaged_task<long()> t([&pool]() { return fib(pool, 15); });
+    std::future<long> r = t.get_future();
+    pool.post(t);
+
+    ASSERT_EQ(std::future_status::ready, r.wait_for(std::chrono::seconds(30)));
+    ASSERT_EQ(610, r.get());
+}
+
+TEST(TaskGroup, forkJoinOnCriticalPool)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(2);
+    options.setCritical(true);
+    tp::NonBlockingThreadPool pool(options);
+
+    std::packaged_task<long()> t([&pool]() { return fib(pool, 12); });
+    std::future<long> r = t.get_future();
+    pool.post(t);
+
+    ASSERT_EQ(std::future_status::ready, r.wait_for(std::chrono::seconds(30)));
+    ASSERT_EQ(144, r.get());
+}
+
+TEST(TaskGroup, rejectedTasksRunInline)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    options.setQueueSize(2);
+    tp::BlockingThreadPool pool(options);
+
+    std::atomic<bool> release(false);
+    pool.post([&release]() {
+        while (!release.load()) {
+            std::this_thread::yield();
+        }
+    });
+
+    tp::TaskGroup<tp::BlockingThreadPool> group(pool);
+    std::atomic<int> inline_count(0);
+    const auto caller = std::this_thread::get_id();
+    for (int i = 0; i < 10; ++i) {
+        group.run([&inline_count, caller]() {
+            if (std::this_thread::get_id() == caller) {
+                ++inline_count;
+            }
+        });
+    }
+
+    // At most queue size tasks were accepted while the worker was busy.
+    ASSERT_LE(8, inline_count.load());
+
+    release = true;
+    group.wait();
+}
+
+TEST(TaskGroup, exceptionRethrownOnce)
+{
+    tp::NonBlockingThreadPool pool;
+    tp::TaskGroup<tp::NonBlockingThreadPool> group(pool);
+
+    group.run([]() { throw std::logic_error("failed"); });
+    group.run([]() {});
+
+    ASSERT_THROW(group.wait(), std::logic_error);
+    ASSERT_NO_THROW(group.wait());
+}
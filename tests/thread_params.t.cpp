@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+
+#include <thread_pool/thread_params.hpp>
+#include <thread_pool/thread_pool.hpp>
+
+#include <chrono>
+#include <future>
+#include <string>
+#include <vector>
+
+TEST(ThreadParams, defaultIsEmpty)
+{
+    tp::ThreadParams params;
+
+    ASSERT_TRUE(params.getName().empty());
+    ASSERT_TRUE(params.getCpuAffinity().empty());
+    ASSERT_EQ(tp::ThreadParams(), params);
+    ASSERT_EQ(tp::ThreadParams("", std::vector<int>()), params);
+#if defined(__unix__) || defined(__rtems__)
+    ASSERT_EQ(nullptr, params.getNativeCpuSet());
+#endif
+}
+
+TEST(ThreadParams, interned)
+{
+    tp::ThreadParams a("worker", {0, 1});
+    tp::ThreadParams b(std::string("worker"), std::vector<int>{0, 1});
+    tp::ThreadParams c("worker", {0});
+
+    ASSERT_EQ(a, b);
+    ASSERT_EQ(&a.getName(), &b.getName());
+    ASSERT_NE(a, c);
+    ASSERT_EQ(std::vector<int>({0, 1}), a.getCpuAffinity());
+}
+
+TEST(ThreadParams, internedAcrossThreads)
+{
+    // More distinct params than a thread remembers, from several threads.
+    std::vector<tp::ThreadParams> expected;
+    for (int i = 0; i < 16; ++i) {
+        expected.emplace_back("shared" + std::to_string(i), std::vector<int>{i});
+    }
+
+    std::vector<std::future<bool>> results;
+    for (int t = 0; t < 4; ++t) {
+        results.push_back(std::async(std::launch::async, [&expected]() {
+            for (int round = 0; round < 3; ++round) {
+                for (int i = 0; i < 16; ++i) {
+                    if (tp::ThreadParams("shared" + std::to_string(i), std::vector<int>{i}) != expected[i]) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }));
+    }
+    for (auto& result : results) {
+        ASSERT_TRUE(result.get());
+    }
+    ASSERT_NE(tp::ThreadParams("shared1", {2}), expected[1]);
+}
+
+TEST(ThreadParams, postTimeIgnoredByComparison)
+{
+    tp::ThreadParams a("worker");
+    tp::ThreadParams b("worker");
+    ASSERT_EQ(std::chrono::steady_clock::time_point(), a.getPostTime());
+
+    const auto now = std::chrono::steady_clock::now();
+    a.setPostTime(now);
+    ASSERT_EQ(now, a.getPostTime());
+    ASSERT_EQ(a, b);
+}
+
+TEST(ThreadParams, threadNameTruncated)
+{
+    tp::ThreadParams params("a_very_long_thread_name");
+
+    ASSERT_EQ(std::string("a_very_long_thread_name"), params.getName());
+    ASSERT_EQ(std::string("a_very_long_thr"), params.getThreadName());
+}
+
+#if defined(__unix__) || defined(__rtems__)
+TEST(ThreadParams, nativeCpuSet)
+{
+    tp::ThreadParams params("", {0, 2});
+
+    const cpu_set_t* cpuset = params.getNativeCpuSet();
+    ASSERT_NE(nullptr, cpuset);
+    ASSERT_TRUE(CPU_ISSET(0, cpuset));
+    ASSERT_FALSE(CPU_ISSET(1, cpuset));
+    ASSERT_TRUE(CPU_ISSET(2, cpuset));
+    ASSERT_EQ(2, CPU_COUNT(cpuset));
+}
+
+TEST(ThreadParams, appliedByWorker)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    tp::NonBlockingThreadPool pool(options);
+
+    const tp::ThreadParams params("a_very_long_thread_name");
+    for (int i = 0; i < 2; ++i) {
+        std::packaged_task<std::string()> t([]() {
+            char name[16] = {0};
+            pthread_getname_np(pthread_self(), name, sizeof(name));
+            return std::string(name);
+        });
+        std::future<std::string> r = t.get_future();
+        ASSERT_TRUE(pool.tryPost(t, params));
+        ASSERT_EQ(std::string("a_very_long_thr"), r.get());
+    }
+}
+#endif
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -5,10 +5,17 @@
 #include <thread_pool/fixed_function.hpp>
 #include <thread_pool/safe_queue.h>
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <thread>
 #include <future>
 #include <functional>
 #include <memory>
+#include <string>
+#include <mutex>
+#include <sstream>
+#include <vector>
 
 TEST(ThreadPool, postJob)
 {
@@ -110,6 +117,1147 @@ TEST(ThreadPool, postJobCriticalAfterFree)
 
     ASSERT_EQ(42, r.get());
 }
+TEST(ThreadPool, postJobCriticalAfterException)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    options.setCritical(true);
+
+    tp::NonBlockingThreadPool pool(options);
+    pool.post([]() { throw std::runtime_error("failure"); });
+
+    // Wait for first task to finish before posting second task.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    // A throwing task must not leave the worker marked busy.
+    std::packaged_task<int()> t([]() { return 42; });
+    std::future<int> r = t.get_future();
+    ASSERT_NO_THROW(pool.post(t));
+    ASSERT_EQ(42, r.get());
+}
+
+TEST(ThreadPool, workStealingNestedPost)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(4);
+    options.setWorkStealing(true);
+
+    tp::NonBlockingThreadPool pool(options);
+
+    const int children = 256;
+    std::atomic<int> executed(0);
+    std::promise<void> done;
+    std::future<void> r = done.get_future();
+
+    pool.post([&pool, &executed, &done, children]() {
+        for (int i = 0; i < children; ++i) {
+            // Posted from a worker: lands in its local deque.
+            pool.post([&executed, &done, children]() {
+                if (++executed == children) {
+                    done.set_value();
+                }
+            });
+        }
+    });
+
+    ASSERT_EQ(std::future_status::ready, r.wait_for(std::chrono::seconds(10)));
+    ASSERT_EQ(children, executed.load());
+}
+
+TEST(ThreadPool, workStealingSpreadsLocalTasks)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(4);
+    options.setWorkStealing(true);
+
+    tp::NonBlockingThreadPool pool(options);
+
+    const int children = 4;
+    std::atomic<int> started(0);
+    std::promise<void> done;
+    std::future<void> r = done.get_future();
+
+    pool.post([&pool, &started, &done, children]() {
+        for (int i = 0; i < children; ++i) {
+            pool.post([&started, &done, children]() {
+                // Only completes if every child runs on a different worker.
+                if (++started == children) {
+                    done.set_value();
+                }
+                while (started.load() < children) {
+                    std::this_thread::yield();
+                }
+            });
+        }
+    });
+
+    ASSERT_EQ(std::future_status::ready, r.wait_for(std::chrono::seconds(10)));
+}
+
+TEST(ThreadPool, blockingIdleWorkersStopPromptly)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(16);
+
+    std::unique_ptr<tp::BlockingThreadPool> pool(new tp::BlockingThreadPool(options));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    auto start = std::chrono::steady_clock::now();
+    pool.reset();
+    auto teardown = std::chrono::steady_clock::now() - start;
+
+    // Used to poll with a 10 ms timeout, so up to 10 ms per worker.
+    ASSERT_LT(teardown, std::chrono::milliseconds(100));
+}
+
+TEST(ThreadPool, blockingWorkStealingNestedPost)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(4);
+    options.setWorkStealing(true);
+
+    tp::BlockingThreadPool pool(options);
+
+    const int children = 4;
+    std::atomic<int> started(0);
+    std::promise<void> done;
+    std::future<void> r = done.get_future();
+
+    pool.post([&pool, &started, &done, children]() {
+        for (int i = 0; i < children; ++i) {
+            pool.post([&started, &done, children]() {
+                // Parked siblings must wake up and steal for this to finish.
+                if (++started == children) {
+                    done.set_value();
+                }
+                while (started.load() < children) {
+                    std::this_thread::yield();
+                }
+            });
+        }
+    });
+
+    ASSERT_EQ(std::future_status::ready, r.wait_for(std::chrono::seconds(10)));
+}
+
+TEST(ThreadPool, idlePolicies)
+{
+    const tp::IdlePolicy policies[] = {tp::IdlePolicy::Spin, tp::IdlePolicy::SpinPause,
+                                       tp::IdlePolicy::SpinYield, tp::IdlePolicy::SpinPark};
+    for (auto policy : policies) {
+        tp::ThreadPoolOptions options;
+        options.setThreadCount(2);
+        options.setIdlePolicy(policy);
+        options.setSpinCount(8);
+
+        tp::NonBlockingThreadPool pool(options);
+        // Let the workers go idle before posting.
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        std::packaged_task<int()> t([]() { return 42; });
+        std::future<int> r = t.get_future();
+        pool.post(t);
+
+        ASSERT_EQ(std::future_status::ready, r.wait_for(std::chrono::seconds(5)));
+        ASSERT_EQ(42, r.get());
+    }
+}
+
+TEST(ThreadPool, parkedCriticalWorkerWakesUp)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(2);
+    options.setCritical(true);
+    options.setIdlePolicy(tp::IdlePolicy::SpinPark);
+    options.setSpinCount(0);
+
+    tp::NonBlockingThreadPool pool(options);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    for (int i = 0; i < 10; ++i) {
+        std::packaged_task<int()> t([i]() { return i; });
+        std::future<int> r = t.get_future();
+        ASSERT_TRUE(pool.tryPost(t));
+        ASSERT_EQ(std::future_status::ready, r.wait_for(std::chrono::seconds(5)));
+        ASSERT_EQ(i, r.get());
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+TEST(ThreadPool, tryPostBatch)
+{
+    const bool modes[][2] = {{false, false}, {false, true}, {true, false}};
+    for (auto mode : modes) {
+        tp::ThreadPoolOptions options;
+        options.setThreadCount(4);
+        options.setQueueSize(256);
+        options.setCritical(mode[0]);
+        options.setWorkStealing(mode[1]);
+
+        tp::NonBlockingThreadPool pool(options);
+
+        const int tasks = 64;
+        std::atomic<int> executed(0);
+        std::promise<void> done;
+        std::future<void> r = done.get_future();
+
+        std::vector<std::function<void()>> batch;
+        for (int i = 0; i < tasks; ++i) {
+            batch.push_back([&executed, &done, tasks]() {
+                if (++executed == tasks) {
+                    done.set_value();
+                }
+            });
+        }
+
+        size_t posted = 0;
+        while (posted < batch.size()) {
+            posted += pool.tryPostBatch(batch.begin() + posted, batch.end());
+        }
+
+        ASSERT_EQ(std::future_status::ready, r.wait_for(std::chrono::seconds(10)));
+        ASSERT_EQ(tasks, executed.load());
+    }
+}
+
+TEST(ThreadPool, tryPostBatchFromWorker)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(4);
+    options.setWorkStealing(true);
+
+    tp::BlockingThreadPool pool(options);
+
+    const int children = 128;
+    std::atomic<int> executed(0);
+    std::promise<void> done;
+    std::future<void> r = done.get_future();
+
+    pool.post([&pool, &executed, &done, children]() {
+        std::vector<std::function<void()>> batch;
+        for (int i = 0; i < children; ++i) {
+            batch.push_back([&executed, &done, children]() {
+                if (++executed == children) {
+                    done.set_value();
+                }
+            });
+        }
+        ASSERT_EQ(batch.size(), pool.tryPostBatch(batch.begin(), batch.end()));
+    });
+
+    ASSERT_EQ(std::future_status::ready, r.wait_for(std::chrono::seconds(10)));
+}
+
+namespace
+{
+/**
+ * @brief runBehindBlocker Post tasks while the only worker is busy and
+ * return the order they ran in. Each entry is 'H' or 'L' by priority.
+ */
+std::string runBehindBlocker(const tp::ThreadPoolOptions& options, size_t high, size_t low)
+{
+    tp::NonBlockingThreadPool pool(options);
+
+    std::atomic<bool> started(false);
+    std::atomic<bool> release(false);
+    pool.post([&started, &release]() {
+        started = true;
+        while (!release.load()) {
+            std::this_thread::yield();
+        }
+    });
+    while (!started.load()) {
+        std::this_thread::yield();
+    }
+
+    std::string order;
+    std::mutex lock;
+    std::promise<void> done;
+    std::atomic<size_t> remaining(high + low);
+    auto record = [&](char c) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            order += c;
+        }
+        if (--remaining == 0) {
+            done.set_value();
+        }
+    };
+    for (size_t i = 0; i < low; ++i) {
+        pool.post([&record]() { record('L'); });
+    }
+    for (size_t i = 0; i < high; ++i) {
+        pool.postWithPriority([&record]() { record('H'); }, 0);
+    }
+
+    release = true;
+    done.get_future().wait();
+    return order;
+}
+}
+
+TEST(ThreadPool, strictPriority)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    options.setPriorityLevels(2);
+
+    ASSERT_EQ("HHHHLLLL", runBehindBlocker(options, 4, 4));
+}
+
+TEST(ThreadPool, weightedPriority)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    options.setPriorityLevels(2);
+    options.setPriorityScheduling(tp::PriorityScheduling::Weighted);
+    options.setPriorityWeights({3, 1});
+
+    // The blocker used up the low level share, so high goes first.
+    ASSERT_EQ("HHHLHHHLHHLLLLLL", runBehindBlocker(options, 8, 8));
+}
+
+TEST(ThreadPool, priorityOnCriticalAndBlockingPools)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(2);
+    options.setPriorityLevels(3);
+
+    tp::BlockingThreadPool blocking(options);
+    options.setCritical(true);
+    tp::NonBlockingThreadPool critical(options);
+
+    for (size_t priority = 0; priority < 5; ++priority) {
+        std::packaged_task<size_t()> a([priority]() { return priority; });
+        std::future<size_t> ra = a.get_future();
+        ASSERT_TRUE(blocking.tryPostWithPriority(a, priority));
+        ASSERT_EQ(priority, ra.get());
+
+        std::packaged_task<size_t()> b([priority]() { return priority; });
+        std::future<size_t> rb = b.get_future();
+        while (!critical.tryPostWithPriority(b, priority)) {
+            std::this_thread::yield();
+        }
+        ASSERT_EQ(priority, rb.get());
+    }
+}
+
+TEST(ThreadPool, deadlineScheduling)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    options.setCritical(true);
+    options.setDeadlineScheduling(true);
+    tp::NonBlockingThreadPool pool(options);
+
+    std::atomic<bool> started(false);
+    std::atomic<bool> release(false);
+    pool.post([&started, &release]() {
+        started = true;
+        while (!release.load()) {
+            std::this_thread::yield();
+        }
+    });
+    while (!started.load()) {
+        std::this_thread::yield();
+    }
+
+    // Unlike round robin dispatch, posting to a critical pool whose only
+    // worker is busy succeeds and the job waits in the shared queue.
+    std::string order;
+    std::promise<void> done;
+    const auto now = std::chrono::steady_clock::now();
+    ASSERT_TRUE(pool.tryPost([&order, &done]() { order += 'N'; done.set_value(); }));
+    ASSERT_TRUE(pool.tryPostWithDeadline([&order]() { order += 'C'; }, now + std::chrono::hours(3)));
+    ASSERT_TRUE(pool.tryPostWithDeadline([&order]() { order += 'A'; }, now + std::chrono::hours(1)));
+    ASSERT_TRUE(pool.tryPostWithDeadline([&order]() { order += 'X'; }, now - std::chrono::hours(1)));
+    ASSERT_TRUE(pool.tryPostWithDeadline([&order]() { order += 'B'; }, now + std::chrono::hours(2)));
+
+    release = true;
+    done.get_future().wait();
+
+    ASSERT_EQ("XABCN", order);
+    ASSERT_EQ(3u, pool.deadlinesMet());
+    ASSERT_EQ(1u, pool.deadlinesMissed());
+}
+
+TEST(ThreadPool, deadlineIgnoresInboxTasks)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    options.setCritical(true);
+    options.setDeadlineScheduling(true);
+    tp::NonBlockingThreadPool pool(options);
+
+    std::packaged_task<void()> t([]() {});
+    std::future<void> r = t.get_future();
+    ASSERT_TRUE(pool.tryPostWithDeadline(std::move(t), std::chrono::steady_clock::now() + std::chrono::hours(1)));
+    r.wait();
+
+    // Jobs posted to a worker have no deadline, whatever ran before them.
+    for (int i = 0; i < 3; ++i) {
+        std::packaged_task<void()> to([]() {});
+        std::future<void> rto = to.get_future();
+        pool.postTo(0, std::move(to));
+        rto.wait();
+    }
+    pool.shutdown(tp::DrainPolicy::DrainAll);
+    ASSERT_EQ(1u, pool.deadlinesMet());
+    ASSERT_EQ(0u, pool.deadlinesMissed());
+}
+
+TEST(ThreadPool, deadlineIgnoredWithoutDeadlineScheduling)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    tp::NonBlockingThreadPool pool(options);
+
+    std::packaged_task<int()> t([]() { return 42; });
+    std::future<int> r = t.get_future();
+    ASSERT_TRUE(pool.tryPostWithDeadline(t, std::chrono::steady_clock::now()));
+    ASSERT_EQ(42, r.get());
+    ASSERT_EQ(0u, pool.deadlinesMet());
+    ASSERT_EQ(0u, pool.deadlinesMissed());
+}
+
+TEST(ThreadPool, postAfterAndAt)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(2);
+    tp::NonBlockingThreadPool pool(options);
+
+    const auto start = std::chrono::steady_clock::now();
+    std::promise<std::chrono::steady_clock::time_point> after;
+    std::promise<std::chrono::steady_clock::time_point> at;
+    pool.postAfter(std::chrono::milliseconds(20), [&after]() {
+        after.set_value(std::chrono::steady_clock::now());
+    });
+    pool.postAt(start + std::chrono::milliseconds(10), [&at]() {
+        at.set_value(std::chrono::steady_clock::now());
+    });
+
+    ASSERT_GE(at.get_future().get(), start + std::chrono::milliseconds(10));
+    ASSERT_GE(after.get_future().get(), start + std::chrono::milliseconds(20));
+}
+
+TEST(ThreadPool, postEveryAndCancel)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(2);
+    tp::NonBlockingThreadPool pool(options);
+
+    std::atomic<int> runs(0);
+    std::promise<void> third;
+    tp::TimerId periodic = pool.postEvery(std::chrono::milliseconds(2), [&runs, &third]() {
+        if (++runs == 3) {
+            third.set_value();
+        }
+    });
+    third.get_future().wait();
+    ASSERT_TRUE(pool.cancelTimer(periodic));
+    ASSERT_FALSE(pool.cancelTimer(periodic));
+
+    std::atomic<bool> cancelled_ran(false);
+    tp::TimerId one_shot = pool.postAfter(std::chrono::milliseconds(20), [&cancelled_ran]() {
+        cancelled_ran = true;
+    });
+    ASSERT_NE(periodic, one_shot);
+    ASSERT_TRUE(pool.cancelTimer(one_shot));
+
+    std::promise<void> later;
+    pool.postAfter(std::chrono::milliseconds(40), [&later]() { later.set_value(); });
+    later.get_future().wait();
+
+    // The periodic run in flight when cancelled may finish, no more after.
+    ASSERT_LE(runs.load(), 4);
+    ASSERT_FALSE(cancelled_ran.load());
+    ASSERT_THROW(pool.postEvery(std::chrono::milliseconds(0), []() {}), std::invalid_argument);
+}
+
+namespace
+{
+template <typename Pool>
+void checkPostTo(Pool& pool)
+{
+    std::vector<std::thread::id> owners(pool.threadCount());
+    for (size_t round = 0; round < 3; ++round) {
+        for (size_t id = 0; id < pool.threadCount(); ++id) {
+            std::packaged_task<std::thread::id()> t([]() { return std::this_thread::get_id(); });
+            std::future<std::thread::id> r = t.get_future();
+            pool.postTo(id, std::move(t));
+            std::thread::id owner = r.get();
+            if (round == 0) {
+                owners[id] = owner;
+            }
+            ASSERT_EQ(owners[id], owner);
+        }
+    }
+    for (size_t id = 1; id < owners.size(); ++id) {
+        ASSERT_NE(owners[0], owners[id]);
+    }
+    ASSERT_THROW(pool.postTo(pool.threadCount(), []() {}), std::invalid_argument);
+}
+}
+
+TEST(ThreadPool, postToWorker)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(3);
+    tp::NonBlockingThreadPool non_blocking(options);
+    checkPostTo(non_blocking);
+    tp::BlockingThreadPool blocking(options);
+    checkPostTo(blocking);
+
+    options.setCritical(true);
+    tp::NonBlockingThreadPool critical(options);
+    checkPostTo(critical);
+}
+
+TEST(ThreadPool, postWithKey)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(4);
+    options.setWorkStealing(true);
+    tp::NonBlockingThreadPool pool(options);
+
+    for (int key = 0; key < 8; ++key) {
+        std::thread::id first;
+        for (int i = 0; i < 4; ++i) {
+            std::packaged_task<std::thread::id()> t([]() { return std::this_thread::get_id(); });
+            std::future<std::thread::id> r = t.get_future();
+            pool.postWithKey(key, std::move(t));
+            std::thread::id owner = r.get();
+            if (i == 0) {
+                first = owner;
+            }
+            ASSERT_EQ(first, owner);
+        }
+    }
+    ASSERT_EQ(pool.workerForKey(std::string("partition")), pool.workerForKey(std::string("partition")));
+}
+
+TEST(ThreadPool, postWithKeySpillsWhenOverloaded)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(2);
+    options.setAffinityQueueSize(2);
+    tp::NonBlockingThreadPool pool(options);
+
+    const size_t busy = pool.workerForKey(7);
+    std::atomic<bool> release(false);
+    std::promise<void> started;
+    pool.postTo(busy, [&]() {
+        started.set_value();
+        while (!release.load()) {
+            std::this_thread::yield();
+        }
+    });
+    started.get_future().wait();
+
+    std::atomic<int> ran(0);
+    ASSERT_TRUE(pool.tryPostTo(busy, [&ran]() { ++ran; }));
+    ASSERT_TRUE(pool.tryPostTo(busy, [&ran]() { ++ran; }));
+    ASSERT_FALSE(pool.tryPostTo(busy, [&ran]() { ++ran; }));
+
+    // The inbox is full, so the other worker runs it.
+    std::packaged_task<std::thread::id()> t([]() { return std::this_thread::get_id(); });
+    std::future<std::thread::id> r = t.get_future();
+    ASSERT_TRUE(pool.tryPostWithKey(7, std::move(t)));
+    std::thread::id spilled = r.get();
+
+    std::packaged_task<std::thread::id()> b([]() { return std::this_thread::get_id(); });
+    std::future<std::thread::id> rb = b.get_future();
+    release = true;
+    while (ran.load() != 2) {
+        std::this_thread::yield();
+    }
+    pool.postTo(busy, std::move(b));
+    ASSERT_NE(rb.get(), spilled);
+
+    options.setAffinityQueueSize(0);
+    tp::NonBlockingThreadPool disabled(options);
+    ASSERT_FALSE(disabled.tryPostTo(0, []() {}));
+    std::packaged_task<int()> k([]() { return 1; });
+    std::future<int> rk = k.get_future();
+    ASSERT_TRUE(disabled.tryPostWithKey(1, std::move(k)));
+    ASSERT_EQ(1, rk.get());
+}
+
+TEST(ThreadPool, failedPostToKeepsCriticalWorkerFree)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(2);
+    options.setCritical(true);
+    options.setAffinityQueueSize(0);
+    tp::NonBlockingThreadPool pool(options);
+
+    // Without inbox the push fails, and worker 0 must stay free.
+    ASSERT_FALSE(pool.tryPostTo(0, []() {}));
+
+    std::packaged_task<size_t()> t([]() {
+        return tp::Worker<tp::FixedFunction<void(), 128>, tp::MPMCBoundedQueue>::getWorkerIdForCurrentThread();
+    });
+    std::future<size_t> r = t.get_future();
+    ASSERT_TRUE(pool.tryPost(std::move(t)));
+    ASSERT_EQ(0u, r.get());
+}
+
+namespace
+{
+template <typename Pool>
+void checkNumaPool(Pool& pool)
+{
+    const int jobs = 64;
+    std::atomic<int> ran(0);
+    std::atomic<int> pinned(0);
+    auto job = [&ran, &pinned]() {
+        cpu_set_t cpuset;
+        pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+        if (CPU_COUNT(&cpuset) == 1 && CPU_ISSET(0, &cpuset)) {
+            ++pinned;
+        }
+        ++ran;
+    };
+    for (int i = 0; i < jobs / 2; ++i) {
+        pool.post(job);
+    }
+    // Jobs posted from a worker go to the queues of its node.
+    pool.post([&pool, job]() mutable {
+        for (int i = 0; i < jobs / 2; ++i) {
+            pool.post(job);
+        }
+    });
+    while (ran.load() != jobs) {
+        std::this_thread::yield();
+    }
+    ASSERT_EQ(jobs, pinned.load());
+}
+}
+
+TEST(ThreadPool, numaAware)
+{
+    // Two nodes sharing CPU 0, so the test runs on any machine.
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(3);
+    options.setNumaAware(true);
+    options.setTopology(tp::Topology(std::vector<tp::Topology::Node>{{0, {0}}, {1, {0}}}));
+
+    tp::NonBlockingThreadPool non_blocking(options);
+    checkNumaPool(non_blocking);
+    tp::BlockingThreadPool blocking(options);
+    checkNumaPool(blocking);
+
+    options.setWorkStealing(true);
+    tp::NonBlockingThreadPool stealing(options);
+    checkNumaPool(stealing);
+
+    // Critical pools reject jobs while all workers are busy.
+    options.setCritical(true);
+    tp::NonBlockingThreadPool critical(options);
+    for (int i = 0; i < 8; ++i) {
+        std::packaged_task<int()> t([]() {
+            cpu_set_t cpuset;
+            pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+            return CPU_COUNT(&cpuset) == 1 && CPU_ISSET(0, &cpuset) ? 0 : -1;
+        });
+        std::future<int> r = t.get_future();
+        critical.post(t);
+        ASSERT_EQ(0, r.get());
+    }
+}
+
+namespace
+{
+template <typename Predicate>
+bool waitFor(Predicate predicate)
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!predicate()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+}
+
+TEST(ThreadPool, elasticGrowsAndRetires)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    options.setMaxThreadCount(4);
+    options.setIdleTimeout(std::chrono::milliseconds(20));
+    options.setIdlePolicy(tp::IdlePolicy::SpinPark);
+    options.setSpinCount(0);
+    tp::NonBlockingThreadPool pool(options);
+    ASSERT_EQ(static_cast<size_t>(1), pool.threadCount());
+    ASSERT_EQ(static_cast<size_t>(4), pool.maxThreadCount());
+
+    // Blocked jobs keep every worker busy, so each post starts one more.
+    std::atomic<bool> release(false);
+    std::atomic<int> started(0);
+    for (int i = 0; i < 4; ++i) {
+        pool.post([&]() {
+            ++started;
+            while (!release.load()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+        ASSERT_TRUE(waitFor([&]() { return started.load() == i + 1; }));
+    }
+    ASSERT_EQ(static_cast<size_t>(4), pool.threadCount());
+
+    release = true;
+    ASSERT_TRUE(waitFor([&]() { return pool.threadCount() == 1; }));
+
+    std::packaged_task<int()> t([]() { return 42; });
+    std::future<int> r = t.get_future();
+    pool.post(t);
+    ASSERT_EQ(42, r.get());
+}
+
+TEST(ThreadPool, resize)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(2);
+    options.setMinThreadCount(1);
+    options.setMaxThreadCount(4);
+    options.setWorkStealing(true);
+    tp::NonBlockingThreadPool pool(options);
+
+    ASSERT_EQ(static_cast<size_t>(4), pool.resize(4));
+    ASSERT_EQ(static_cast<size_t>(1), pool.resize(1));
+    ASSERT_EQ(static_cast<size_t>(4), pool.resize(10));
+    ASSERT_EQ(static_cast<size_t>(1), pool.resize(0));
+    ASSERT_EQ(static_cast<size_t>(1), pool.threadCount());
+
+    std::atomic<int> ran(0);
+    for (int i = 0; i < 100; ++i) {
+        pool.post([&ran]() { ++ran; });
+    }
+    ASSERT_TRUE(waitFor([&]() { return ran.load() == 100; }));
+
+    tp::ThreadPoolOptions fixed;
+    fixed.setThreadCount(2);
+    tp::NonBlockingThreadPool fixed_pool(fixed);
+    ASSERT_EQ(static_cast<size_t>(2), fixed_pool.resize(1));
+    ASSERT_EQ(static_cast<size_t>(2), fixed_pool.threadCount());
+}
+
+namespace
+{
+std::string currentThreadName()
+{
+    char name[16] = {0};
+    pthread_getname_np(pthread_self(), name, sizeof(name));
+    return name;
+}
+}
+
+TEST(ThreadPool, resizeReappliesThreadParams)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(2);
+    options.setMinThreadCount(1);
+    tp::NonBlockingThreadPool pool(options);
+    const tp::ThreadParams params("renamed");
+
+    for (int cycle = 0; cycle < 2; ++cycle) {
+        std::packaged_task<std::string()> t(currentThreadName);
+        std::future<std::string> r = t.get_future();
+        ASSERT_TRUE(pool.tryPostTo(1, std::move(t), params));
+        ASSERT_EQ("renamed", r.get());
+
+        // Retire worker 1, the next post restarts it on a new thread.
+        ASSERT_EQ(static_cast<size_t>(1), pool.resize(1));
+        ASSERT_EQ(static_cast<size_t>(2), pool.resize(2));
+    }
+}
+
+TEST(ThreadPool, resizeMigratesQueuedJobs)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(2);
+    options.setMinThreadCount(1);
+    options.setCritical(true);
+    tp::NonBlockingThreadPool pool(options);
+
+    // Queue jobs behind a blocked job on the worker about to retire.
+    std::atomic<bool> release(false);
+    std::promise<void> blocked;
+    pool.postTo(1, [&]() {
+        blocked.set_value();
+        while (!release.load()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+    blocked.get_future().wait();
+
+    std::mutex mutex;
+    std::vector<std::thread::id> owners;
+    for (int i = 0; i < 3; ++i) {
+        pool.postTo(1, [&]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            owners.push_back(std::this_thread::get_id());
+        });
+    }
+
+    std::thread releaser([&release]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        release = true;
+    });
+    ASSERT_EQ(static_cast<size_t>(1), pool.resize(1));
+    releaser.join();
+
+    ASSERT_TRUE(waitFor([&]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return owners.size() == 3;
+    }));
+    std::packaged_task<std::thread::id()> t([]() { return std::this_thread::get_id(); });
+    std::future<std::thread::id> r = t.get_future();
+    pool.postTo(0, std::move(t));
+    const std::thread::id remaining = r.get();
+    for (auto owner : owners) {
+        ASSERT_EQ(remaining, owner);
+    }
+}
+
+namespace
+{
+
+template <typename Pool>
+void occupyWorker(Pool& pool, std::atomic<bool>& release)
+{
+    std::atomic<bool> started{false};
+    pool.post([&started, &release]() {
+        started = true;
+        while (!release) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+    while (!started) {
+        std::this_thread::yield();
+    }
+}
+
+}
+
+TEST(ThreadPool, shutdownDrainAll)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    tp::NonBlockingThreadPool pool(options);
+
+    std::atomic<bool> release{false};
+    occupyWorker(pool, release);
+
+    std::atomic<int> count{0};
+    for (int i = 0; i < 10; ++i) {
+        pool.post([&count]() { ++count; });
+    }
+    // Jobs posted by draining jobs are still accepted.
+    pool.post([&pool, &count]() {
+        ASSERT_TRUE(pool.tryPost([&count]() { ++count; }));
+    });
+
+    std::thread releaser([&release]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        release = true;
+    });
+    const tp::ShutdownResult result = pool.shutdown(tp::DrainPolicy::DrainAll);
+    releaser.join();
+
+    ASSERT_EQ(11, count.load());
+    ASSERT_EQ(static_cast<size_t>(12), result.executed);
+    ASSERT_EQ(static_cast<size_t>(0), result.discarded);
+
+    ASSERT_FALSE(pool.tryPost([&count]() { ++count; }));
+    const tp::ShutdownResult again = pool.shutdown(tp::DrainPolicy::DrainAll);
+    ASSERT_EQ(static_cast<size_t>(0), again.executed);
+    ASSERT_EQ(static_cast<size_t>(0), again.discarded);
+}
+
+TEST(ThreadPool, shutdownCancelPending)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    tp::NonBlockingThreadPool pool(options);
+
+    std::atomic<bool> release{false};
+    occupyWorker(pool, release);
+
+    std::atomic<int> count{0};
+    std::vector<tp::Future<int>> futures;
+    for (int i = 0; i < 10; ++i) {
+        futures.push_back(pool.submit([&count, i]() { ++count; return i; }));
+    }
+
+    std::thread releaser([&release]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        release = true;
+    });
+    const tp::ShutdownResult result = pool.shutdown(tp::DrainPolicy::CancelPending);
+    releaser.join();
+
+    ASSERT_EQ(0, count.load());
+    ASSERT_EQ(static_cast<size_t>(0), result.executed);
+    ASSERT_EQ(static_cast<size_t>(10), result.discarded);
+    for (auto& future : futures) {
+        ASSERT_THROW(future.get(), std::runtime_error);
+    }
+}
+
+TEST(ThreadPool, shutdownCountsDeadlinesOfRunJobsOnly)
+{
+    for (int cancel = 0; cancel < 2; ++cancel) {
+        tp::ThreadPoolOptions options;
+        options.setThreadCount(1);
+        options.setCritical(true);
+        options.setDeadlineScheduling(true);
+        tp::NonBlockingThreadPool pool(options);
+
+        std::atomic<bool> release{false};
+        occupyWorker(pool, release);
+        const auto past = std::chrono::steady_clock::now() - std::chrono::hours(1);
+        for (int i = 0; i < 3; ++i) {
+            ASSERT_TRUE(pool.tryPostWithDeadline([]() {}, past));
+        }
+        release = true;
+
+        const tp::ShutdownResult result =
+            pool.shutdown(cancel ? tp::DrainPolicy::CancelPending : tp::DrainPolicy::DrainAll);
+        // Jobs run by the sweep are counted once run, discarded ones never.
+        ASSERT_EQ(0u, pool.deadlinesMet());
+        ASSERT_EQ(cancel ? 0u : result.executed, pool.deadlinesMissed());
+        ASSERT_EQ(3u, result.executed + result.discarded);
+    }
+}
+
+TEST(ThreadPool, shutdownDrainUntilDeadline)
+{
+    for (bool passed : {true, false}) {
+        tp::ThreadPoolOptions options;
+        options.setThreadCount(1);
+        tp::NonBlockingThreadPool pool(options);
+
+        std::atomic<bool> release{false};
+        occupyWorker(pool, release);
+
+        std::atomic<int> count{0};
+        for (int i = 0; i < 10; ++i) {
+            pool.post([&count]() { ++count; });
+        }
+
+        const auto deadline = passed ? std::chrono::steady_clock::now()
+                                     : std::chrono::steady_clock::now() + std::chrono::hours(1);
+        std::thread releaser([&release]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            release = true;
+        });
+        const tp::ShutdownResult result = pool.shutdown(tp::DrainPolicy::DrainUntilDeadline, deadline);
+        releaser.join();
+
+        ASSERT_EQ(passed ? 0 : 10, count.load());
+        ASSERT_EQ(static_cast<size_t>(passed ? 0 : 10), result.executed);
+        ASSERT_EQ(static_cast<size_t>(passed ? 10 : 0), result.discarded);
+    }
+}
+
+TEST(ThreadPool, shutdownWakesParkedWorkers)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(4);
+    tp::BlockingThreadPool pool(options);
+
+    std::packaged_task<int()> t([]() { return 42; });
+    std::future<int> r = t.get_future();
+    pool.post(t);
+    ASSERT_EQ(42, r.get());
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    const auto start = std::chrono::steady_clock::now();
+    pool.shutdown(tp::DrainPolicy::DrainAll);
+    ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(500));
+}
+
+TEST(ThreadPool, stats)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    options.setQueueSize(4);
+    tp::NonBlockingThreadPool pool(options);
+
+    std::atomic<bool> release{false};
+    occupyWorker(pool, release);
+
+    size_t queued = 0;
+    size_t refused = 0;
+    for (int i = 0; i < 8; ++i) {
+        if (pool.tryPost([i]() {
+                if (i % 2) {
+                    throw std::runtime_error("odd");
+                }
+            })) {
+            ++queued;
+        } else {
+            ++refused;
+        }
+    }
+    ASSERT_EQ(static_cast<size_t>(4), queued);
+    ASSERT_EQ(static_cast<size_t>(4), refused);
+    release = true;
+
+    ASSERT_TRUE(waitFor([&pool, queued]() { return pool.stats().total.executed == queued + 1; }));
+    const tp::PoolStats stats = pool.stats();
+    ASSERT_EQ(pool.maxThreadCount(), stats.workers.size());
+    ASSERT_EQ(stats.total.executed, stats.workers[0].executed);
+    ASSERT_EQ(static_cast<std::uint64_t>(2), stats.total.exceptions);
+    ASSERT_EQ(static_cast<std::uint64_t>(refused), stats.rejected);
+    ASSERT_GE(stats.total.queue_high_water, static_cast<std::uint64_t>(queued));
+    ASSERT_TRUE(stats.total.timed);
+    ASSERT_GE(stats.total.busy, std::chrono::milliseconds(1));
+
+    pool.shutdown(tp::DrainPolicy::DrainAll);
+    ASSERT_FALSE(pool.tryPost([]() {}));
+    ASSERT_EQ(static_cast<std::uint64_t>(refused + 1), pool.stats().rejected);
+}
+
+TEST(ThreadPool, statsCriticalAndTimed)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    options.setCritical(true);
+    options.setLatencyHistograms(true);
+    tp::NonBlockingThreadPool pool(options);
+
+    std::atomic<bool> release{false};
+    occupyWorker(pool, release);
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_TRUE(pool.tryPostTo(0, []() {}));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    release = true;
+    pool.shutdown(tp::DrainPolicy::DrainAll);
+
+    // The worker's inbox held the three jobs at once.
+    const tp::PoolStats stats = pool.stats();
+    ASSERT_EQ(static_cast<std::uint64_t>(3), stats.workers[0].queue_high_water);
+    ASSERT_GE(stats.total.busy, std::chrono::milliseconds(1));
+}
+
+TEST(ThreadPool, statsUntimed)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    options.setTimedStats(false);
+    tp::NonBlockingThreadPool pool(options);
+
+    std::atomic<bool> release{false};
+    occupyWorker(pool, release);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    release = true;
+    pool.shutdown(tp::DrainPolicy::DrainAll);
+
+    // Unmeasured time is flagged rather than passed off as zero.
+    const tp::PoolStats stats = pool.stats();
+    ASSERT_EQ(static_cast<std::uint64_t>(1), stats.total.executed);
+    ASSERT_FALSE(stats.total.timed);
+    ASSERT_FALSE(stats.workers[0].timed);
+}
+
+TEST(ThreadPool, latencyHistograms)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    options.setLatencyHistograms(true);
+    tp::NonBlockingThreadPool pool(options);
+
+    std::atomic<bool> release{false};
+    occupyWorker(pool, release);
+    for (int i = 0; i < 10; ++i) {
+        pool.post([]() {});
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    release = true;
+    pool.shutdown(tp::DrainPolicy::DrainAll);
+
+    const tp::LatencyHistogram queue_wait = pool.queueWaitHistogram();
+    const tp::LatencyHistogram run_time = pool.runTimeHistogram();
+    ASSERT_EQ(static_cast<std::uint64_t>(11), queue_wait.count());
+    ASSERT_EQ(static_cast<std::uint64_t>(11), run_time.count());
+    // The queued jobs waited behind the occupying one.
+    ASSERT_GE(queue_wait.percentile(90), std::chrono::milliseconds(20));
+    ASSERT_GE(run_time.max(), std::chrono::milliseconds(20));
+
+    tp::NonBlockingThreadPool plain;
+    std::packaged_task<void()> t([]() {});
+    std::future<void> r = t.get_future();
+    plain.post(t);
+    r.wait();
+    ASSERT_EQ(static_cast<std::uint64_t>(0), plain.queueWaitHistogram().count());
+}
+
+TEST(ThreadPool, flushTrace)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(2);
+    options.setTraceBufferSize(1024);
+    tp::NonBlockingThreadPool pool(options);
+
+    for (int i = 0; i < 5; ++i) {
+        std::packaged_task<void()> t([]() {});
+        std::future<void> r = t.get_future();
+        ASSERT_TRUE(pool.tryPost(t, tp::ThreadParams("traced")));
+        r.wait();
+    }
+    pool.shutdown(tp::DrainPolicy::DrainAll);
+
+    std::ostringstream out;
+    ASSERT_GE(pool.flushTrace(out), static_cast<size_t>(10));
+    const std::string json = out.str();
+    ASSERT_EQ(0u, json.find("{\"traceEvents\":["));
+    ASSERT_NE(std::string::npos, json.find("\"name\":\"worker 1\""));
+    ASSERT_NE(std::string::npos, json.find("{\"name\":\"traced\",\"ph\":\"B\""));
+    ASSERT_NE(std::string::npos, json.find("\"ph\":\"E\""));
+
+    // Events are written once.
+    std::ostringstream again;
+    ASSERT_EQ(static_cast<size_t>(0), pool.flushTrace(again));
+}
+
+TEST(ThreadPool, compactTasks)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(2);
+    options.setTaskBlockSize(256);
+    tp::CompactThreadPool pool(options);
+
+    std::array<int, 40> medium;
+    std::array<int, 200> large;
+    for (size_t i = 0; i < large.size(); ++i) {
+        large[i] = static_cast<int>(i);
+        if (i < medium.size()) {
+            medium[i] = static_cast<int>(i);
+        }
+    }
+
+    // Inline, in a slab block and on the heap.
+    tp::Future<int> small = pool.submit([]() { return 1; });
+    tp::Future<int> in_slab = pool.submit([medium]() { return medium.back(); });
+    tp::Future<int> on_heap = pool.submit([large]() { return large.back(); });
+    ASSERT_EQ(1, small.get());
+    ASSERT_EQ(39, in_slab.get());
+    ASSERT_EQ(199, on_heap.get());
+
+    std::atomic<int> sum{0};
+    std::vector<std::function<void()>> batch;
+    for (int i = 0; i < 8; ++i) {
+        batch.push_back([&sum, large]() { sum += large[1]; });
+    }
+    ASSERT_EQ(batch.size(), pool.tryPostBatch(batch.begin(), batch.end()));
+    ASSERT_TRUE(waitFor([&sum]() { return sum.load() == 8; }));
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -9,6 +9,7 @@
 #include <future>
 #include <functional>
 #include <memory>
+#include <vector>
 
 #include <spdlog/spdlog.h>
 
@@ -33,6 +34,20 @@ TEST(BlockingQueue, pushItemLvalue) {
     ASSERT_EQ(valueToAdd, valuePop);
 }
 
+TEST(BlockingQueue, pushBulk) {
+    tp::BlockingQueue<int> intQueue(4);
+
+    std::vector<int> values = {1, 2, 3, 4, 5};
+    ASSERT_EQ(4u, intQueue.push_bulk(values.begin(), values.size()));
+    ASSERT_EQ(0u, intQueue.push_bulk(values.begin() + 4, 1));
+
+    for (int expected = 1; expected <= 4; ++expected) {
+        int value = 0;
+        ASSERT_TRUE(intQueue.pop(value));
+        ASSERT_EQ(expected, value);
+    }
+}
+
 TEST(BlockingQueue, popItemNominal) {
     size_t queueSize = 2;
     tp::BlockingQueue<int> intQueue(queueSize);
@@ -42,9 +57,58 @@ TEST(BlockingQueue, popItemNominal) {
     int valueToPop;
     ASSERT_TRUE(intQueue.pop(valueToPop));
     ASSERT_TRUE(intQueue.pop(valueToPop));
+    ASSERT_FALSE(intQueue.tryPop(valueToPop));
+}
+
+TEST(BlockingQueue, closeDrainsThenFails) {
+    size_t queueSize = 2;
+    tp::BlockingQueue<int> intQueue(queueSize);
+
+    ASSERT_TRUE(intQueue.push(42));
+    intQueue.close();
+
+    int valueToPop(0);
+    ASSERT_TRUE(intQueue.pop(valueToPop));
+    ASSERT_EQ(42, valueToPop);
     ASSERT_FALSE(intQueue.pop(valueToPop));
 }
 
+TEST(BlockingQueue, closeWakesBlockedConsumer) {
+    size_t queueSize = 2;
+    tp::BlockingQueue<int> intQueue(queueSize);
+
+    std::promise<bool> result;
+    std::thread consumer([&intQueue, &result]() {
+        int valueToPop;
+        result.set_value(intQueue.pop(valueToPop));
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    auto start = std::chrono::steady_clock::now();
+    intQueue.close();
+    ASSERT_FALSE(result.get_future().get());
+    consumer.join();
+    ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+}
+
+TEST(BlockingQueue, pushWakesBlockedConsumer) {
+    size_t queueSize = 2;
+    tp::BlockingQueue<int> intQueue(queueSize);
+
+    std::promise<int> result;
+    std::thread consumer([&intQueue, &result]() {
+        int valueToPop(0);
+        intQueue.pop(valueToPop);
+        result.set_value(valueToPop);
+    });
+
+    // Longer than the former 10 ms polling period.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_TRUE(intQueue.push(7));
+    ASSERT_EQ(7, result.get_future().get());
+    consumer.join();
+}
+
 TEST(BlockingQueue, mtNominal) {
     size_t queueSize = 2;
     tp::BlockingQueue<int> intQueue(queueSize);
@@ -69,6 +133,7 @@ TEST(BlockingQueue, mtNominal) {
     });
 
     producer.join();
+    intQueue.close();
     consumer.join();
 
     ASSERT_EQ(producerCounter, consumerCounter);
@@ -81,8 +146,9 @@ TEST(BlockingQueue, mtMultipleConsumer) {
     int producerCounter = 0;
     std::thread producer([&intQueue, &producerCounter]() {
         for (int i = 0; i < 90; i++) {
-            intQueue.push(std::rand());
-            producerCounter++;
+            if (intQueue.push(std::rand())) {
+                producerCounter++;
+            }
             std::this_thread::sleep_for(std::chrono::milliseconds(3));
         }
     });
@@ -90,64 +156,50 @@ TEST(BlockingQueue, mtMultipleConsumer) {
     int consumerCounter1 = 0;
     std::thread consumer1([&intQueue, &consumerCounter1]() {
         int valueToPop;
-        for (int i = 0; i < 100; i++) {
-            bool ok = intQueue.pop(valueToPop);
-            if (ok) {
-                consumerCounter1++;
-                spdlog::debug("BlockingQueue::mtMultipleConsumer1. New value received: {}", valueToPop);
-            }
+        while (intQueue.pop(valueToPop)) {
+            consumerCounter1++;
+            spdlog::debug("BlockingQueue::mtMultipleConsumer1. New value received: {}", valueToPop);
         }
     });
 
     int consumerCounter2 = 0;
     std::thread consumer2([&intQueue, &consumerCounter2]() {
         int valueToPop;
-        for (int i = 0; i < 100; i++) {
-            bool ok = intQueue.pop(valueToPop);
-            if (ok) {
-                consumerCounter2++;
-                spdlog::debug("BlockingQueue::mtMultipleConsumer2. New value received: {}", valueToPop);
-            }
+        while (intQueue.pop(valueToPop)) {
+            consumerCounter2++;
+            spdlog::debug("BlockingQueue::mtMultipleConsumer2. New value received: {}", valueToPop);
         }
     });
 
     int consumerCounter3 = 0;
     std::thread consumer3([&intQueue, &consumerCounter3]() {
         int valueToPop;
-        for (int i = 0; i < 100; i++) {
-            bool ok = intQueue.pop(valueToPop);
-            if (ok) {
-                consumerCounter3++;
-                spdlog::debug("BlockingQueue::mtMultipleConsumer3. New value received: {}", valueToPop);
-            }
+        while (intQueue.pop(valueToPop)) {
+            consumerCounter3++;
+            spdlog::debug("BlockingQueue::mtMultipleConsumer3. New value received: {}", valueToPop);
         }
     });
 
     int consumerCounter4 = 0;
     std::thread consumer4([&intQueue, &consumerCounter4]() {
         int valueToPop;
-        for (int i = 0; i < 100; i++) {
-            bool ok = intQueue.pop(valueToPop);
-            if (ok) {
-                consumerCounter4++;
-                spdlog::debug("BlockingQueue::mtMultipleConsumer4. New value received: {}", valueToPop);
-            }
+        while (intQueue.pop(valueToPop)) {
+            consumerCounter4++;
+            spdlog::debug("BlockingQueue::mtMultipleConsumer4. New value received: {}", valueToPop);
         }
     });
 
     int consumerCounter5 = 0;
     std::thread consumer5([&intQueue, &consumerCounter5]() {
         int valueToPop;
-        for (int i = 0; i < 100; i++) {
-            bool ok = intQueue.pop(valueToPop);
-            if (ok) {
-                consumerCounter5++;
-                spdlog::debug("BlockingQueue::mtMultipleConsumer5. New value received: {}", valueToPop);
-            }
+        while (intQueue.pop(valueToPop)) {
+            consumerCounter5++;
+            spdlog::debug("BlockingQueue::mtMultipleConsumer5. New value received: {}", valueToPop);
         }
     });
 
     producer.join();
+    intQueue.close();
     consumer1.join();
     consumer2.join();
     consumer3.join();
@@ -11,6 +11,9 @@ TEST(ThreadPoolOptions, ctor)
     ASSERT_EQ(static_cast<size_t>(1024), options.queueSize());
     ASSERT_EQ(std::max<size_t>(1u, std::thread::hardware_concurrency()),
               options.threadCount());
+    ASSERT_EQ(tp::IdlePolicy::Spin, options.idlePolicy());
+    ASSERT_EQ(static_cast<size_t>(1), options.priorityLevels());
+    ASSERT_EQ(tp::PriorityScheduling::Strict, options.priorityScheduling());
 }
 
 TEST(ThreadPoolOptions, modification)
@@ -22,6 +25,74 @@ TEST(ThreadPoolOptions, modification)
 
     options.setQueueSize(32);
     ASSERT_EQ(static_cast<size_t>(32), options.queueSize());
+
+    ASSERT_FALSE(options.workStealing());
+    options.setWorkStealing(true);
+    ASSERT_TRUE(options.workStealing());
+
+    options.setIdlePolicy(tp::IdlePolicy::SpinPark);
+    ASSERT_EQ(tp::IdlePolicy::SpinPark, options.idlePolicy());
+
+    options.setSpinCount(16);
+    ASSERT_EQ(static_cast<size_t>(16), options.spinCount());
+
+    options.setPriorityLevels(0);
+    ASSERT_EQ(static_cast<size_t>(1), options.priorityLevels());
+    options.setPriorityLevels(3);
+    ASSERT_EQ(static_cast<size_t>(3), options.priorityLevels());
+    ASSERT_EQ(static_cast<size_t>(3), options.priorityWeight(0));
+    ASSERT_EQ(static_cast<size_t>(1), options.priorityWeight(2));
+
+    options.setPriorityScheduling(tp::PriorityScheduling::Weighted);
+    ASSERT_EQ(tp::PriorityScheduling::Weighted, options.priorityScheduling());
+    options.setPriorityWeights({8, 0});
+    ASSERT_EQ(static_cast<size_t>(8), options.priorityWeight(0));
+    ASSERT_EQ(static_cast<size_t>(2), options.priorityWeight(1));
+    ASSERT_EQ(static_cast<size_t>(1), options.priorityWeight(2));
+
+    ASSERT_FALSE(options.deadlineScheduling());
+    options.setDeadlineScheduling(true);
+    ASSERT_TRUE(options.deadlineScheduling());
+
+    ASSERT_EQ(static_cast<size_t>(64), options.affinityQueueSize());
+    options.setAffinityQueueSize(0);
+    ASSERT_EQ(static_cast<size_t>(0), options.affinityQueueSize());
+
+    ASSERT_FALSE(options.numaAware());
+    options.setNumaAware(true);
+    ASSERT_TRUE(options.numaAware());
+    options.setTopology(tp::Topology(std::vector<tp::Topology::Node>{{0, {0}}, {1, {0}}}));
+    ASSERT_EQ(static_cast<size_t>(2), options.topology().nodeCount());
+
+    ASSERT_FALSE(options.latencyHistograms());
+    options.setLatencyHistograms(true);
+    ASSERT_TRUE(options.latencyHistograms());
+
+    ASSERT_TRUE(options.timedStats());
+    options.setTimedStats(false);
+    ASSERT_FALSE(options.timedStats());
+
+    ASSERT_EQ(static_cast<size_t>(0), options.traceBufferSize());
+    options.setTraceBufferSize(256);
+    ASSERT_EQ(static_cast<size_t>(256), options.traceBufferSize());
+
+    ASSERT_EQ(static_cast<size_t>(256), options.taskBlockSize());
+    options.setTaskBlockSize(0);
+    ASSERT_EQ(static_cast<size_t>(0), options.taskBlockSize());
+
+    options.setThreadCount(4);
+    ASSERT_EQ(static_cast<size_t>(4), options.minThreadCount());
+    ASSERT_EQ(static_cast<size_t>(4), options.maxThreadCount());
+    options.setMinThreadCount(2);
+    options.setMaxThreadCount(8);
+    ASSERT_EQ(static_cast<size_t>(2), options.minThreadCount());
+    ASSERT_EQ(static_cast<size_t>(8), options.maxThreadCount());
+    options.setThreadCount(1);
+    ASSERT_EQ(static_cast<size_t>(1), options.minThreadCount());
+    options.setMaxThreadCount(0);
+    ASSERT_EQ(static_cast<size_t>(1), options.maxThreadCount());
+    options.setIdleTimeout(std::chrono::milliseconds(50));
+    ASSERT_EQ(std::chrono::milliseconds(50), options.idleTimeout());
 }
 
 int main(int argc, char **argv) {
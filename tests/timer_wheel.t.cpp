@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+
+#include <thread_pool/timer_wheel.hpp>
+
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace
+{
+typedef std::vector<std::pair<std::uint32_t, std::uint64_t>> Fired;
+
+void advance(tp::TimerWheel& wheel, std::uint64_t tick, Fired& fired)
+{
+    wheel.advance(tick, [&wheel, &fired](std::uint32_t id) {
+        fired.emplace_back(id, wheel.currentTick());
+    });
+}
+}
+
+TEST(TimerWheel, expiresOnItsTick)
+{
+    const std::vector<std::uint64_t> expiries = {
+        1, 5, 63, 64, 65, 100, 4095, 4096, 5000, 300000,
+        (std::uint64_t(1) << 24) + 7, (std::uint64_t(1) << 25) + 3};
+
+    tp::TimerWheel wheel;
+    for (std::uint32_t id = 0; id < expiries.size(); ++id) {
+        wheel.insert(id, expiries[id]);
+    }
+    ASSERT_EQ(expiries.size(), wheel.size());
+
+    Fired fired;
+    while (wheel.size() != 0) {
+        advance(wheel, wheel.nextTick(), fired);
+    }
+
+    ASSERT_EQ(expiries.size(), fired.size());
+    for (std::uint32_t id = 0; id < expiries.size(); ++id) {
+        ASSERT_EQ(id, fired[id].first);
+        ASSERT_EQ(expiries[id], fired[id].second);
+    }
+    ASSERT_EQ(std::uint64_t(-1), wheel.nextTick());
+}
+
+TEST(TimerWheel, pastExpiryFiresOnNextTick)
+{
+    tp::TimerWheel wheel(1000);
+    wheel.insert(0, 10);
+    wheel.insert(1, 1000);
+    ASSERT_EQ(1001u, wheel.nextTick());
+
+    Fired fired;
+    advance(wheel, 1000, fired);
+    ASSERT_TRUE(fired.empty());
+    advance(wheel, 1001, fired);
+    ASSERT_EQ(2u, fired.size());
+    ASSERT_EQ(1001u, fired[0].second);
+    ASSERT_EQ(1001u, fired[1].second);
+}
+
+TEST(TimerWheel, remove)
+{
+    tp::TimerWheel wheel;
+    wheel.insert(0, 10);
+    wheel.insert(1, 10);
+    wheel.insert(2, 5000);
+    wheel.remove(1);
+    wheel.remove(2);
+    ASSERT_EQ(1u, wheel.size());
+
+    Fired fired;
+    advance(wheel, 100000, fired);
+    ASSERT_EQ(1u, fired.size());
+    ASSERT_EQ(0u, fired[0].first);
+    ASSERT_EQ(100000u, wheel.currentTick());
+}
+
+TEST(TimerWheel, randomized)
+{
+    std::mt19937_64 random(42);
+    tp::TimerWheel wheel(123456789);
+    std::vector<std::uint64_t> expiries;
+    std::vector<std::uint32_t> free_ids;
+    Fired fired;
+
+    for (int round = 0; round < 2000; ++round) {
+        std::uint64_t expiry = wheel.currentTick() + 1 + random() % (std::uint64_t(1) << (random() % 28));
+        std::uint32_t id;
+        if (free_ids.empty()) {
+            id = static_cast<std::uint32_t>(expiries.size());
+            expiries.push_back(expiry);
+        } else {
+            id = free_ids.back();
+            free_ids.pop_back();
+            expiries[id] = expiry;
+        }
+        wheel.insert(id, expiry);
+
+        advance(wheel, wheel.currentTick() + random() % 100000, fired);
+        for (const auto& timer : fired) {
+            ASSERT_EQ(expiries[timer.first], timer.second);
+            free_ids.push_back(timer.first);
+        }
+        fired.clear();
+    }
+
+    std::uint64_t last = 0;
+    while (wheel.size() != 0) {
+        advance(wheel, wheel.nextTick(), fired);
+        for (const auto& timer : fired) {
+            ASSERT_EQ(expiries[timer.first], timer.second);
+            ASSERT_LE(last, timer.second);
+            last = timer.second;
+        }
+        fired.clear();
+    }
+}
@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+
+#include <thread_pool/topology.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+std::string makeFakeSysfs()
+{
+    char root[] = "/tmp/topology_testXXXXXX";
+    if (!mkdtemp(root)) {
+        throw std::runtime_error("mkdtemp failed");
+    }
+    const std::string dir = root;
+    for (const char* node : {"node1", "node0", "node2"}) {
+        mkdir((dir + "/" + node).c_str(), 0700);
+    }
+    std::ofstream(dir + "/node0/cpulist") << "0-1,4\n";
+    std::ofstream(dir + "/node1/cpulist") << "2-3,5\n";
+    // A memory only node.
+    std::ofstream(dir + "/node2/cpulist") << "\n";
+    mkdir((dir + "/power").c_str(), 0700);
+    return dir;
+}
+
+void removeFakeSysfs(const std::string& dir)
+{
+    for (const char* node : {"node0", "node1", "node2"}) {
+        std::remove((dir + "/" + node + "/cpulist").c_str());
+        rmdir((dir + "/" + node).c_str());
+    }
+    rmdir((dir + "/power").c_str());
+    rmdir(dir.c_str());
+}
+}
+
+TEST(Topology, parseCpuList)
+{
+    ASSERT_EQ(std::vector<int>({0, 1, 2, 3, 8, 10, 11}), tp::Topology::parseCpuList("0-3,8,10-11"));
+    ASSERT_EQ(std::vector<int>({1, 2, 5}), tp::Topology::parseCpuList("5,1-2,2\n"));
+    ASSERT_EQ(std::vector<int>({7}), tp::Topology::parseCpuList("x,3-1,7"));
+    ASSERT_TRUE(tp::Topology::parseCpuList("").empty());
+}
+
+TEST(Topology, defaultIsSingleNode)
+{
+    tp::Topology topology;
+    ASSERT_EQ(static_cast<size_t>(1), topology.nodeCount());
+    ASSERT_FALSE(topology.node(0).cpus.empty());
+    ASSERT_EQ(static_cast<size_t>(0), topology.nodeOfCpu(0));
+}
+
+TEST(Topology, discover)
+{
+    const std::string dir = makeFakeSysfs();
+    tp::Topology topology = tp::Topology::discover(dir);
+    removeFakeSysfs(dir);
+
+    ASSERT_EQ(static_cast<size_t>(2), topology.nodeCount());
+    ASSERT_EQ(static_cast<size_t>(0), topology.node(0).id);
+    ASSERT_EQ(std::vector<int>({0, 1, 4}), topology.node(0).cpus);
+    ASSERT_EQ(static_cast<size_t>(1), topology.node(1).id);
+    ASSERT_EQ(std::vector<int>({2, 3, 5}), topology.node(1).cpus);
+
+    ASSERT_EQ(static_cast<size_t>(0), topology.nodeOfCpu(4));
+    ASSERT_EQ(static_cast<size_t>(1), topology.nodeOfCpu(5));
+    ASSERT_EQ(static_cast<size_t>(0), topology.nodeOfCpu(64));
+}
+
+TEST(Topology, discoverFallsBackToSingleNode)
+{
+    tp::Topology topology = tp::Topology::discover("/nonexistent/node");
+    ASSERT_EQ(static_cast<size_t>(1), topology.nodeCount());
+    ASSERT_FALSE(topology.node(0).cpus.empty());
+}
+
+TEST(Topology, runOnNode)
+{
+    tp::Topology topology(std::vector<tp::Topology::Node>{{3, {0}}});
+
+    int cpu = -1;
+    topology.runOnNode(0, [&cpu]() {
+        cpu_set_t cpuset;
+        pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+        cpu = CPU_COUNT(&cpuset) == 1 && CPU_ISSET(0, &cpuset) ? 0 : -1;
+    });
+    ASSERT_EQ(0, cpu);
+
+    ASSERT_THROW(topology.runOnNode(0, []() { throw std::runtime_error("failed"); }), std::runtime_error);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
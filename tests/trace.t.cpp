@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+
+#include <thread_pool/trace.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(TraceBuffer, badSize)
+{
+    ASSERT_THROW(tp::detail::TraceBuffer(0), std::invalid_argument);
+    ASSERT_THROW(tp::detail::TraceBuffer(3), std::invalid_argument);
+}
+
+TEST(TraceBuffer, consumeOnce)
+{
+    tp::detail::TraceBuffer buffer(4);
+    const std::string name = "job";
+    const auto now = std::chrono::steady_clock::now();
+    buffer.record(tp::TraceEventType::TaskBegin, now, &name);
+    buffer.record(tp::TraceEventType::TaskEnd, now + std::chrono::microseconds(1));
+
+    std::vector<tp::TraceEvent> events;
+    auto collect = [&events](const tp::TraceEvent& event) { events.push_back(event); };
+    ASSERT_EQ(static_cast<size_t>(2), buffer.consume(collect));
+    ASSERT_EQ(tp::TraceEventType::TaskBegin, events[0].type);
+    ASSERT_EQ(&name, events[0].name);
+    ASSERT_EQ(std::chrono::nanoseconds(1000), events[1].time - events[0].time);
+
+    ASSERT_EQ(static_cast<size_t>(0), buffer.consume(collect));
+}
+
+TEST(TraceBuffer, keepsNewestWhenFull)
+{
+    tp::detail::TraceBuffer buffer(4);
+    const auto epoch = std::chrono::steady_clock::time_point();
+    for (int i = 0; i < 10; ++i) {
+        buffer.record(tp::TraceEventType::Steal, epoch + std::chrono::nanoseconds(i));
+    }
+
+    std::vector<long long> times;
+    buffer.consume([&times](const tp::TraceEvent& event) { times.push_back(event.time.count()); });
+    ASSERT_EQ(std::vector<long long>({6, 7, 8, 9}), times);
+}
+
+TEST(TraceBuffer, concurrentConsume)
+{
+    tp::detail::TraceBuffer buffer(64);
+    std::atomic<bool> done{false};
+    std::thread writer([&buffer, &done]() {
+        const auto epoch = std::chrono::steady_clock::time_point();
+        for (int i = 0; i < 100000; ++i) {
+            buffer.record(tp::TraceEventType::Steal, epoch + std::chrono::nanoseconds(i));
+        }
+        done = true;
+    });
+
+    // Events come out in order, none repeated, none torn.
+    long long last = -1;
+    bool finished = false;
+    while (!finished) {
+        finished = done.load();
+        buffer.consume([&last](const tp::TraceEvent& event) {
+            ASSERT_GT(event.time.count(), last);
+            ASSERT_EQ(tp::TraceEventType::Steal, event.type);
+            last = event.time.count();
+        });
+    }
+    writer.join();
+    ASSERT_EQ(99999, last);
+}
+
+TEST(TraceBuffer, chromeEvent)
+{
+    const std::string name = "say \"hi\"\n";
+    tp::TraceEvent event;
+    event.time = std::chrono::nanoseconds(1234567);
+    event.name = &name;
+    event.type = tp::TraceEventType::TaskBegin;
+
+    std::ostringstream out;
+    bool first = true;
+    tp::detail::write_chrome_event(out, 3, event, first);
+    ASSERT_FALSE(first);
+    ASSERT_EQ(std::string("\n{\"name\":\"say \\\"hi\\\"\\u000a\",\"ph\":\"B\",\"ts\":1234.567,\"pid\":0,\"tid\":3}"),
+              out.str());
+}
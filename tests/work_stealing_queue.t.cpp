@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+
+#include <thread_pool/work_stealing_queue.hpp>
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST(WorkStealingQueue, badSize)
+{
+    ASSERT_THROW(tp::WorkStealingQueue<int>(0), std::invalid_argument);
+    ASSERT_THROW(tp::WorkStealingQueue<int>(3), std::invalid_argument);
+}
+
+TEST(WorkStealingQueue, ownerIsLifo)
+{
+    tp::WorkStealingQueue<int> queue(4);
+
+    ASSERT_TRUE(queue.push(1));
+    ASSERT_TRUE(queue.push(2));
+    ASSERT_TRUE(queue.push(3));
+
+    int value = 0;
+    ASSERT_TRUE(queue.pop(value));
+    ASSERT_EQ(3, value);
+    ASSERT_TRUE(queue.pop(value));
+    ASSERT_EQ(2, value);
+    ASSERT_TRUE(queue.pop(value));
+    ASSERT_EQ(1, value);
+    ASSERT_FALSE(queue.pop(value));
+    ASSERT_TRUE(queue.empty());
+}
+
+TEST(WorkStealingQueue, thiefIsFifo)
+{
+    tp::WorkStealingQueue<int> queue(4);
+
+    ASSERT_TRUE(queue.push(1));
+    ASSERT_TRUE(queue.push(2));
+    ASSERT_EQ(2u, queue.size());
+
+    int value = 0;
+    ASSERT_TRUE(queue.steal(value));
+    ASSERT_EQ(1, value);
+    ASSERT_EQ(1u, queue.size());
+    ASSERT_TRUE(queue.pop(value));
+    ASSERT_EQ(2, value);
+    ASSERT_FALSE(queue.steal(value));
+}
+
+TEST(WorkStealingQueue, full)
+{
+    tp::WorkStealingQueue<std::unique_ptr<int>> queue(2);
+
+    ASSERT_TRUE(queue.push(std::unique_ptr<int>(new int(1))));
+    ASSERT_TRUE(queue.push(std::unique_ptr<int>(new int(2))));
+
+    std::unique_ptr<int> rejected(new int(3));
+    ASSERT_FALSE(queue.push(std::move(rejected)));
+    // Data is left untouched when the push fails.
+    ASSERT_TRUE(rejected);
+
+    std::unique_ptr<int> value;
+    ASSERT_TRUE(queue.steal(value));
+    ASSERT_EQ(1, *value);
+    ASSERT_TRUE(queue.push(std::move(rejected)));
+}
+
+TEST(WorkStealingQueue, concurrentSteal)
+{
+    const int count = 100000;
+    tp::WorkStealingQueue<int> queue(1024);
+
+    std::atomic<bool> done(false);
+    std::atomic<long long> stolen_sum(0);
+    std::atomic<int> stolen_count(0);
+
+    std::vector<std::thread> thieves;
+    for (int t = 0; t < 3; ++t) {
+        thieves.emplace_back([&]() {
+            int value;
+            while (!done.load()) {
+                if (queue.steal(value)) {
+                    stolen_sum += value;
+                    stolen_count++;
+                }
+            }
+        });
+    }
+
+    long long owner_sum = 0;
+    int owner_count = 0;
+    int value;
+    for (int i = 1; i <= count; ++i) {
+        while (!queue.push(i)) {
+            if (queue.pop(value)) {
+                owner_sum += value;
+                owner_count++;
+            }
+        }
+        if (i % 3 == 0 && queue.pop(value)) {
+            owner_sum += value;
+            owner_count++;
+        }
+    }
+    while (queue.pop(value)) {
+        owner_sum += value;
+        owner_count++;
+    }
+    done = true;
+    for (auto& thief : thieves) {
+        thief.join();
+    }
+
+    ASSERT_EQ(count, owner_count + stolen_count.load());
+    ASSERT_EQ(static_cast<long long>(count) * (count + 1) / 2, owner_sum + stolen_sum.load());
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}